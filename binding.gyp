@@ -4,19 +4,40 @@
             "target_name": "addon",
             "sources": [
                 "src/bsf.cpp",
+                "src/broadcaster.cpp",
                 "src/formatcontext.cpp",
                 "src/codeccontext.cpp",
                 "src/packet.cpp",
                 "src/frame.cpp",
+                "src/frame-bus.cpp",
                 "src/error.cpp",
                 "src/filter.cpp",
+                "src/fragmented-output.cpp",
+                "src/hls-segmenter.cpp",
+                "src/input-scheduler.cpp",
+                "src/live-edge.cpp",
+                "src/mmap-input.cpp",
+                "src/output-rate.cpp",
+                "src/pipeline.cpp",
+                "src/push-input.cpp",
+                "src/readahead.cpp",
+                "src/rtp-pacer.cpp",
+                "src/stream-worker.cpp",
+                "src/codec-pool.cpp",
+                "src/decode-latency.cpp",
+                "src/udp-sink.cpp",
                 "src/worker/open-worker.cpp",
                 "src/worker/read-frame-worker.cpp",
                 "src/worker/receive-frame-worker.cpp",
                 "src/worker/send-frame-worker.cpp",
                 "src/worker/receive-packet-worker.cpp",
                 "src/worker/send-packet-worker.cpp",
+                "src/worker/decode-worker.cpp",
+                "src/worker/encode-worker.cpp",
+                "src/worker/snapshot-worker.cpp",
+                "src/worker/scheduled-worker.cpp",
                 "src/worker/close-worker.cpp",
+                "src/worker/release-worker.cpp",
             ],
             "xcode_settings": {
                 "MACOSX_DEPLOYMENT_TARGET": "12.0",
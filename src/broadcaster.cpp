@@ -0,0 +1,560 @@
+#include "broadcaster.h"
+#include "formatcontext.h"
+#include "packet.h"
+#include "error.h"
+#include "worker/snapshot-worker.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+Napi::FunctionReference AVBroadcasterObject::constructor;
+
+static const size_t DEFAULT_QUEUE_SIZE = 256;
+// bounds the cache when keyframes stop arriving, ie a stream without keyframes on the keyframe stream.
+static const size_t DEFAULT_MAX_CACHED_PACKETS = 2048;
+
+Napi::Object AVBroadcasterObject::Init(Napi::Env env, Napi::Object exports)
+{
+    Napi::HandleScope scope(env);
+
+    Napi::Function func = DefineClass(env, "AVBroadcaster", {
+                                                                InstanceMethod(Napi::Symbol::WellKnown(env, "dispose"), &AVBroadcasterObject::Close),
+                                                                InstanceMethod("write", &AVBroadcasterObject::WriteJS),
+                                                                InstanceMethod("subscribe", &AVBroadcasterObject::Subscribe),
+                                                                InstanceMethod("unsubscribe", &AVBroadcasterObject::Unsubscribe),
+                                                                InstanceMethod("getStats", &AVBroadcasterObject::GetStats),
+                                                                InstanceMethod("snapshot", &AVBroadcasterObject::Snapshot),
+                                                                InstanceMethod("close", &AVBroadcasterObject::Close),
+                                                            });
+
+    constructor = Napi::Persistent(func);
+    constructor.SuppressDestruct();
+
+    exports.Set("AVBroadcaster", func);
+    return exports;
+}
+
+AVBroadcasterObject::AVBroadcasterObject(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<AVBroadcasterObject>(info),
+      keyframeStreamIndex(0), maxCachedPackets(DEFAULT_MAX_CACHED_PACKETS), cacheValid(false), nextId(0), closed(false)
+{
+    if (info.Length() > 0 && info[0].IsObject())
+    {
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (options.Get("keyframeStreamIndex").IsNumber())
+        {
+            keyframeStreamIndex = options.Get("keyframeStreamIndex").As<Napi::Number>().Int32Value();
+        }
+        if (options.Get("maxCachedPackets").IsNumber())
+        {
+            maxCachedPackets = options.Get("maxCachedPackets").As<Napi::Number>().Uint32Value();
+        }
+    }
+}
+
+AVBroadcasterObject::~AVBroadcasterObject()
+{
+    Shutdown();
+}
+
+void AVBroadcasterObject::Shutdown()
+{
+    std::map<int, std::shared_ptr<Subscriber>> stopping;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        stopping.swap(subscribers);
+        ClearCache();
+    }
+    for (auto &pair : stopping)
+    {
+        Stop(pair.second);
+    }
+}
+
+bool AVBroadcasterObject::IsKeyframe(AVPacket *packet)
+{
+    return packet->stream_index == keyframeStreamIndex && (packet->flags & AV_PKT_FLAG_KEY);
+}
+
+void AVBroadcasterObject::ClearCache()
+{
+    for (AVPacket *packet : cache)
+    {
+        av_packet_free(&packet);
+    }
+    cache.clear();
+    cacheValid = false;
+}
+
+void AVBroadcasterObject::Push(Subscriber *subscriber, AVPacket *packet, bool keyframe)
+{
+    std::lock_guard<std::mutex> lock(subscriber->mutex);
+    if (subscriber->stopped)
+    {
+        return;
+    }
+    if (!subscriber->streamMap.empty() && subscriber->streamMap.find(packet->stream_index) == subscriber->streamMap.end())
+    {
+        return;
+    }
+
+    if (subscriber->waitingForKeyframe)
+    {
+        if (!keyframe)
+        {
+            subscriber->dropped++;
+            return;
+        }
+        subscriber->waitingForKeyframe = false;
+    }
+
+    if (subscriber->queue.size() >= subscriber->queueSize)
+    {
+        if (subscriber->dropPolicy == DROP_NEWEST)
+        {
+            subscriber->dropped++;
+            return;
+        }
+
+        if (subscriber->dropPolicy == DROP_OLDEST)
+        {
+            av_packet_free(&subscriber->queue.front());
+            subscriber->queue.pop_front();
+            subscriber->dropped++;
+        }
+        else
+        {
+            subscriber->dropped += subscriber->queue.size();
+            for (AVPacket *queued : subscriber->queue)
+            {
+                av_packet_free(&queued);
+            }
+            subscriber->queue.clear();
+            if (!keyframe)
+            {
+                subscriber->waitingForKeyframe = true;
+                subscriber->dropped++;
+                return;
+            }
+        }
+    }
+
+    AVPacket *clone = av_packet_clone(packet);
+    if (!clone)
+    {
+        subscriber->errors++;
+        return;
+    }
+    subscriber->queue.push_back(clone);
+    subscriber->condition.notify_one();
+}
+
+int AVBroadcasterObject::Write(AVPacket *packet)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closed)
+    {
+        return AVERROR_EOF;
+    }
+
+    bool keyframe = IsKeyframe(packet);
+    if (keyframe)
+    {
+        ClearCache();
+        cacheValid = true;
+    }
+    if (cacheValid)
+    {
+        if (cache.size() >= maxCachedPackets)
+        {
+            ClearCache();
+        }
+        else
+        {
+            AVPacket *clone = av_packet_clone(packet);
+            if (!clone)
+            {
+                return AVERROR(ENOMEM);
+            }
+            cache.push_back(clone);
+        }
+    }
+
+    for (auto &pair : subscribers)
+    {
+        Push(pair.second.get(), packet, keyframe);
+    }
+    return 0;
+}
+
+void AVBroadcasterObject::Run(std::shared_ptr<Subscriber> subscriber)
+{
+    std::unique_lock<std::mutex> lock(subscriber->mutex);
+    while (true)
+    {
+        subscriber->condition.wait(lock, [&]
+                                   { return subscriber->stopped || (!subscriber->queue.empty() && !subscriber->delivering); });
+        if (subscriber->stopped)
+        {
+            break;
+        }
+
+        AVPacket *packet = subscriber->queue.front();
+        subscriber->queue.pop_front();
+
+        if (subscriber->formatContext)
+        {
+            auto it = subscriber->streamMap.find(packet->stream_index);
+            if (it != subscriber->streamMap.end())
+            {
+                packet->stream_index = it->second;
+            }
+
+            // the queue keeps filling while the muxer writes.
+            lock.unlock();
+            int ret = subscriber->formatContext->WritePacket(packet);
+            av_packet_free(&packet);
+            lock.lock();
+
+            if (ret < 0)
+            {
+                subscriber->errors++;
+                subscriber->lastError = AVErrorString(ret);
+            }
+            else
+            {
+                subscriber->sent++;
+            }
+            continue;
+        }
+
+        // wait for js to take this packet before sending the next one, so a busy
+        // event loop backs up into the bounded queue rather than the tsfn queue.
+        subscriber->delivering = true;
+        napi_status status = subscriber->callbackRef.NonBlockingCall([subscriber, packet](Napi::Env env, Napi::Function jsCallback)
+                                                                     {
+            AVPacket *p = packet;
+            bool stopped;
+            {
+                std::lock_guard<std::mutex> lock(subscriber->mutex);
+                stopped = subscriber->stopped;
+            }
+            if (stopped)
+            {
+                av_packet_free(&p);
+            }
+            else
+            {
+                subscriber->sent++;
+                jsCallback.Call({AVPacketObject::NewInstance(env, p)});
+            }
+
+            std::lock_guard<std::mutex> lock(subscriber->mutex);
+            subscriber->delivering = false;
+            subscriber->condition.notify_one(); });
+
+        if (status != napi_ok)
+        {
+            av_packet_free(&packet);
+            subscriber->delivering = false;
+            subscriber->errors++;
+        }
+    }
+}
+
+void AVBroadcasterObject::Stop(std::shared_ptr<Subscriber> subscriber)
+{
+    {
+        std::lock_guard<std::mutex> lock(subscriber->mutex);
+        subscriber->stopped = true;
+        subscriber->condition.notify_one();
+    }
+    if (subscriber->thread.joinable())
+    {
+        subscriber->thread.join();
+    }
+
+    for (AVPacket *packet : subscriber->queue)
+    {
+        av_packet_free(&packet);
+    }
+    subscriber->queue.clear();
+
+    if (!subscriber->formatContext)
+    {
+        subscriber->callbackRef.Release();
+    }
+}
+
+Napi::Value AVBroadcasterObject::WriteJS(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Packet object expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    AVPacketObject *packetObject = Napi::ObjectWrap<AVPacketObject>::Unwrap(info[0].As<Napi::Object>());
+    if (!packetObject->packet)
+    {
+        Napi::Error::New(env, "Packet is null").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int ret = Write(packetObject->packet);
+    if (ret < 0)
+    {
+        Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
+    }
+    return env.Undefined();
+}
+
+Napi::Value AVBroadcasterObject::Subscribe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Object expected for argument 0: options").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    Napi::Value formatContext = options.Get("formatContext");
+    Napi::Value callback = options.Get("callback");
+    if (!formatContext.IsObject() && !callback.IsFunction())
+    {
+        Napi::TypeError::New(env, "formatContext or callback expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::shared_ptr<Subscriber> subscriber = std::make_shared<Subscriber>();
+    subscriber->queueSize = DEFAULT_QUEUE_SIZE;
+    subscriber->dropPolicy = DROP_TO_KEYFRAME;
+    subscriber->waitingForKeyframe = true;
+    subscriber->formatContext = nullptr;
+    subscriber->delivering = false;
+    subscriber->stopped = false;
+    subscriber->sent = 0;
+    subscriber->dropped = 0;
+    subscriber->errors = 0;
+
+    if (options.Get("queueSize").IsNumber())
+    {
+        subscriber->queueSize = std::max(1u, options.Get("queueSize").As<Napi::Number>().Uint32Value());
+    }
+
+    Napi::Value dropPolicy = options.Get("dropPolicy");
+    if (dropPolicy.IsString())
+    {
+        std::string policy = dropPolicy.As<Napi::String>().Utf8Value();
+        if (policy == "keyframe")
+        {
+            subscriber->dropPolicy = DROP_TO_KEYFRAME;
+        }
+        else if (policy == "oldest")
+        {
+            subscriber->dropPolicy = DROP_OLDEST;
+        }
+        else if (policy == "newest")
+        {
+            subscriber->dropPolicy = DROP_NEWEST;
+        }
+        else
+        {
+            Napi::TypeError::New(env, "dropPolicy must be keyframe, oldest or newest").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    Napi::Value streamMap = options.Get("streamMap");
+    if (streamMap.IsObject())
+    {
+        Napi::Object map = streamMap.As<Napi::Object>();
+        Napi::Array keys = map.GetPropertyNames();
+        for (uint32_t i = 0; i < keys.Length(); i++)
+        {
+            Napi::Value key = keys.Get(i);
+            Napi::Value value = map.Get(key);
+            if (!value.IsNumber())
+            {
+                Napi::TypeError::New(env, "streamMap values must be stream indexes").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            std::string name = key.ToString().Utf8Value();
+            char *end;
+            errno = 0;
+            long from = strtol(name.c_str(), &end, 10);
+            if (name.empty() || *end || errno || from < 0 || from > INT_MAX)
+            {
+                Napi::TypeError::New(env, "streamMap keys must be stream indexes").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            subscriber->streamMap[(int)from] = value.As<Napi::Number>().Int32Value();
+        }
+    }
+
+    if (formatContext.IsObject())
+    {
+        subscriber->formatContext = Napi::ObjectWrap<AVFormatContextObject>::Unwrap(formatContext.As<Napi::Object>());
+        if (!subscriber->formatContext->fmt_ctx_ || subscriber->formatContext->is_input)
+        {
+            Napi::Error::New(env, "formatContext must be an output context").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+    else
+    {
+        subscriber->callbackRef = Napi::ThreadSafeFunction::New(
+            env,
+            callback.As<Napi::Function>(),
+            "napi_broadcast_packet",
+            0,
+            1);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed)
+        {
+            if (!subscriber->formatContext)
+            {
+                subscriber->callbackRef.Release();
+            }
+            Napi::Error::New(env, "Broadcaster is closed").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        subscriber->id = nextId++;
+
+        // join at the last keyframe, unless the gop doesn't fit in the queue,
+        // in which case the subscriber waits for the next one.
+        if (cacheValid && !cache.empty() && cache.size() <= subscriber->queueSize)
+        {
+            for (AVPacket *packet : cache)
+            {
+                Push(subscriber.get(), packet, IsKeyframe(packet));
+            }
+        }
+
+        subscribers[subscriber->id] = subscriber;
+        // started under the lock so the subscriber can't be stopped before it has a thread.
+        subscriber->thread = std::thread(&AVBroadcasterObject::Run, subscriber);
+    }
+
+    if (subscriber->formatContext)
+    {
+        formatContextRefs[subscriber->id] = Napi::Persistent(formatContext.As<Napi::Object>());
+    }
+
+    return Napi::Number::New(env, subscriber->id);
+}
+
+Napi::Value AVBroadcasterObject::Unsubscribe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Number expected for argument 0: subscriber id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int id = info[0].As<Napi::Number>().Int32Value();
+    std::shared_ptr<Subscriber> subscriber;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = subscribers.find(id);
+        if (it == subscribers.end())
+        {
+            return Napi::Boolean::New(env, false);
+        }
+        subscriber = it->second;
+        subscribers.erase(it);
+    }
+
+    // waits for a write in progress, after which the muxer may be released.
+    Stop(subscriber);
+    formatContextRefs.erase(id);
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value AVBroadcasterObject::GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    Napi::Object stats = Napi::Object::New(env);
+    Napi::Array subscriberStats = Napi::Array::New(env);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.Set("cachedPackets", Napi::Number::New(env, cache.size()));
+    uint32_t i = 0;
+    for (auto &pair : subscribers)
+    {
+        Subscriber *subscriber = pair.second.get();
+        std::lock_guard<std::mutex> subscriberLock(subscriber->mutex);
+        Napi::Object s = Napi::Object::New(env);
+        s.Set("id", Napi::Number::New(env, subscriber->id));
+        s.Set("queued", Napi::Number::New(env, subscriber->queue.size()));
+        s.Set("sent", Napi::Number::New(env, subscriber->sent));
+        s.Set("dropped", Napi::Number::New(env, subscriber->dropped));
+        s.Set("errors", Napi::Number::New(env, subscriber->errors));
+        s.Set("waitingForKeyframe", Napi::Boolean::New(env, subscriber->waitingForKeyframe));
+        if (!subscriber->lastError.empty())
+        {
+            s.Set("lastError", Napi::String::New(env, subscriber->lastError));
+        }
+        subscriberStats.Set(i++, s);
+    }
+    stats.Set("subscribers", subscriberStats);
+    return stats;
+}
+
+Napi::Value AVBroadcasterObject::Snapshot(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Object expected for argument 0: decoder").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    napi_deferred deferred;
+    napi_value promise;
+    napi_create_promise(env, &deferred, &promise);
+
+    std::vector<AVPacket *> packets;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cacheValid)
+        {
+            for (AVPacket *packet : cache)
+            {
+                if (packet->stream_index != keyframeStreamIndex)
+                {
+                    continue;
+                }
+                AVPacket *clone = av_packet_clone(packet);
+                if (!clone)
+                {
+                    break;
+                }
+                packets.push_back(clone);
+            }
+        }
+    }
+
+    // the worker resolves undefined without packets, ie before the first keyframe.
+    SnapshotWorker *worker = new SnapshotWorker(env, deferred, snapshotMutex, Value(), info[0].As<Napi::Object>(), packets);
+    worker->Queue();
+
+    return Napi::Value(env, promise);
+}
+
+Napi::Value AVBroadcasterObject::Close(const Napi::CallbackInfo &info)
+{
+    Shutdown();
+    formatContextRefs.clear();
+    return info.Env().Undefined();
+}
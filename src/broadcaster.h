@@ -0,0 +1,103 @@
+#pragma once
+
+#include <napi.h>
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class AVFormatContextObject;
+
+// Fans out the packets of one encoder or demuxer to any number of subscribers,
+// ie muxers serving separate viewers or a recorder, without encoding per viewer.
+// Packets are shared by reference. Each subscriber has its own bounded queue and
+// delivery thread, so a slow subscriber only drops its own packets.
+// The packets since the last keyframe are cached so a new subscriber starts
+// at that keyframe rather than waiting for the next one.
+class AVBroadcasterObject : public Napi::ObjectWrap<AVBroadcasterObject>
+{
+public:
+    enum DropPolicy
+    {
+        // discard the queue and resume at the next keyframe, the decoder never sees a gap.
+        DROP_TO_KEYFRAME,
+        DROP_OLDEST,
+        DROP_NEWEST,
+    };
+
+    struct Subscriber
+    {
+        int id;
+        size_t queueSize;
+        DropPolicy dropPolicy;
+        // set until the subscriber can start, or resume after dropping, at a keyframe.
+        bool waitingForKeyframe;
+
+        // muxer sink, packets are written from the subscriber thread.
+        AVFormatContextObject *formatContext;
+        std::map<int, int> streamMap;
+        // callback sink, one packet is in flight to js at a time.
+        Napi::ThreadSafeFunction callbackRef;
+        bool delivering;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<AVPacket *> queue;
+        bool stopped;
+        std::thread thread;
+
+        std::atomic<uint64_t> sent;
+        std::atomic<uint64_t> dropped;
+        std::atomic<uint64_t> errors;
+        std::string lastError;
+    };
+
+    static Napi::FunctionReference constructor;
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+    AVBroadcasterObject(const Napi::CallbackInfo &info);
+    ~AVBroadcasterObject();
+
+    // may be called from any thread, ie a read frame worker. the packet is referenced, not taken.
+    int Write(AVPacket *packet);
+
+private:
+    Napi::Value WriteJS(const Napi::CallbackInfo &info);
+    Napi::Value Subscribe(const Napi::CallbackInfo &info);
+    Napi::Value Unsubscribe(const Napi::CallbackInfo &info);
+    Napi::Value GetStats(const Napi::CallbackInfo &info);
+    Napi::Value Snapshot(const Napi::CallbackInfo &info);
+    Napi::Value Close(const Napi::CallbackInfo &info);
+
+    bool IsKeyframe(AVPacket *packet);
+    void ClearCache();
+    static void Push(Subscriber *subscriber, AVPacket *packet, bool keyframe);
+    static void Run(std::shared_ptr<Subscriber> subscriber);
+    void Stop(std::shared_ptr<Subscriber> subscriber);
+    void Shutdown();
+
+    int keyframeStreamIndex;
+    size_t maxCachedPackets;
+
+    std::mutex mutex;
+    std::vector<AVPacket *> cache;
+    // the cache holds a complete gop, ie it starts at a keyframe.
+    bool cacheValid;
+    int nextId;
+    std::map<int, std::shared_ptr<Subscriber>> subscribers;
+    // keeps muxer sinks alive while subscribed, only touched on the js thread.
+    std::map<int, Napi::ObjectReference> formatContextRefs;
+    bool closed;
+    // snapshots of this broadcaster share a decoder.
+    std::mutex snapshotMutex;
+};
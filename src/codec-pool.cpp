@@ -0,0 +1,228 @@
+#include "codec-pool.h"
+
+extern "C"
+{
+#include <libavutil/mem.h>
+#include <libavutil/opt.h>
+#include <libavutil/time.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <thread>
+
+CodecPool::CodecPool()
+    : capacity(0), idleTimeout(60 * AV_TIME_BASE), running(false), hits(0), misses(0), evictions(0)
+{
+}
+
+// never destroyed, the eviction thread may outlive static destruction.
+CodecPool &CodecPool::Instance()
+{
+    static CodecPool *pool = new CodecPool();
+    return *pool;
+}
+
+void CodecPool::Init(Napi::Env env, Napi::Object exports)
+{
+    exports.Set(Napi::String::New(env, "setCodecPoolLimits"), Napi::Function::New(env, SetLimits));
+    exports.Set(Napi::String::New(env, "getCodecPoolStats"), Napi::Function::New(env, GetStats));
+}
+
+std::string CodecPool::DecoderKey(const AVCodec *codec, const AVCodecParameters *codecpar, AVHWDeviceType hwDeviceType, const std::string &deviceName,
+                                  const std::string &settings)
+{
+    std::string key = std::string("decoder:") + codec->name +
+                      ":" + std::to_string(hwDeviceType) + ":" + deviceName + ":" + settings +
+                      ":" + std::to_string(codecpar->width) + "x" + std::to_string(codecpar->height) +
+                      ":" + std::to_string(codecpar->format) +
+                      ":" + std::to_string(codecpar->sample_rate) + ":" + std::to_string(codecpar->ch_layout.nb_channels) +
+                      ":" + std::to_string(codecpar->codec_tag) + ":";
+    // ie the parameter sets, a decoder configured from other ones may not decode the stream.
+    if (codecpar->extradata)
+    {
+        key.append((const char *)codecpar->extradata, codecpar->extradata_size);
+    }
+    return key;
+}
+
+std::string CodecPool::EncoderKey(const AVCodecContext *c)
+{
+    std::string key = std::string("encoder:") + c->codec->name +
+                      ":" + std::to_string(c->width) + "x" + std::to_string(c->height) +
+                      ":" + std::to_string(c->pix_fmt) + ":" + std::to_string(c->sample_fmt) +
+                      ":" + std::to_string(c->sample_rate) + ":" + std::to_string(c->ch_layout.nb_channels) +
+                      ":" + std::to_string(c->time_base.num) + "/" + std::to_string(c->time_base.den) +
+                      ":" + std::to_string(c->framerate.num) + "/" + std::to_string(c->framerate.den) +
+                      ":" + std::to_string(c->bit_rate) + ":" + std::to_string(c->rc_max_rate) +
+                      ":" + std::to_string(c->rc_min_rate) + ":" + std::to_string(c->rc_buffer_size) +
+                      ":" + std::to_string(c->flags) + ":" + std::to_string(c->profile) +
+                      ":" + std::to_string(c->gop_size) + ":" + std::to_string(c->keyint_min) +
+                      // hardware encoders only take frames from the frames context they were opened with.
+                      ":" + std::to_string((uintptr_t)(c->hw_frames_ctx ? c->hw_frames_ctx->data : nullptr)) + ":";
+
+    char *options = nullptr;
+    if (c->priv_data && av_opt_serialize(c->priv_data, 0, AV_OPT_SERIALIZE_SKIP_DEFAULTS, &options, '=', ',') >= 0 && options)
+    {
+        key += options;
+    }
+    av_free(options);
+    return key;
+}
+
+AVCodecContext *CodecPool::Acquire(const std::string &key)
+{
+    CodecPool &pool = Instance();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (!pool.capacity)
+    {
+        return nullptr;
+    }
+
+    // the most recently released is the warmest.
+    for (auto it = pool.idle.rbegin(); it != pool.idle.rend(); it++)
+    {
+        if (it->key == key)
+        {
+            AVCodecContext *codecContext = it->codecContext;
+            pool.idle.erase(std::next(it).base());
+            pool.hits++;
+            return codecContext;
+        }
+    }
+    pool.misses++;
+    return nullptr;
+}
+
+bool CodecPool::Release(const std::string &key, AVCodecContext *codecContext)
+{
+    CodecPool &pool = Instance();
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (!pool.capacity)
+        {
+            return false;
+        }
+    }
+
+    // an encoder that can't be flushed would hand its buffered frames to the next user.
+    if (av_codec_is_encoder(codecContext->codec) && (codecContext->codec->capabilities & AV_CODEC_CAP_DELAY))
+    {
+#ifdef AV_CODEC_CAP_ENCODER_FLUSH
+        if (!(codecContext->codec->capabilities & AV_CODEC_CAP_ENCODER_FLUSH))
+#endif
+        {
+            return false;
+        }
+    }
+    avcodec_flush_buffers(codecContext);
+    // set per user, ie by a keyframes only output rate.
+    codecContext->skip_frame = AVDISCARD_DEFAULT;
+
+    std::list<Entry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        int64_t now = av_gettime_relative();
+        pool.idle.push_back({key, codecContext, now});
+        pool.Evict(now, evicted);
+        if (!pool.running)
+        {
+            pool.running = true;
+            std::thread(&CodecPool::Run, &pool).detach();
+        }
+    }
+    pool.condition.notify_one();
+    Free(evicted);
+    return true;
+}
+
+void CodecPool::Evict(int64_t now, std::list<Entry> &evicted)
+{
+    while (!idle.empty() && (idle.size() > capacity || now - idle.front().released >= idleTimeout))
+    {
+        evicted.splice(evicted.end(), idle, idle.begin());
+        evictions++;
+    }
+}
+
+void CodecPool::Free(std::list<Entry> &entries)
+{
+    for (Entry &entry : entries)
+    {
+        avcodec_free_context(&entry.codecContext);
+    }
+    entries.clear();
+}
+
+// frees contexts once they have been idle for the timeout.
+void CodecPool::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        std::list<Entry> evicted;
+        Evict(av_gettime_relative(), evicted);
+        if (!evicted.empty())
+        {
+            lock.unlock();
+            Free(evicted);
+            lock.lock();
+            continue;
+        }
+
+        if (idle.empty())
+        {
+            condition.wait(lock);
+        }
+        else
+        {
+            int64_t wait = idle.front().released + idleTimeout - av_gettime_relative();
+            condition.wait_for(lock, std::chrono::microseconds(std::max((int64_t)0, wait)));
+        }
+    }
+}
+
+Napi::Value CodecPool::SetLimits(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Object expected for argument 0: limits").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    CodecPool &pool = Instance();
+    Napi::Object limits = info[0].As<Napi::Object>();
+    std::list<Entry> evicted;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (limits.Get("capacity").IsNumber())
+        {
+            pool.capacity = std::max(0, limits.Get("capacity").As<Napi::Number>().Int32Value());
+        }
+        if (limits.Get("idleTimeout").IsNumber())
+        {
+            pool.idleTimeout = std::max((int64_t)0, (int64_t)(limits.Get("idleTimeout").As<Napi::Number>().DoubleValue() * AV_TIME_BASE));
+        }
+        pool.Evict(av_gettime_relative(), evicted);
+    }
+    pool.condition.notify_one();
+    Free(evicted);
+    return env.Undefined();
+}
+
+Napi::Value CodecPool::GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    CodecPool &pool = Instance();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("capacity", Napi::Number::New(env, pool.capacity));
+    stats.Set("idleTimeout", Napi::Number::New(env, (double)pool.idleTimeout / AV_TIME_BASE));
+    stats.Set("idle", Napi::Number::New(env, pool.idle.size()));
+    stats.Set("hits", Napi::Number::New(env, pool.hits));
+    stats.Set("misses", Napi::Number::New(env, pool.misses));
+    stats.Set("evictions", Napi::Number::New(env, pool.evictions));
+    return stats;
+}
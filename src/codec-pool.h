@@ -0,0 +1,66 @@
+#pragma once
+
+#include <napi.h>
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+
+// Keeps released codec contexts open and flushed, and hands them out again for
+// the same configuration, so a viewer that comes back doesn't pay for
+// avcodec_open2 and device setup again. Disabled until a capacity is set.
+// Contexts idle for longer than the idle timeout are freed on a background
+// thread, the least recently released go first when the pool is full.
+class CodecPool
+{
+public:
+    static void Init(Napi::Env env, Napi::Object exports);
+
+    // the configuration a decoder for these parameters would be opened with.
+    // settings describes the decoder options, ie threading.
+    static std::string DecoderKey(const AVCodec *codec, const AVCodecParameters *codecpar, AVHWDeviceType hwDeviceType, const std::string &deviceName,
+                                  const std::string &settings);
+    // the configuration of an encoder that is set up but not opened yet.
+    static std::string EncoderKey(const AVCodecContext *codecContext);
+
+    // an open context released with the same key, or null.
+    static AVCodecContext *Acquire(const std::string &key);
+    // flushes and keeps the context. false if the pool won't take it, the caller then frees it.
+    static bool Release(const std::string &key, AVCodecContext *codecContext);
+
+private:
+    struct Entry
+    {
+        std::string key;
+        AVCodecContext *codecContext;
+        int64_t released;
+    };
+
+    static CodecPool &Instance();
+    static Napi::Value SetLimits(const Napi::CallbackInfo &info);
+    static Napi::Value GetStats(const Napi::CallbackInfo &info);
+
+    CodecPool();
+    void Run();
+    // moves what is over capacity or idle too long into evicted, to be freed without the lock.
+    void Evict(int64_t now, std::list<Entry> &evicted);
+    static void Free(std::list<Entry> &entries);
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    // least recently released first.
+    std::list<Entry> idle;
+    size_t capacity;
+    // microseconds.
+    int64_t idleTimeout;
+    bool running;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+};
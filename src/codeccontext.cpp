@@ -9,6 +9,7 @@ extern "C"
 #include <libavfilter/buffersrc.h>
 #include <libavfilter/avfilter.h>
 #include <libavutil/opt.h>
+#include <libavutil/time.h>
 
 #ifdef __linux__
 #include <libavutil/hwcontext_vaapi.h>
@@ -22,9 +23,14 @@ extern "C"
 #include "packet.h"
 #include "error.h"
 #include "codeccontext.h"
+#include "codec-pool.h"
 #include "frame.h"
+#include "output-rate.h"
+#include "worker/decode-worker.h"
+#include "worker/encode-worker.h"
 #include "worker/receive-frame-worker.h"
 #include "worker/receive-packet-worker.h"
+#include "worker/release-worker.h"
 #include "worker/send-frame-worker.h"
 #include "worker/send-packet-worker.h"
 
@@ -33,7 +39,14 @@ Napi::FunctionReference AVCodecContextObject::constructor;
 AVCodecContextObject::AVCodecContextObject(const Napi::CallbackInfo &info)
     : Napi::ObjectWrap<AVCodecContextObject>(info),
       codecContext(nullptr),
-      hw_device_value(AV_HWDEVICE_TYPE_NONE)
+      hw_device_value(AV_HWDEVICE_TYPE_NONE),
+      priority(JobScheduler::PRIORITY_LIVE),
+      pipelineUses(0),
+      skippingNonKey(false),
+      savedSkipFrame(AVDISCARD_DEFAULT),
+      reconfigurePending(false),
+      pendingRate{-1, -1, -1},
+      keyframePending(false)
 {
     // i don't think this constructor is called from js??
 }
@@ -44,13 +57,43 @@ AVCodecContextObject::~AVCodecContextObject()
 
 Napi::Value AVCodecContextObject::Destroy(const Napi::CallbackInfo &info)
 {
-    if (codecContext)
+    Napi::Env env = info.Env();
+    if (!codecContext)
     {
-        avcodec_free_context(&codecContext);
-        codecContext = nullptr;
+        return env.Undefined();
+    }
+
+    // a pooled context would be handed to the next user while the pipeline still decodes with it.
+    if (pipelineUses)
+    {
+        Napi::Error::New(env, "Codec is in use by a pipeline").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (executor.Idle())
+    {
+        ReleaseContext();
     }
+    else
+    {
+        // after the calls already queued, which still use the context.
+        ReleaseWorker *worker = new ReleaseWorker(env, this);
+        worker->Queue();
+    }
+    return env.Undefined();
+}
 
-    return info.Env().Undefined();
+void AVCodecContextObject::ReleaseContext()
+{
+    if (!codecContext)
+    {
+        return;
+    }
+    if (poolKey.empty() || pipelineUses || !CodecPool::Release(poolKey, codecContext))
+    {
+        avcodec_free_context(&codecContext);
+    }
+    codecContext = nullptr;
 }
 
 Napi::Object AVCodecContextObject::Init(Napi::Env env, Napi::Object exports)
@@ -75,6 +118,8 @@ Napi::Object AVCodecContextObject::Init(Napi::Env env, Napi::Object exports)
 
                                                                        AVCodecContextObject::InstanceAccessor("gopSize", &AVCodecContextObject::GetGopSize, &AVCodecContextObject::SetGopSize),
 
+                                                                       AVCodecContextObject::InstanceAccessor("priority", &AVCodecContextObject::GetPriority, &AVCodecContextObject::SetPriority),
+
                                                                        InstanceMethod(Napi::Symbol::WellKnown(env, "dispose"), &AVCodecContextObject::Destroy),
 
                                                                        InstanceMethod("destroy", &AVCodecContextObject::Destroy),
@@ -86,6 +131,22 @@ Napi::Object AVCodecContextObject::Init(Napi::Env env, Napi::Object exports)
                                                                        InstanceMethod("sendFrame", &AVCodecContextObject::SendFrame),
 
                                                                        InstanceMethod("receivePacket", &AVCodecContextObject::ReceivePacket),
+
+                                                                       InstanceMethod("decode", &AVCodecContextObject::Decode),
+
+                                                                       InstanceMethod("flush", &AVCodecContextObject::Flush),
+
+                                                                       InstanceMethod("encodeTo", &AVCodecContextObject::EncodeTo),
+
+                                                                       InstanceMethod("reconfigure", &AVCodecContextObject::Reconfigure),
+
+                                                                       InstanceMethod("requestKeyframe", &AVCodecContextObject::RequestKeyframe),
+
+                                                                       InstanceMethod("setOutputRate", &AVCodecContextObject::SetOutputRate),
+
+                                                                       InstanceMethod("getOutputRateStats", &AVCodecContextObject::GetOutputRateStats),
+
+                                                                       InstanceMethod("getDecodeStats", &AVCodecContextObject::GetDecodeStats),
                                                                    });
 
     constructor = Napi::Persistent(func);
@@ -129,7 +190,7 @@ Napi::Value AVCodecContextObject::ReceivePacket(const Napi::CallbackInfo &info)
     napi_create_promise(env, &deferred, &promise);
 
     // Create and queue the AsyncWorker, passing the deferred handle
-    ReceivePacketWorker *worker = new ReceivePacketWorker(env, deferred, codecContext);
+    ReceivePacketWorker *worker = new ReceivePacketWorker(env, deferred, this);
     worker->Queue();
 
     // Return the promise to JavaScript
@@ -184,6 +245,115 @@ Napi::Value AVCodecContextObject::SendFrame(const Napi::CallbackInfo &info)
     return Napi::Value(env, promise);
 }
 
+Napi::Value AVCodecContextObject::Decode(const Napi::CallbackInfo &info)
+{
+    if (!info.Length() || !info[0].IsObject())
+    {
+        Napi::TypeError::New(info.Env(), "Packet object expected").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+    }
+
+    AVPacketObject *packet = Napi::ObjectWrap<AVPacketObject>::Unwrap(info[0].As<Napi::Object>());
+
+    Napi::Env env = info.Env();
+    napi_deferred deferred;
+    napi_value promise;
+    napi_create_promise(env, &deferred, &promise);
+
+    DecodeWorker *worker = new DecodeWorker(env, deferred, this, packet);
+    worker->Queue();
+
+    return Napi::Value(env, promise);
+}
+
+Napi::Value AVCodecContextObject::Flush(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    napi_deferred deferred;
+    napi_value promise;
+    napi_create_promise(env, &deferred, &promise);
+
+    // no packet drains the decoder.
+    DecodeWorker *worker = new DecodeWorker(env, deferred, this, nullptr);
+    worker->Queue();
+
+    return Napi::Value(env, promise);
+}
+
+Napi::Value AVCodecContextObject::EncodeTo(const Napi::CallbackInfo &info)
+{
+    // arguments are frame, frames or null, write context and stream index
+    Napi::Env env = info.Env();
+    if (info.Length() < 3 || !info[1].IsObject() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Frame, array of frames or null expected for argument 0, write context for argument 1 and stream index for argument 2").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!codecContext || !av_codec_is_encoder(codecContext->codec))
+    {
+        Napi::Error::New(env, "EncodeTo requires an encoder").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // checked up front, a bad stream would only fail after the frames were encoded.
+    AVFormatContextObject *writeContext = Napi::ObjectWrap<AVFormatContextObject>::Unwrap(info[1].As<Napi::Object>());
+    int streamIndex = info[2].As<Napi::Number>().Int32Value();
+    if (!writeContext || !writeContext->fmt_ctx_ || writeContext->is_input || !writeContext->headerWritten || writeContext->trailerWritten)
+    {
+        Napi::Error::New(env, "EncodeTo requires an output context with its header written").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (streamIndex < 0 || (unsigned int)streamIndex >= writeContext->fmt_ctx_->nb_streams)
+    {
+        Napi::Error::New(env, "Invalid stream index").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // only null or undefined drains, an empty batch sends nothing.
+    bool drain = info[0].IsNull() || info[0].IsUndefined();
+    std::vector<Napi::Value> values;
+    if (info[0].IsArray())
+    {
+        Napi::Array array = info[0].As<Napi::Array>();
+        for (uint32_t i = 0; i < array.Length(); i++)
+        {
+            values.push_back(array.Get(i));
+        }
+    }
+    else if (!drain)
+    {
+        values.push_back(info[0]);
+    }
+
+    // the frames are referenced now, js may reuse or destroy them before the worker runs.
+    std::vector<AVFrame *> frames;
+    for (Napi::Value value : values)
+    {
+        AVFrameObject *frameObject = value.IsObject() ? Napi::ObjectWrap<AVFrameObject>::Unwrap(value.As<Napi::Object>()) : nullptr;
+        AVFrame *frame = frameObject && frameObject->frame_ ? av_frame_clone(frameObject->frame_) : nullptr;
+        if (!frame)
+        {
+            for (AVFrame *f : frames)
+            {
+                av_frame_free(&f);
+            }
+            Napi::Error::New(env, "EncodeTo received null frame").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        frames.push_back(frame);
+    }
+
+    napi_deferred deferred;
+    napi_value promise;
+    napi_create_promise(env, &deferred, &promise);
+
+    EncodeWorker *worker = new EncodeWorker(env, deferred, this, std::move(frames), drain, info[1].As<Napi::Object>(), streamIndex);
+    worker->Queue();
+
+    return Napi::Value(env, promise);
+}
+
 Napi::Value AVCodecContextObject::GetHardwareDevice(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -363,3 +533,300 @@ void AVCodecContextObject::SetGopSize(const Napi::CallbackInfo &info, const Napi
 
     codecContext->gop_size = value.As<Napi::Number>().Int32Value();
 }
+
+bool AVCodecContextObject::AcceptFrame(AVFrame *frame)
+{
+    decodeLatency.Received(frame->pts, av_gettime_relative());
+
+    std::shared_ptr<OutputRate> rate;
+    {
+        std::lock_guard<std::mutex> lock(outputRateMutex);
+        rate = outputRate;
+    }
+    if (!rate)
+    {
+        return true;
+    }
+    return rate->Accept(frame, codecContext->pkt_timebase);
+}
+
+Napi::Value AVCodecContextObject::SetOutputRate(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (!codecContext || !av_codec_is_decoder(codecContext->codec))
+    {
+        Napi::Error::New(env, "Output rate requires a decoder").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::shared_ptr<OutputRate> rate;
+    if (info.Length() > 0 && info[0].IsObject())
+    {
+        Napi::Object options = info[0].As<Napi::Object>();
+        OutputRate::Policy policy = {};
+        if (options.Get("maxFps").IsNumber())
+        {
+            policy.maxFps = options.Get("maxFps").As<Napi::Number>().DoubleValue();
+        }
+        if (options.Get("everyNth").IsNumber())
+        {
+            policy.everyNth = options.Get("everyNth").As<Napi::Number>().Int32Value();
+        }
+        if (options.Get("minPtsInterval").IsNumber())
+        {
+            policy.minPtsInterval = options.Get("minPtsInterval").As<Napi::Number>().DoubleValue();
+        }
+        policy.keyframesOnly = options.Get("keyframesOnly").ToBoolean();
+        rate = std::make_shared<OutputRate>(policy);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(outputRateMutex);
+        outputRate = rate;
+    }
+
+    return env.Undefined();
+}
+
+Napi::Value AVCodecContextObject::GetOutputRateStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    std::shared_ptr<OutputRate> rate;
+    {
+        std::lock_guard<std::mutex> lock(outputRateMutex);
+        rate = outputRate;
+    }
+    if (!rate)
+    {
+        return env.Undefined();
+    }
+
+    uint64_t accepted, dropped;
+    rate->GetStats(&accepted, &dropped);
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("accepted", Napi::Number::New(env, accepted));
+    stats.Set("dropped", Napi::Number::New(env, dropped));
+    return stats;
+}
+
+void AVCodecContextObject::ApplySkipFrame()
+{
+    bool keyframesOnly;
+    {
+        std::lock_guard<std::mutex> lock(outputRateMutex);
+        keyframesOnly = outputRate && outputRate->policy.keyframesOnly;
+    }
+
+    // don't decode frames that would be dropped, where the decoder supports it.
+    if (keyframesOnly && !skippingNonKey)
+    {
+        savedSkipFrame = codecContext->skip_frame;
+        codecContext->skip_frame = AVDISCARD_NONKEY;
+        skippingNonKey = true;
+    }
+    else if (!keyframesOnly && skippingNonKey)
+    {
+        codecContext->skip_frame = savedSkipFrame;
+        skippingNonKey = false;
+    }
+}
+
+int AVCodecContextObject::DecodePacket(AVPacket *packet)
+{
+    ApplySkipFrame();
+    int64_t time = av_gettime_relative();
+    int ret = avcodec_send_packet(codecContext, packet);
+    if (!ret && packet)
+    {
+        decodeLatency.Sent(packet->pts, time);
+    }
+    return ret;
+}
+
+Napi::Value AVCodecContextObject::GetDecodeStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!codecContext || !av_codec_is_decoder(codecContext->codec))
+    {
+        return env.Undefined();
+    }
+
+    DecodeLatency::Stats latency = decodeLatency.GetStats();
+    Napi::Object stats = Napi::Object::New(env);
+    if (decoderProfile.length())
+    {
+        stats.Set("profile", Napi::String::New(env, decoderProfile));
+    }
+    // what the decoder ended up using, ie frame threads fall back to none for a single thread.
+    const char *threadType = "none";
+    if (codecContext->active_thread_type & FF_THREAD_FRAME)
+    {
+        threadType = "frame";
+    }
+    else if (codecContext->active_thread_type & FF_THREAD_SLICE)
+    {
+        threadType = "slice";
+    }
+    stats.Set("threads", Napi::Number::New(env, codecContext->thread_count));
+    stats.Set("threadType", Napi::String::New(env, threadType));
+    stats.Set("frames", Napi::Number::New(env, latency.frames));
+    stats.Set("averageLatency", Napi::Number::New(env, latency.frames ? (double)latency.total / latency.frames / 1000 : 0));
+    stats.Set("maxLatency", Napi::Number::New(env, (double)latency.max / 1000));
+    stats.Set("lastLatency", Napi::Number::New(env, (double)latency.last / 1000));
+    return stats;
+}
+
+Napi::Value AVCodecContextObject::GetPriority(const Napi::CallbackInfo &info)
+{
+    return Napi::String::New(info.Env(), JobScheduler::PriorityName(priority));
+}
+
+void AVCodecContextObject::SetPriority(const Napi::CallbackInfo &info, const Napi::Value &value)
+{
+    JobScheduler::ParsePriority(info.Env(), value, &priority);
+}
+
+// encoders that compare their rate control settings to the codec context at every
+// frame and apply a change in place. the change keeps the stream's parameter sets,
+// so extradata already written by a global header muxer stays valid. the others
+// would have to be reopened, which can't be done under a thread that is encoding,
+// so reconfigure rejects them.
+static const char *LIVE_RECONFIGURE_ENCODERS[] = {
+    "libx264",
+    "h264_nvenc",
+    "hevc_nvenc",
+    "av1_nvenc",
+    "h264_qsv",
+    "hevc_qsv",
+};
+
+static bool reconfiguresLive(const AVCodec *codec)
+{
+    for (const char *name : LIVE_RECONFIGURE_ENCODERS)
+    {
+        if (!strcmp(codec->name, name))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void applyRateControl(AVCodecContext *c, int64_t bitrate, int64_t maxRate, int bufSize)
+{
+    if (bitrate >= 0)
+    {
+        c->bit_rate = bitrate;
+    }
+    if (maxRate >= 0)
+    {
+        c->rc_max_rate = maxRate;
+    }
+    if (bufSize >= 0)
+    {
+        c->rc_buffer_size = bufSize;
+    }
+}
+
+int AVCodecContextObject::EncodeFrame(AVFrame *frame)
+{
+    // nothing to apply when draining.
+    if (frame)
+    {
+        bool reconfigure;
+        RateControl rate;
+        bool keyframe;
+        {
+            std::lock_guard<std::mutex> lock(encoderUpdateMutex);
+            reconfigure = reconfigurePending;
+            rate = pendingRate;
+            keyframe = keyframePending;
+            reconfigurePending = false;
+            pendingRate = {-1, -1, -1};
+            keyframePending = false;
+        }
+
+        if (reconfigure)
+        {
+            applyRateControl(codecContext, rate.bitrate, rate.maxRate, rate.bufSize);
+        }
+
+        if (keyframe)
+        {
+            frame->pict_type = AV_PICTURE_TYPE_I;
+#ifdef AV_FRAME_FLAG_KEY
+            frame->flags |= AV_FRAME_FLAG_KEY;
+#endif
+        }
+    }
+
+    return avcodec_send_frame(codecContext, frame);
+}
+
+Napi::Value AVCodecContextObject::Reconfigure(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (!codecContext || !av_codec_is_encoder(codecContext->codec))
+    {
+        Napi::Error::New(env, "Reconfigure requires an encoder").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!reconfiguresLive(codecContext->codec))
+    {
+        std::string message = std::string("Encoder ") + codecContext->codec->name + " can't change rate control while encoding";
+        Napi::Error::New(env, message).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Object expected for argument 0: options").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    Napi::Value bitrate = options.Get("bitrate");
+    Napi::Value maxRate = options.Get("maxRate");
+    Napi::Value bufSize = options.Get("bufSize");
+
+    // the encoder no longer matches the configuration it was created with.
+    poolKey.clear();
+
+    // later calls before the next frame override earlier ones, per setting.
+    {
+        std::lock_guard<std::mutex> lock(encoderUpdateMutex);
+        if (bitrate.IsNumber())
+        {
+            pendingRate.bitrate = bitrate.As<Napi::Number>().Int64Value();
+        }
+        if (maxRate.IsNumber())
+        {
+            pendingRate.maxRate = maxRate.As<Napi::Number>().Int64Value();
+        }
+        if (bufSize.IsNumber())
+        {
+            pendingRate.bufSize = bufSize.As<Napi::Number>().Int32Value();
+        }
+        reconfigurePending = true;
+    }
+
+    return env.Undefined();
+}
+
+Napi::Value AVCodecContextObject::RequestKeyframe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (!codecContext || !av_codec_is_encoder(codecContext->codec))
+    {
+        Napi::Error::New(env, "Keyframe request requires an encoder").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::lock_guard<std::mutex> lock(encoderUpdateMutex);
+    keyframePending = true;
+    return env.Undefined();
+}
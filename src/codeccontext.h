@@ -13,8 +13,17 @@ extern "C"
 #include <libavutil/opt.h>
 }
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
 
+#include "decode-latency.h"
+#include "worker/scheduled-worker.h"
+
+class OutputRate;
+
 
 class AVCodecContextObject : public Napi::ObjectWrap<AVCodecContextObject>
 {
@@ -30,12 +39,36 @@ public:
     int videoStreamIndex;
     AVCodecContext *codecContext;
     enum AVHWDeviceType hw_device_value;
+    // class of the workers of this codec.
+    JobScheduler::Priority priority;
+    // orders the workers of this codec.
+    SerialExecutor executor;
+    // the configuration the context is returned to the codec pool under on destroy, empty to free it.
+    std::string poolKey;
+    // pipelines and stream worker packets referencing the codec, it can't be destroyed meanwhile.
+    std::atomic<int> pipelineUses;
+    // the decoder profile it was created with, if any.
+    std::string decoderProfile;
+
+    // false if the decoder's output rate policy drops the frame. also records its decode latency.
+    bool AcceptFrame(AVFrame *frame);
+    // sends a packet to the decoder, recording when for the decode latency.
+    int DecodePacket(AVPacket *packet);
+    // applies the skip_frame of the output rate policy. called by whichever thread is decoding.
+    void ApplySkipFrame();
+    // sends a frame to the encoder, first applying a pending reconfigure or
+    // keyframe request. called by whichever thread is encoding.
+    int EncodeFrame(AVFrame *frame);
+    // returns the context to the codec pool, or frees it. no call of the codec may be running.
+    void ReleaseContext();
 
 private:
     Napi::Value GetKeyIntMin(const Napi::CallbackInfo &info);
     void SetKeyIntMin(const Napi::CallbackInfo &info, const Napi::Value &value);
     Napi::Value GetGopSize(const Napi::CallbackInfo &info);
     void SetGopSize(const Napi::CallbackInfo &info, const Napi::Value &value);
+    Napi::Value GetPriority(const Napi::CallbackInfo &info);
+    void SetPriority(const Napi::CallbackInfo &info, const Napi::Value &value);
     Napi::Value GetTimeBaseNum(const Napi::CallbackInfo &info);
     Napi::Value GetTimeBaseDen(const Napi::CallbackInfo &info);
     Napi::Value GetHardwareDevice(const Napi::CallbackInfo &info);
@@ -46,5 +79,36 @@ private:
     Napi::Value ReceivePacket(const Napi::CallbackInfo &info);
     Napi::Value SendPacket(const Napi::CallbackInfo &info);
     Napi::Value SendFrame(const Napi::CallbackInfo &info);
+    Napi::Value Decode(const Napi::CallbackInfo &info);
+    Napi::Value Flush(const Napi::CallbackInfo &info);
+    Napi::Value EncodeTo(const Napi::CallbackInfo &info);
     Napi::Value Destroy(const Napi::CallbackInfo &info);
+    Napi::Value SetOutputRate(const Napi::CallbackInfo &info);
+    Napi::Value GetOutputRateStats(const Napi::CallbackInfo &info);
+    Napi::Value GetDecodeStats(const Napi::CallbackInfo &info);
+    Napi::Value Reconfigure(const Napi::CallbackInfo &info);
+    Napi::Value RequestKeyframe(const Napi::CallbackInfo &info);
+
+    // in bits per second, -1 leaves the current value.
+    struct RateControl
+    {
+        int64_t bitrate;
+        int64_t maxRate;
+        int bufSize;
+    };
+
+    // replaced from js while workers apply it.
+    std::shared_ptr<OutputRate> outputRate;
+    std::mutex outputRateMutex;
+    // decoding thread only: whether skip_frame was set for a keyframes only policy,
+    // and the value it replaced, which is restored when the policy is cleared.
+    bool skippingNonKey;
+    enum AVDiscard savedSkipFrame;
+    DecodeLatency decodeLatency;
+
+    // set from js, applied at the next frame sent to the encoder.
+    std::mutex encoderUpdateMutex;
+    bool reconfigurePending;
+    RateControl pendingRate;
+    bool keyframePending;
 };
@@ -0,0 +1,60 @@
+#include "decode-latency.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+}
+
+#include <algorithm>
+
+// enough for the reordering and frame threading delay of any decoder.
+static const size_t MAX_SENT = 128;
+
+DecodeLatency::DecodeLatency()
+    : stats{0, 0, 0, 0}
+{
+}
+
+void DecodeLatency::Sent(int64_t pts, int64_t time)
+{
+    if (pts == AV_NOPTS_VALUE)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    sent.push_back({pts, time});
+    if (sent.size() > MAX_SENT)
+    {
+        sent.pop_front();
+    }
+}
+
+void DecodeLatency::Received(int64_t pts, int64_t time)
+{
+    if (pts == AV_NOPTS_VALUE)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(sent.begin(), sent.end(), [pts](const Entry &entry)
+                           { return entry.pts == pts; });
+    if (it == sent.end())
+    {
+        return;
+    }
+
+    int64_t latency = time - it->time;
+    sent.erase(it);
+    stats.frames++;
+    stats.total += latency;
+    stats.max = std::max(stats.max, latency);
+    stats.last = latency;
+}
+
+DecodeLatency::Stats DecodeLatency::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
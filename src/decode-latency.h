@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// Measures the time from sending a packet to a decoder until the frame with
+// its pts comes out, which includes the decoder's reordering and threading
+// delay. Frames without a pts, or whose packet was sent elsewhere, ie by a
+// snapshot, are not counted. Times are in microseconds.
+class DecodeLatency
+{
+public:
+    struct Stats
+    {
+        uint64_t frames;
+        int64_t total;
+        int64_t max;
+        int64_t last;
+    };
+
+    DecodeLatency();
+
+    void Sent(int64_t pts, int64_t time);
+    void Received(int64_t pts, int64_t time);
+    Stats GetStats();
+
+private:
+    struct Entry
+    {
+        int64_t pts;
+        int64_t time;
+    };
+
+    std::mutex mutex;
+    // oldest first, bounded in case frames are dropped inside the decoder.
+    std::deque<Entry> sent;
+    Stats stats;
+};
@@ -10,6 +10,7 @@ extern "C"
 #include <libavfilter/avfilter.h>
 #include <libavutil/opt.h>
 #include <libavutil/avutil.h>
+#include <libavutil/time.h>
 // rtpenc.h header uses a weird restrict keyword
 #ifndef restrict
 #define restrict
@@ -18,18 +19,33 @@ extern "C"
 #else
 #include <libavformat/rtpenc.h>
 #endif
+#include <libavformat/srtp.h>
+#include <libavutil/base64.h>
 }
 
+#include <algorithm>
 #include <thread>
 
 #include "formatcontext.h"
 #include "filter.h"
 #include "codeccontext.h"
+#include "codec-pool.h"
 #include "packet.h"
 #include "bsf.h"
+#include "broadcaster.h"
+#include "frame-bus.h"
+#include "input-scheduler.h"
 #include "worker/read-frame-worker.h"
 #include "worker/close-worker.h"
 #include "worker/open-worker.h"
+#include "push-input.h"
+#include "fragmented-output.h"
+#include "hls-segmenter.h"
+#include "udp-sink.h"
+#include "rtp-pacer.h"
+#include "live-edge.h"
+#include "readahead.h"
+#include "av-pointer.h"
 #include "bsf.h"
 
 static Napi::FunctionReference logCallbackRef;
@@ -132,12 +148,22 @@ Napi::Object AVFormatContextObject::Init(Napi::Env env, Napi::Object exports)
 
                                                                   AVFormatContextObject::InstanceAccessor("streams", &AVFormatContextObject::GetStreams, nullptr),
 
+                                                                  AVFormatContextObject::InstanceAccessor("priority", &AVFormatContextObject::GetPriority, &AVFormatContextObject::SetPriority),
+
                                                                   InstanceMethod(Napi::Symbol::WellKnown(env, "asyncDispose"), &AVFormatContextObject::Close),
 
                                                                   InstanceMethod("open", &AVFormatContextObject::Open),
 
+                                                                  InstanceMethod("openStream", &AVFormatContextObject::OpenStream),
+
+                                                                  InstanceMethod("push", &AVFormatContextObject::Push),
+
+                                                                  InstanceMethod("end", &AVFormatContextObject::End),
+
                                                                   InstanceMethod("close", &AVFormatContextObject::Close),
 
+                                                                  InstanceMethod("abort", &AVFormatContextObject::Abort),
+
                                                                   InstanceMethod("createDecoder", &AVFormatContextObject::CreateDecoder),
 
                                                                   InstanceMethod("readFrame", &AVFormatContextObject::ReadFrame),
@@ -148,9 +174,36 @@ Napi::Object AVFormatContextObject::Init(Napi::Env env, Napi::Object exports)
 
                                                                   InstanceMethod("newStream", &AVFormatContextObject::NewStream),
 
+                                                                  InstanceMethod("addStream", &AVFormatContextObject::AddStream),
+
+                                                                  InstanceMethod("writeHeader", &AVFormatContextObject::WriteHeader),
+
+                                                                  InstanceMethod("writeTrailer", &AVFormatContextObject::WriteTrailer),
+
                                                                   InstanceMethod("writeFrame", &AVFormatContextObject::WriteFrame),
 
                                                                   InstanceMethod("createSDP", &AVFormatContextObject::CreateSDP),
+
+                                                                  InstanceMethod("setSRTP", &AVFormatContextObject::SetSRTP),
+
+                                                                  InstanceMethod("getUDPStats", &AVFormatContextObject::GetUDPStats),
+
+                                                                  InstanceMethod("getPacerStats", &AVFormatContextObject::GetPacerStats),
+
+                                                                  InstanceMethod("advancePacerClock", &AVFormatContextObject::AdvancePacerClock),
+
+                                                                  InstanceMethod("setLiveEdge", &AVFormatContextObject::SetLiveEdge),
+
+                                                                  InstanceMethod("getLiveEdgeStats", &AVFormatContextObject::GetLiveEdgeStats),
+                                                                  InstanceMethod("getReadaheadStats", &AVFormatContextObject::GetReadaheadStats),
+
+                                                                  InstanceMethod("createHLS", &AVFormatContextObject::CreateHLS),
+
+                                                                  InstanceMethod("getPlaylist", &AVFormatContextObject::GetPlaylist),
+
+                                                                  InstanceMethod("getSegment", &AVFormatContextObject::GetSegment),
+
+                                                                  InstanceMethod("getInit", &AVFormatContextObject::GetInit),
                                                               });
 
     constructor = Napi::Persistent(func);
@@ -162,11 +215,54 @@ Napi::Object AVFormatContextObject::Init(Napi::Env env, Napi::Object exports)
 
 AVFormatContextObject::AVFormatContextObject(const Napi::CallbackInfo &info)
     : Napi::ObjectWrap<AVFormatContextObject>(info),
-      fmt_ctx_(nullptr), is_input(false)
+      fmt_ctx_(nullptr), is_input(false), mmapInput(nullptr), pushInput(nullptr), fragmentedOutput(nullptr), hlsSegmenter(nullptr), srtp(nullptr), udpSink(nullptr), pacer(nullptr), liveEdge(nullptr), readahead(nullptr), headerWritten(false), trailerWritten(false),
+      aborted(false), ioDeadline(0), readTimeout(0), priority(JobScheduler::PRIORITY_LIVE)
 {
     // i don't think this constructor is called from js??
 }
 
+// timeout option in milliseconds, to microseconds.
+static int64_t timeoutOption(const Napi::CallbackInfo &info, size_t index, int64_t defaultTimeout)
+{
+    if (info.Length() <= index || !info[index].IsObject())
+    {
+        return defaultTimeout;
+    }
+    Napi::Value timeout = info[index].As<Napi::Object>().Get("timeout");
+    if (!timeout.IsNumber())
+    {
+        return defaultTimeout;
+    }
+    return timeout.As<Napi::Number>().DoubleValue() * 1000;
+}
+
+int AVFormatContextObject::InterruptCallback(void *opaque)
+{
+    AVFormatContextObject *formatContextObject = (AVFormatContextObject *)opaque;
+    if (formatContextObject->aborted)
+    {
+        return 1;
+    }
+    int64_t deadline = formatContextObject->ioDeadline;
+    return deadline && av_gettime_relative() > deadline;
+}
+
+int AVFormatContextObject::InterruptedError()
+{
+    return aborted ? AVERROR_EXIT : AVERROR(ETIMEDOUT);
+}
+
+Napi::Value AVFormatContextObject::Abort(const Napi::CallbackInfo &info)
+{
+    aborted = true;
+    // wake a demuxer that is waiting on pushed data.
+    if (pushInput)
+    {
+        pushInput->Abort();
+    }
+    return info.Env().Undefined();
+}
+
 Napi::Value AVFormatContextObject::ReadFrame(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -176,11 +272,7 @@ Napi::Value AVFormatContextObject::ReadFrame(const Napi::CallbackInfo &info)
     napi_create_promise(env, &deferred, &promise);
 
     // Create and queue the AsyncWorker, passing the deferred handle
-    std::map<int, AVCodecContextObject *> decoders;
-    std::map<int, AVCodecContextObject *> encoders;
-    std::map<int, AVFilterGraphObject *> filters;
-    std::map<int, AVFormatContextObject *> writeFormatContexts; // New map for write contexts
-    ReadFrameWorker *worker = new ReadFrameWorker(env, deferred, this, decoders, filters, encoders, writeFormatContexts);
+    ReadFrameWorker *worker = new ReadFrameWorker(env, deferred, this, Pipeline(), timeoutOption(info, 0, readTimeout), priority);
     worker->Queue();
 
     // Return the promise to JavaScript
@@ -200,76 +292,144 @@ Napi::Value AVFormatContextObject::ReceiveFrame(const Napi::CallbackInfo &info)
         return env.Undefined();
     }
 
-    Napi::Array pipelinesArray = info[0].As<Napi::Array>();
-    std::map<int, AVCodecContextObject *> decoders;
-    std::map<int, AVCodecContextObject *> encoders;
-    std::map<int, AVFilterGraphObject *> filters;
-    std::map<int, AVFormatContextObject *> writeFormatContexts; // New map for write contexts
+    Pipeline pipeline;
+    if (!pipeline.Parse(env, info[0].As<Napi::Array>()))
+    {
+        return env.Undefined();
+    }
+
+    ReadFrameWorker *worker = new ReadFrameWorker(env, deferred, this, pipeline, timeoutOption(info, 1, readTimeout), priority);
+    worker->Queue();
+
+    return Napi::Value(env, promise);
+}
 
-    for (uint32_t i = 0; i < pipelinesArray.Length(); i++)
+static AVDictionary *toAVDictionary(Napi::Object options)
+{
+    AVDictionary *dict_opts = nullptr;
+    Napi::Array props = options.GetPropertyNames();
+    for (uint32_t i = 0; i < props.Length(); i++)
     {
-        Napi::Value item = pipelinesArray[i];
-        if (!item.IsObject())
+        Napi::Value key = props.Get(i);
+        Napi::Value value = options.Get(key);
+        if (key.IsString() && value.IsString())
         {
-            Napi::TypeError::New(env, "Each decoder must be an object").ThrowAsJavaScriptException();
-            return env.Undefined();
+            av_dict_set(&dict_opts, key.As<Napi::String>().Utf8Value().c_str(),
+                        value.As<Napi::String>().Utf8Value().c_str(), 0);
         }
+    }
+    return dict_opts;
+}
 
-        Napi::Object pipeline = item.As<Napi::Object>();
-        if (!pipeline.Has("streamIndex"))
+// how a decoder trades latency for throughput, from a profile and then the explicit options.
+struct DecoderSettings
+{
+    std::string profile;
+    // -1 leaves the libavcodec default, a single thread.
+    int threads;
+    int threadType;
+    int flags;
+    int flags2;
+    enum AVDiscard skipLoopFilter;
+    std::string opts;
+};
+
+static bool parseDecoderSettings(Napi::Env env, Napi::Object options, DecoderSettings *settings, AVDictionary **opts)
+{
+    Napi::Value profile = options.Get("profile");
+    if (profile.IsString())
+    {
+        settings->profile = profile.As<Napi::String>().Utf8Value();
+        if (settings->profile == "lowLatency")
         {
-            Napi::TypeError::New(env, "Pipeline objects must have streamIndex").ThrowAsJavaScriptException();
-            return env.Undefined();
+            // slice threads add no delay, frame threads add a frame per thread.
+            settings->threads = 0;
+            settings->threadType = FF_THREAD_SLICE;
+            settings->flags |= AV_CODEC_FLAG_LOW_DELAY;
         }
+        else if (settings->profile == "throughput")
+        {
+            settings->threads = std::max(1, (int)std::thread::hardware_concurrency());
+            settings->threadType = FF_THREAD_FRAME;
+        }
+        else if (settings->profile == "economy")
+        {
+            settings->threads = 1;
+            settings->skipLoopFilter = AVDISCARD_ALL;
+        }
+        else
+        {
+            Napi::TypeError::New(env, "profile must be lowLatency, throughput or economy").ThrowAsJavaScriptException();
+            return false;
+        }
+    }
 
-        int streamIndex = pipeline.Get("streamIndex").As<Napi::Number>().Int32Value();
+    Napi::Value threads = options.Get("threads");
+    if (threads.IsNumber())
+    {
+        settings->threads = std::max(0, threads.As<Napi::Number>().Int32Value());
+    }
 
-        if (pipeline.Has("decoder"))
+    Napi::Value threadType = options.Get("threadType");
+    if (threadType.IsString())
+    {
+        std::string type = threadType.As<Napi::String>().Utf8Value();
+        if (type == "frame")
         {
-            AVCodecContextObject *codecContextObject = Napi::ObjectWrap<AVCodecContextObject>::Unwrap(
-                pipeline.Get("decoder").As<Napi::Object>());
-
-            decoders[streamIndex] = codecContextObject;
+            settings->threadType = FF_THREAD_FRAME;
         }
-
-        if (pipeline.Has("filter"))
+        else if (type == "slice")
         {
-            auto filter = pipeline.Get("filter");
-            if (filter.IsObject())
-            {
-                AVFilterGraphObject *filterObject = Napi::ObjectWrap<AVFilterGraphObject>::Unwrap(
-                    pipeline.Get("filter").As<Napi::Object>());
-                filters[streamIndex] = filterObject;
-            }
+            settings->threadType = FF_THREAD_SLICE;
         }
-
-        if (pipeline.Has("encoder"))
+        else if (type == "auto")
         {
-            auto encoder = pipeline.Get("encoder");
-            if (encoder.IsObject())
-            {
-                AVCodecContextObject *encoderObject = Napi::ObjectWrap<AVCodecContextObject>::Unwrap(
-                    encoder.As<Napi::Object>());
-                encoders[streamIndex] = encoderObject;
-            }
+            settings->threadType = FF_THREAD_FRAME | FF_THREAD_SLICE;
         }
-
-        if (pipeline.Has("writeFormatContext"))
+        else
         {
-            auto writeContext = pipeline.Get("writeFormatContext");
-            if (writeContext.IsObject())
-            {
-                AVFormatContextObject *writeContextObject = Napi::ObjectWrap<AVFormatContextObject>::Unwrap(
-                    writeContext.As<Napi::Object>());
-                writeFormatContexts[streamIndex] = writeContextObject;
-            }
+            Napi::TypeError::New(env, "threadType must be frame, slice or auto").ThrowAsJavaScriptException();
+            return false;
         }
     }
 
-    ReadFrameWorker *worker = new ReadFrameWorker(env, deferred, this, decoders, filters, encoders, writeFormatContexts);
-    worker->Queue();
+    Napi::Value lowDelay = options.Get("lowDelay");
+    if (lowDelay.IsBoolean())
+    {
+        settings->flags = lowDelay.As<Napi::Boolean>() ? settings->flags | AV_CODEC_FLAG_LOW_DELAY : settings->flags & ~AV_CODEC_FLAG_LOW_DELAY;
+    }
 
-    return Napi::Value(env, promise);
+    Napi::Value fast = options.Get("fast");
+    if (fast.IsBoolean())
+    {
+        settings->flags2 = fast.As<Napi::Boolean>() ? settings->flags2 | AV_CODEC_FLAG2_FAST : settings->flags2 & ~AV_CODEC_FLAG2_FAST;
+    }
+
+    Napi::Value skipLoopFilter = options.Get("skipLoopFilter");
+    if (skipLoopFilter.IsBoolean())
+    {
+        settings->skipLoopFilter = skipLoopFilter.As<Napi::Boolean>() ? AVDISCARD_ALL : AVDISCARD_DEFAULT;
+    }
+
+    Napi::Value optsValue = options.Get("opts");
+    if (optsValue.IsObject())
+    {
+        *opts = toAVDictionary(optsValue.As<Napi::Object>());
+        char *buffer = nullptr;
+        if (av_dict_get_string(*opts, &buffer, '=', ',') >= 0 && buffer)
+        {
+            settings->opts = buffer;
+        }
+        av_free(buffer);
+    }
+    return true;
+}
+
+static std::string decoderSettingsKey(const DecoderSettings &settings)
+{
+    return std::to_string(settings.threads) + "," + std::to_string(settings.threadType) +
+           "," + std::to_string(settings.flags) + "," + std::to_string(settings.flags2) +
+           "," + std::to_string(settings.skipLoopFilter) + "," + settings.opts;
 }
 
 Napi::Value AVFormatContextObject::Open(const Napi::CallbackInfo &info)
@@ -292,28 +452,150 @@ Napi::Value AVFormatContextObject::Open(const Napi::CallbackInfo &info)
     AVDictionary *dict_opts = nullptr;
     if (info.Length() > 1 && info[1].IsObject())
     {
-        Napi::Object options = info[1].As<Napi::Object>();
-        Napi::Array props = options.GetPropertyNames();
-        for (uint32_t i = 0; i < props.Length(); i++)
+        dict_opts = toAVDictionary(info[1].As<Napi::Object>());
+    }
+
+    // io options are handled by the addon rather than passed to the demuxer
+    bool useMmap = false;
+    Readahead::Limits readaheadLimits = {};
+    if (info.Length() > 2 && info[2].IsObject())
+    {
+        Napi::Object ioOptions = info[2].As<Napi::Object>();
+        Napi::Value mmapValue = ioOptions.Get("mmap");
+        if (mmapValue.IsBoolean())
+        {
+            useMmap = mmapValue.As<Napi::Boolean>().Value();
+        }
+        Napi::Value readTimeoutValue = ioOptions.Get("readTimeout");
+        if (readTimeoutValue.IsNumber())
+        {
+            readTimeout = readTimeoutValue.As<Napi::Number>().DoubleValue() * 1000;
+        }
+        Napi::Value readaheadValue = ioOptions.Get("readahead");
+        if (readaheadValue.IsObject() || (readaheadValue.IsBoolean() && readaheadValue.As<Napi::Boolean>().Value()))
+        {
+            readaheadLimits.maxPackets = 512;
+            readaheadLimits.maxBytes = 16 * 1024 * 1024;
+        }
+        if (readaheadValue.IsObject())
         {
-            Napi::Value key = props.Get(i);
-            Napi::Value value = options.Get(key);
-            if (key.IsString() && value.IsString())
+            Napi::Object readaheadOptions = readaheadValue.As<Napi::Object>();
+            if (readaheadOptions.Get("maxPackets").IsNumber())
+            {
+                readaheadLimits.maxPackets = std::max(1u, readaheadOptions.Get("maxPackets").As<Napi::Number>().Uint32Value());
+            }
+            if (readaheadOptions.Get("maxBytes").IsNumber())
+            {
+                readaheadLimits.maxBytes = readaheadOptions.Get("maxBytes").As<Napi::Number>().Int64Value();
+            }
+            // seconds.
+            if (readaheadOptions.Get("maxDuration").IsNumber())
             {
-                av_dict_set(&dict_opts, key.As<Napi::String>().Utf8Value().c_str(),
-                            value.As<Napi::String>().Utf8Value().c_str(), 0);
+                readaheadLimits.maxDuration = readaheadOptions.Get("maxDuration").As<Napi::Number>().DoubleValue() * 1000000;
             }
         }
     }
 
     // Create and queue the AsyncWorker, passing the deferred handle and dictionary
-    OpenWorker *worker = new OpenWorker(env, deferred, this, filename, dict_opts);
+    OpenWorker *worker = new OpenWorker(env, deferred, this, filename, dict_opts, useMmap, nullptr, timeoutOption(info, 2, 0), readaheadLimits);
     worker->Queue();
 
     // Return the promise to JavaScript
     return Napi::Value(env, promise);
 }
 
+Napi::Value AVFormatContextObject::OpenStream(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::TypeError::New(env, "String expected for argument 0: format").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (fmt_ctx_ || pushInput)
+    {
+        Napi::Error::New(env, "Format context already opened").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // an empty format name probes the pushed data.
+    std::string formatName = info[0].As<Napi::String>().Utf8Value();
+    const AVInputFormat *inputFormat = nullptr;
+    if (formatName.length())
+    {
+        inputFormat = av_find_input_format(formatName.c_str());
+        if (!inputFormat)
+        {
+            Napi::Error::New(env, "Input format not found").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    AVDictionary *dict_opts = nullptr;
+    if (info.Length() > 1 && info[1].IsObject())
+    {
+        dict_opts = toAVDictionary(info[1].As<Napi::Object>());
+    }
+
+    int ret;
+    pushInput = PushInput::Create(1024, &ret);
+    if (!pushInput)
+    {
+        av_dict_free(&dict_opts);
+        Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    // lets read deadlines interrupt a read that is waiting for pushed data.
+    pushInput->interrupt.callback = InterruptCallback;
+    pushInput->interrupt.opaque = this;
+
+    napi_deferred deferred;
+    napi_value promise;
+    napi_create_promise(env, &deferred, &promise);
+
+    // the open completes once enough data has been pushed to read the stream header.
+    OpenWorker *worker = new OpenWorker(env, deferred, this, "", dict_opts, false, inputFormat);
+    worker->Queue();
+
+    return Napi::Value(env, promise);
+}
+
+Napi::Value AVFormatContextObject::Push(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!pushInput)
+    {
+        Napi::Error::New(env, "Format context was not opened with openStream").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (info.Length() < 1 || !info[0].IsBuffer())
+    {
+        Napi::TypeError::New(env, "Buffer expected for argument 0").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
+    int ret = pushInput->Push(env, buffer, buffer.Data(), buffer.Length());
+    // only a full queue is worth retrying, the others would fail forever.
+    if (ret < 0 && ret != AVERROR(EAGAIN))
+    {
+        Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    return Napi::Boolean::New(env, ret == 0);
+}
+
+Napi::Value AVFormatContextObject::End(const Napi::CallbackInfo &info)
+{
+    if (pushInput)
+    {
+        pushInput->End();
+    }
+    return info.Env().Undefined();
+}
+
 Napi::Value AVFormatContextObject::CreateDecoder(const Napi::CallbackInfo &info)
 {
     if (!fmt_ctx_)
@@ -341,8 +623,19 @@ Napi::Value AVFormatContextObject::CreateDecoder(const Napi::CallbackInfo &info)
     int ret;
     std::string deviceName;
 
-    // args are hardwareDeviceName (optional) hardwareDeviceDecoder (optional)
-    if (info.Length() > 1)
+    // args are hardwareDeviceName (optional) hardwareDeviceDecoder (optional) deviceName (optional) options (optional),
+    // or options alone.
+    DecoderSettings settings = {"", -1, -1, 0, 0, AVDISCARD_DEFAULT, ""};
+    AVDictionary *opts = nullptr;
+    Napi::Value optionsValue = info.Length() > 4 ? info[4] : info.Length() > 1 && info[1].IsObject() ? info[1] : env.Undefined();
+    if (optionsValue.IsObject() && !parseDecoderSettings(env, optionsValue.As<Napi::Object>(), &settings, &opts))
+    {
+        av_dict_free(&opts);
+        return env.Undefined();
+    }
+    FreePointer<AVDictionary, av_dict_free> optsPointer(opts);
+
+    if (info.Length() > 1 && !info[1].IsObject() && !info[1].IsUndefined())
     {
         if (!info[1].IsString())
         {
@@ -410,7 +703,30 @@ Napi::Value AVFormatContextObject::CreateDecoder(const Napi::CallbackInfo &info)
                 break;
             }
         }
+    }
+
+    if (!codec)
+    {
+        Napi::Error::New(env, "Decoder not found").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
 
+    // a pooled decoder skips the device setup and the open.
+    std::string poolKey = CodecPool::DecoderKey(codec, stream->codecpar, codecContextObject->hw_device_value, deviceName, decoderSettingsKey(settings));
+    codecContextObject->decoderProfile = settings.profile;
+    AVCodecContext *pooled = CodecPool::Acquire(poolKey);
+    if (pooled)
+    {
+        pooled->opaque = codecContextObject;
+        pooled->time_base = stream->time_base;
+        pooled->pkt_timebase = stream->time_base;
+        codecContextObject->codecContext = pooled;
+        codecContextObject->poolKey = poolKey;
+        return codecContextReturn;
+    }
+
+    if (codecContextObject->hw_device_value != AV_HWDEVICE_TYPE_NONE)
+    {
         if ((ret = av_hwdevice_ctx_create(&hw_device_ctx, codecContextObject->hw_device_value,
                                           deviceName.length() ? deviceName.c_str() : nullptr, NULL, 0)) < 0)
         {
@@ -422,6 +738,8 @@ Napi::Value AVFormatContextObject::CreateDecoder(const Napi::CallbackInfo &info)
 
     codecContextObject->codecContext = avcodec_alloc_context3(codec);
     codecContextObject->codecContext->time_base = stream->time_base;
+    // frame timestamps are in the packet time base, output rate policies and frame buses rely on it.
+    codecContextObject->codecContext->pkt_timebase = stream->time_base;
     codecContextObject->codecContext->opaque = codecContextObject;
     if (hw_device_ctx)
     {
@@ -437,7 +755,23 @@ Napi::Value AVFormatContextObject::CreateDecoder(const Napi::CallbackInfo &info)
         return env.Undefined();
     }
 
-    if ((ret = avcodec_open2(codecContextObject->codecContext, codec, nullptr)) < 0)
+    AVCodecContext *c = codecContextObject->codecContext;
+    if (settings.threads >= 0)
+    {
+        c->thread_count = settings.threads;
+    }
+    if (settings.threadType >= 0)
+    {
+        c->thread_type = settings.threadType;
+    }
+    c->flags |= settings.flags;
+    c->flags2 |= settings.flags2;
+    c->skip_loop_filter = settings.skipLoopFilter;
+
+    AVDictionary *openOpts = optsPointer.release();
+    ret = avcodec_open2(c, codec, &openOpts);
+    av_dict_free(&openOpts);
+    if (ret < 0)
     {
         Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
         avcodec_free_context(&codecContextObject->codecContext);
@@ -445,6 +779,7 @@ Napi::Value AVFormatContextObject::CreateDecoder(const Napi::CallbackInfo &info)
         return env.Undefined();
     }
 
+    codecContextObject->poolKey = poolKey;
     return codecContextReturn;
 }
 
@@ -461,6 +796,14 @@ Napi::Value AVFormatContextObject::Close(const Napi::CallbackInfo &info)
     napi_value promise;
     napi_create_promise(env, &deferred, &promise);
 
+    // interrupt a read or open in progress, the close worker waits for it to return.
+    aborted = true;
+    // wake a demuxer that is waiting on pushed data.
+    if (pushInput)
+    {
+        pushInput->Abort();
+    }
+
     // Create and queue the AsyncWorker, passing the deferred handle
     CloseWorker *worker = new CloseWorker(env, deferred, this);
     worker->Queue();
@@ -486,31 +829,137 @@ Napi::Value AVFormatContextObject::GetMetadata(const Napi::CallbackInfo &info)
     return metadata;
 }
 
+// SRTCP index plus the longest auth tag.
+static const int SRTP_MAX_TRAILER_SIZE = 4 + 10;
+
+// hands a datagram to js, data is av_malloc'd and owned by the callee.
+static void callWritePacketCallback(AVFormatContextObject *formatContextObject, uint8_t *data, int size)
+{
+    // Call the JavaScript function on the main thread
+    napi_status status = formatContextObject->callbackRef.BlockingCall([data, size](Napi::Env env, Napi::Function jsCallback)
+                                                                       {
+                                                                           Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::NewOrCopy(env, data, size, [](Napi::Env env, uint8_t *data)
+                                                                                                                                           { av_free(data); });
+                                                                           jsCallback.Call({buffer});
+                                                                           //
+                                                                       });
+    if (status != napi_ok)
+    {
+        av_free(data);
+    }
+}
+
 // Custom write function to intercept RTP packet data
 static int write_packet(void *opaque, const uint8_t *buf, int buf_size)
 {
     AVFormatContextObject *formatContextObject = (AVFormatContextObject *)opaque;
+    // paced datagrams are held in their own copy until they are due.
+    UdpSink *udpSink = formatContextObject->pacer ? nullptr : formatContextObject->udpSink;
 
-    // malloc and copy buf
-    uint8_t *copy = (uint8_t *)av_malloc(buf_size);
+    int size = formatContextObject->srtp ? buf_size + SRTP_MAX_TRAILER_SIZE : buf_size;
+    uint8_t *copy = udpSink ? udpSink->Reserve(size) : (uint8_t *)av_malloc(size);
     if (!copy)
     {
         return AVERROR(ENOMEM);
     }
-    memcpy(copy, buf, buf_size);
 
-    // Call the JavaScript function on the main thread
-    formatContextObject->callbackRef.BlockingCall([copy, buf_size](Napi::Env env, Napi::Function jsCallback)
-                                                  {
-                                                      Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(env, copy, buf_size);
-                                                      av_free(copy);
-                                                      jsCallback.Call({buffer});
-                                                      //
-                                                  });
+    if (formatContextObject->srtp)
+    {
+        // the rtp muxer flushes every packet, so each write is a single RTP or RTCP packet.
+        // encrypting into the copy avoids another pass over the data.
+        std::lock_guard<std::mutex> lock(formatContextObject->srtpMutex);
+        size = ff_srtp_encrypt(formatContextObject->srtp, buf, buf_size, copy, size);
+        if (size < 0)
+        {
+            if (!udpSink)
+            {
+                av_free(copy);
+            }
+            return AVERROR_INVALIDDATA;
+        }
+    }
+    else
+    {
+        memcpy(copy, buf, buf_size);
+    }
+
+    // sent once the whole packet has been muxed, see WritePacket.
+    if (formatContextObject->pacer)
+    {
+        formatContextObject->pacer->Enqueue(copy, size);
+        return buf_size;
+    }
+    if (udpSink)
+    {
+        udpSink->Commit(size);
+        return buf_size;
+    }
 
+    callWritePacketCallback(formatContextObject, copy, size);
     return buf_size;
 }
 
+// options are {suite, key, salt}, key and salt may also be given concatenated as key.
+static int setSRTPCrypto(SRTPContext *srtp, Napi::Object options, std::string *error)
+{
+    Napi::Value suiteValue = options.Get("suite");
+    std::string suite = suiteValue.IsString() ? suiteValue.As<Napi::String>().Utf8Value() : "AES_CM_128_HMAC_SHA1_80";
+
+    Napi::Value keyValue = options.Get("key");
+    if (!keyValue.IsBuffer())
+    {
+        *error = "SRTP key must be a Buffer";
+        return AVERROR(EINVAL);
+    }
+    Napi::Buffer<uint8_t> key = keyValue.As<Napi::Buffer<uint8_t>>();
+
+    // master key and master salt.
+    uint8_t params[30];
+    size_t length = key.Length();
+    Napi::Value saltValue = options.Get("salt");
+    if (saltValue.IsBuffer())
+    {
+        Napi::Buffer<uint8_t> salt = saltValue.As<Napi::Buffer<uint8_t>>();
+        if (length != 16 || salt.Length() != 14)
+        {
+            *error = "SRTP key must be 16 bytes and salt 14 bytes";
+            return AVERROR(EINVAL);
+        }
+        memcpy(params, key.Data(), 16);
+        memcpy(params + 16, salt.Data(), 14);
+    }
+    else
+    {
+        if (length != 30)
+        {
+            *error = "SRTP key must be 30 bytes of key and salt";
+            return AVERROR(EINVAL);
+        }
+        memcpy(params, key.Data(), 30);
+    }
+
+    char encoded[AV_BASE64_SIZE(sizeof(params))];
+    av_base64_encode(encoded, sizeof(encoded), params, sizeof(params));
+
+    // key into a fresh context so a failed rekey leaves the current keys in place.
+    SRTPContext next = {};
+    int ret = ff_srtp_set_crypto(&next, suite.c_str(), encoded);
+    if (ret < 0)
+    {
+        ff_srtp_free(&next);
+        *error = "Unsupported SRTP suite: " + suite;
+        return ret;
+    }
+
+    next.seq_largest = srtp->seq_largest;
+    next.seq_initialized = srtp->seq_initialized;
+    next.roc = srtp->roc;
+    next.rtcp_index = srtp->rtcp_index;
+    ff_srtp_free(srtp);
+    *srtp = next;
+    return 0;
+}
+
 // Custom write funct
 Napi::Value AVFormatContextObject::Create(const Napi::CallbackInfo &info)
 {
@@ -528,7 +977,11 @@ Napi::Value AVFormatContextObject::Create(const Napi::CallbackInfo &info)
         return env.Undefined();
     }
 
-    if (info.Length() < 2 || !info[1].IsFunction())
+    Napi::Object options = info.Length() > 2 && info[2].IsObject() ? info[2].As<Napi::Object>() : Napi::Object::New(env);
+    Napi::Value udpValue = options.Get("udp");
+
+    // the callback is unused when output goes to a udp socket.
+    if ((info.Length() < 2 || !info[1].IsFunction()) && !udpValue.IsObject())
     {
         Napi::TypeError::New(env, "Function expected for argument 1: callback").ThrowAsJavaScriptException();
         return env.Undefined();
@@ -560,40 +1013,190 @@ Napi::Value AVFormatContextObject::Create(const Napi::CallbackInfo &info)
         }
     }
 
-    // Set up a custom AVIOContext to capture the RTP output
-    int MAX_MEM_SIZE = 1024 * 1024;
-    uint8_t *buffer = (uint8_t *)av_malloc(MAX_MEM_SIZE);
-    if (!buffer)
+    Napi::Value fragmentedValue = options.Get("fragmented");
+    bool fragmented = fragmentedValue.IsBoolean() && fragmentedValue.As<Napi::Boolean>().Value();
+    if (fragmented)
     {
-        avformat_free_context(fmt_ctx_);
-        fmt_ctx_ = nullptr;
-        Napi::Error::New(env, "Failed to allocate AVIO context buffer").ThrowAsJavaScriptException();
-        return env.Undefined();
-    }
+        if (!(fmt_ctx_->oformat->flags & AVFMT_ALLOW_FLUSH))
+        {
+            avformat_free_context(fmt_ctx_);
+            fmt_ctx_ = nullptr;
+            Napi::Error::New(env, "Format does not support fragmented output").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
 
-    AVIOContext *avio_ctx = avio_alloc_context(buffer, MAX_MEM_SIZE, 1, this, NULL, write_packet, NULL);
-    if (!avio_ctx)
-    {
-        av_free(buffer);
-        avformat_free_context(fmt_ctx_);
-        fmt_ctx_ = nullptr;
-        Napi::Error::New(env, "Failed to create AVIOContext").ThrowAsJavaScriptException();
-        return env.Undefined();
-    }
+        // fragments are cut explicitly rather than by the muxer, see FragmentedOutput.
+        if (formatName == "mp4" || formatName == "mov")
+        {
+            av_opt_set(fmt_ctx_->priv_data, "movflags", "frag_custom+empty_moov+default_base_moof+skip_trailer", 0);
+        }
+
+        int64_t fragmentDuration = 0;
+        Napi::Value fragmentDurationValue = options.Get("fragmentDuration");
+        if (fragmentDurationValue.IsNumber())
+        {
+            fragmentDuration = fragmentDurationValue.As<Napi::Number>().DoubleValue() * AV_TIME_BASE;
+        }
+
+        bool keyframeAligned = true;
+        Napi::Value keyframeAlignedValue = options.Get("keyframeAligned");
+        if (keyframeAlignedValue.IsBoolean())
+        {
+            keyframeAligned = keyframeAlignedValue.As<Napi::Boolean>().Value();
+        }
+
+        fragmentedOutput = new FragmentedOutput(fragmentDuration, keyframeAligned, [this](const OutputFragment &fragment)
+                                                {
+            napi_status status = callbackRef.BlockingCall([fragment](Napi::Env env, Napi::Function jsCallback)
+                                                          {
+                // the fragment is handed to js without a copy where external buffers are allowed.
+                Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::NewOrCopy(env, fragment.data, fragment.size, [](Napi::Env env, uint8_t *data)
+                                                                                { av_free(data); });
+                Napi::Object info = Napi::Object::New(env);
+                info.Set("type", fragment.init ? "init" : "fragment");
+                info.Set("size", Napi::Number::New(env, fragment.size));
+                info.Set("keyframe", Napi::Boolean::New(env, fragment.keyframe));
+                info.Set("duration", Napi::Number::New(env, (double)fragment.duration / AV_TIME_BASE));
+                if (fragment.pts != AV_NOPTS_VALUE)
+                    info.Set("pts", Napi::Number::New(env, (double)fragment.pts / AV_TIME_BASE));
+                jsCallback.Call({buffer, info}); });
+            if (status != napi_ok)
+            {
+                av_free(fragment.data);
+            } });
+    }
+
+    Napi::Value srtpValue = options.Get("srtp");
+    if (srtpValue.IsObject())
+    {
+        std::string error = "SRTP requires rtp output";
+        int ret = AVERROR(EINVAL);
+        if (formatName == "rtp")
+        {
+            srtp = (SRTPContext *)av_mallocz(sizeof(SRTPContext));
+            ret = srtp ? setSRTPCrypto(srtp, srtpValue.As<Napi::Object>(), &error) : AVERROR(ENOMEM);
+        }
+        if (ret < 0)
+        {
+            DestroyOutput();
+            Napi::Error::New(env, error).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    if (udpValue.IsObject())
+    {
+        Napi::Object udp = udpValue.As<Napi::Object>();
+        std::string address = udp.Get("address").IsString() ? udp.Get("address").As<Napi::String>().Utf8Value() : "";
+        int port = udp.Get("port").IsNumber() ? udp.Get("port").As<Napi::Number>().Int32Value() : 0;
+        int error = AVERROR(EINVAL);
+        // fragments are delivered whole, not as datagrams.
+        if (!fragmentedOutput && udp.Get("fd").IsNumber())
+        {
+            udpSink = UdpSink::FromFd(udp.Get("fd").As<Napi::Number>().Int32Value(), address, port, &error);
+        }
+        else if (!fragmentedOutput && !address.empty() && port > 0)
+        {
+            udpSink = UdpSink::Create(address, port, &error);
+        }
+        if (!udpSink)
+        {
+            DestroyOutput();
+            Napi::Error::New(env, AVErrorString(error)).ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    Napi::Value pacingValue = options.Get("pacing");
+    if (pacingValue.IsObject())
+    {
+        if (formatName != "rtp" || fragmentedOutput)
+        {
+            DestroyOutput();
+            Napi::Error::New(env, "Pacing requires rtp output").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Object pacing = pacingValue.As<Napi::Object>();
+        int64_t bitrate = pacing.Get("bitrate").IsNumber() ? pacing.Get("bitrate").As<Napi::Number>().Int64Value() : 0;
+        int64_t burst = pacing.Get("burst").IsNumber() ? pacing.Get("burst").As<Napi::Number>().Int64Value() : 0;
+        double spread = pacing.Get("spread").IsNumber() ? pacing.Get("spread").As<Napi::Number>().DoubleValue() : 0.5;
+        bool manualClock = pacing.Get("clock").IsString() && pacing.Get("clock").As<Napi::String>().Utf8Value() == "manual";
+
+        pacer = new RtpPacer(bitrate, burst, spread, manualClock, [this](std::vector<RtpPacer::Packet> &packets)
+                             {
+            if (udpSink)
+            {
+                for (RtpPacer::Packet &packet : packets)
+                {
+                    memcpy(udpSink->Reserve(packet.size), packet.data, packet.size);
+                    udpSink->Commit(packet.size);
+                    av_free(packet.data);
+                }
+                udpSink->Flush();
+                return;
+            }
+            for (RtpPacer::Packet &packet : packets)
+            {
+                callWritePacketCallback(this, packet.data, packet.size);
+            } });
+    }
+
+    // Set up a custom AVIOContext to capture the RTP output
+    int MAX_MEM_SIZE = 1024 * 1024;
+    uint8_t *buffer = (uint8_t *)av_malloc(MAX_MEM_SIZE);
+    if (!buffer)
+    {
+        DestroyOutput();
+        Napi::Error::New(env, "Failed to allocate AVIO context buffer").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    AVIOContext *avio_ctx = fragmentedOutput
+                                ? avio_alloc_context(buffer, MAX_MEM_SIZE, 1, fragmentedOutput, NULL, FragmentedOutput::Write, NULL)
+                                : avio_alloc_context(buffer, MAX_MEM_SIZE, 1, this, NULL, write_packet, NULL);
+    if (!avio_ctx)
+    {
+        av_free(buffer);
+        DestroyOutput();
+        Napi::Error::New(env, "Failed to create AVIOContext").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
 
-    callbackRef = Napi::ThreadSafeFunction::New(
-        env,                          // Environment
-        info[1].As<Napi::Function>(), // JavaScript function to call
-        "napi_write_packet",          // Resource name for diagnostics
-        0,                            // Max queue size (0 = unlimited)
-        1                             // Initial thread count
-    );
+    if (!udpSink)
+    {
+        callbackRef = Napi::ThreadSafeFunction::New(
+            env,                          // Environment
+            info[1].As<Napi::Function>(), // JavaScript function to call
+            "napi_write_packet",          // Resource name for diagnostics
+            0,                            // Max queue size (0 = unlimited)
+            1                             // Initial thread count
+        );
+    }
 
     fmt_ctx_->pb = avio_ctx;
 
     return env.Undefined();
 }
 
+// undoes a partially completed Create.
+void AVFormatContextObject::DestroyOutput()
+{
+    delete fragmentedOutput;
+    fragmentedOutput = nullptr;
+    delete pacer;
+    pacer = nullptr;
+    delete udpSink;
+    udpSink = nullptr;
+    if (srtp)
+    {
+        ff_srtp_free(srtp);
+        av_freep(&srtp);
+    }
+    avformat_free_context(fmt_ctx_);
+    fmt_ctx_ = nullptr;
+}
+
 Napi::Value AVFormatContextObject::WriteFrame(const Napi::CallbackInfo &info)
 {
     // arguments are index and packet
@@ -623,26 +1226,119 @@ Napi::Value AVFormatContextObject::WriteFrame(const Napi::CallbackInfo &info)
         return env.Undefined();
     }
 
+    if (!headerWritten)
+    {
+        Napi::Error::New(env, "Header not written").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (trailerWritten)
+    {
+        Napi::Error::New(env, "Trailer already written").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
     packet->stream_index = streamIndex;
 
-    av_write_frame(fmt_ctx_, packet);
+    WritePacket(packet);
 
     return env.Undefined();
 }
 
-Napi::Value AVFormatContextObject::NewStream(const Napi::CallbackInfo &info)
+int AVFormatContextObject::WritePacket(AVPacket *packet)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    // ie a broadcaster subscriber racing close, or a write before writeHeader or after writeTrailer.
+    if (!fmt_ctx_ || !headerWritten || trailerWritten)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    unsigned int streamIndex = packet->stream_index;
+    bool rescale = fragmentedOutput || (streamIndex < rescaleTimestamps.size() && rescaleTimestamps[streamIndex]);
+    bool interleave = !fragmentedOutput && fmt_ctx_->nb_streams > 1;
+
+    if (!rescale && !interleave)
+    {
+        int ret = av_write_frame(fmt_ctx_, packet);
+        AfterWrite(packet, ret);
+        return ret;
+    }
+
+    // the muxer picks its own stream time base, so packets are rescaled
+    // from their source time base on a reference rather than in place.
+    // the interleaver also takes ownership of the packet it is given.
+    FreePointer<AVPacket, av_packet_free> rescaled(av_packet_clone(packet));
+    if (!rescaled.get())
+    {
+        return AVERROR(ENOMEM);
+    }
+
+    if (rescale && streamIndex < sourceTimeBases.size() && streamIndex < fmt_ctx_->nb_streams)
+    {
+        av_packet_rescale_ts(rescaled.get(), sourceTimeBases[streamIndex], fmt_ctx_->streams[streamIndex]->time_base);
+    }
+
+    if (fragmentedOutput)
+    {
+        return fragmentedOutput->WritePacket(fmt_ctx_, rescaled.get());
+    }
+
+    int ret = interleave ? av_interleaved_write_frame(fmt_ctx_, rescaled.get()) : av_write_frame(fmt_ctx_, rescaled.get());
+    AfterWrite(packet, ret);
+    return ret;
+}
+
+// hands off what the muxer wrote for a packet, or for the trailer if packet is null.
+// ret is the result of the write.
+void AVFormatContextObject::AfterWrite(AVPacket *packet, int ret)
+{
+    if (pacer)
+    {
+        // a failed write, ie to a stream that doesn't exist, has no frame to pace.
+        // anything it queued goes out with the next frame.
+        if (packet && (ret < 0 || (unsigned int)packet->stream_index >= fmt_ctx_->nb_streams))
+        {
+            return;
+        }
+
+        int streamIndex = -1;
+        int64_t pts = AV_NOPTS_VALUE;
+        int64_t duration = 0;
+        if (packet)
+        {
+            // packet timestamps are still in the source time base here.
+            streamIndex = packet->stream_index;
+            AVRational timeBase = fmt_ctx_->streams[streamIndex]->time_base;
+            if ((unsigned int)streamIndex < sourceTimeBases.size() && sourceTimeBases[streamIndex].den)
+            {
+                timeBase = sourceTimeBases[streamIndex];
+            }
+            pts = packet->pts != AV_NOPTS_VALUE ? av_rescale_q(packet->pts, timeBase, AV_TIME_BASE_Q) : AV_NOPTS_VALUE;
+            duration = av_rescale_q(packet->duration, timeBase, AV_TIME_BASE_Q);
+        }
+        pacer->EndFrame(streamIndex, pts, duration);
+    }
+    // one batch of datagrams per packet, ie all of a frame's rtp packets.
+    else if (udpSink)
+    {
+        udpSink->Flush();
+    }
+}
+
+// creates an output stream from newStream/addStream options, returns null after throwing.
+AVStream *AVFormatContextObject::AddStreamFromOptions(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
     if (!fmt_ctx_)
     {
         Napi::Error::New(env, "Format context is null").ThrowAsJavaScriptException();
-        return env.Undefined();
+        return nullptr;
     }
 
     if (info.Length() < 1 || !info[0].IsObject())
     {
         Napi::TypeError::New(env, "Object expected for argument 0: codecContext").ThrowAsJavaScriptException();
-        return env.Undefined();
+        return nullptr;
     }
 
     Napi::Object options = info[0].As<Napi::Object>();
@@ -663,7 +1359,7 @@ Napi::Value AVFormatContextObject::NewStream(const Napi::CallbackInfo &info)
         if (!stream)
         {
             Napi::Error::New(env, "Failed to create new stream").ThrowAsJavaScriptException();
-            return env.Undefined();
+            return nullptr;
         }
 
         // Set the codec parameters for the new stream
@@ -678,7 +1374,7 @@ Napi::Value AVFormatContextObject::NewStream(const Napi::CallbackInfo &info)
         if (!streamIndexValue.IsNumber())
         {
             Napi::TypeError::New(env, "Number expected for streamIndex").ThrowAsJavaScriptException();
-            return env.Undefined();
+            return nullptr;
         }
         unsigned int streamIndex = streamIndexValue.As<Napi::Number>().Uint32Value();
         AVFormatContextObject *formatContextObject = Napi::ObjectWrap<AVFormatContextObject>::Unwrap(formatContextValue.As<Napi::Object>());
@@ -686,25 +1382,25 @@ Napi::Value AVFormatContextObject::NewStream(const Napi::CallbackInfo &info)
         if (!formatContext)
         {
             Napi::Error::New(env, "Format context is null").ThrowAsJavaScriptException();
-            return env.Undefined();
+            return nullptr;
         }
         if (streamIndex >= formatContext->nb_streams)
         {
             Napi::Error::New(env, "Invalid stream index").ThrowAsJavaScriptException();
-            return env.Undefined();
+            return nullptr;
         }
         AVStream *sourceStream = formatContext->streams[streamIndex];
         stream = avformat_new_stream(fmt_ctx_, NULL);
         if (!stream)
         {
             Napi::Error::New(env, "Failed to create new stream").ThrowAsJavaScriptException();
-            return env.Undefined();
+            return nullptr;
         }
         AVCodecParameters *codecpar = stream->codecpar;
         if (avcodec_parameters_copy(codecpar, sourceStream->codecpar) < 0)
         {
             Napi::Error::New(env, "Failed to copy codec parameters").ThrowAsJavaScriptException();
-            return env.Undefined();
+            return nullptr;
         }
         stream->time_base.num = sourceStream->time_base.num;
         stream->time_base.den = sourceStream->time_base.den;
@@ -717,13 +1413,13 @@ Napi::Value AVFormatContextObject::NewStream(const Napi::CallbackInfo &info)
         if (!stream)
         {
             Napi::Error::New(env, "Failed to create new stream").ThrowAsJavaScriptException();
-            return env.Undefined();
+            return nullptr;
         }
         AVCodecParameters *codecpar = stream->codecpar;
         if (avcodec_parameters_copy(codecpar, bsf->par_out) < 0)
         {
             Napi::Error::New(env, "Failed to copy codec parameters").ThrowAsJavaScriptException();
-            return env.Undefined();
+            return nullptr;
         }
         stream->time_base.num = bsf->time_base_in.num;
         stream->time_base.den = bsf->time_base_in.den;
@@ -732,21 +1428,137 @@ Napi::Value AVFormatContextObject::NewStream(const Napi::CallbackInfo &info)
     {
         // throw
         Napi::Error::New(env, "Object expected for codecContext or formatContext").ThrowAsJavaScriptException();
+        return nullptr;
+    }
+
+    sourceTimeBases.resize(fmt_ctx_->nb_streams);
+    sourceTimeBases[stream->index] = stream->time_base;
+    rescaleTimestamps.resize(fmt_ctx_->nb_streams, false);
+
+    return stream;
+}
+
+Napi::Value AVFormatContextObject::NewStream(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    AVStream *stream = AddStreamFromOptions(info);
+    if (!stream)
+    {
         return env.Undefined();
     }
 
-    int ret;
-    if ((ret = avformat_write_header(fmt_ctx_, NULL)) < 0)
+    int ret = fragmentedOutput ? fragmentedOutput->WriteHeader(fmt_ctx_, NULL) : avformat_write_header(fmt_ctx_, NULL);
+    if (ret < 0)
     {
         avformat_free_context(fmt_ctx_);
         fmt_ctx_ = nullptr;
         Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
         return env.Undefined();
     }
+    headerWritten = true;
+
+    return Napi::Number::New(env, stream->index);
+}
+
+Napi::Value AVFormatContextObject::AddStream(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (headerWritten || trailerWritten)
+    {
+        Napi::Error::New(env, "Streams must be added before writeHeader").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    AVStream *stream = AddStreamFromOptions(info);
+    if (!stream)
+    {
+        return env.Undefined();
+    }
+    // the muxer may pick a different time base in writeHeader.
+    rescaleTimestamps[stream->index] = true;
 
     return Napi::Number::New(env, stream->index);
 }
 
+Napi::Value AVFormatContextObject::WriteHeader(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    // stream workers and broadcaster subscribers may already be writing, and are turned away
+    // until the header is written. also keeps a pending close from freeing the context.
+    std::unique_lock<std::mutex> lock(writeMutex);
+    if (!fmt_ctx_)
+    {
+        Napi::Error::New(env, "Format context is null").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (headerWritten || trailerWritten)
+    {
+        Napi::Error::New(env, "Header already written").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    AVDictionary *options = nullptr;
+    if (info.Length() > 0 && info[0].IsObject())
+    {
+        options = toAVDictionary(info[0].As<Napi::Object>());
+    }
+
+    // bound how long the interleaver holds one stream's packets waiting on another,
+    // the 10 second default is far too much buffering for live output.
+    if (!av_dict_get(options, "max_interleave_delta", NULL, 0))
+    {
+        fmt_ctx_->max_interleave_delta = AV_TIME_BASE;
+    }
+
+    int ret = fragmentedOutput ? fragmentedOutput->WriteHeader(fmt_ctx_, &options) : avformat_write_header(fmt_ctx_, &options);
+    if (ret >= 0)
+    {
+        headerWritten = true;
+    }
+    lock.unlock();
+    av_dict_free(&options);
+    if (ret < 0)
+    {
+        Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+Napi::Value AVFormatContextObject::WriteTrailer(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    std::unique_lock<std::mutex> lock(writeMutex);
+    if (!fmt_ctx_ || !headerWritten)
+    {
+        Napi::Error::New(env, "Header not written").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (trailerWritten)
+    {
+        Napi::Error::New(env, "Trailer already written").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int ret = fragmentedOutput ? fragmentedOutput->Flush(fmt_ctx_) : 0;
+    if (ret >= 0)
+    {
+        // also drains the interleaving queue.
+        ret = av_write_trailer(fmt_ctx_);
+    }
+    AfterWrite(nullptr, ret);
+    // a failed trailer still leaves the muxer finished.
+    trailerWritten = true;
+    lock.unlock();
+    if (ret < 0)
+    {
+        Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
+    }
+
+    return env.Undefined();
+}
+
 Napi::Value AVFormatContextObject::GetStreams(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -797,6 +1609,332 @@ Napi::Value AVFormatContextObject::CreateSDP(const Napi::CallbackInfo &info)
     return sdpString;
 }
 
+Napi::Value AVFormatContextObject::SetSRTP(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Object expected for argument 0: options").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::lock_guard<std::mutex> lock(srtpMutex);
+    if (!srtp)
+    {
+        Napi::Error::New(env, "SRTP was not enabled when the output was created").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // rekeying keeps the rollover counter and SRTCP index, the stream continues under the new key.
+    std::string error;
+    if (setSRTPCrypto(srtp, info[0].As<Napi::Object>(), &error) < 0)
+    {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+    }
+    return env.Undefined();
+}
+
+Napi::Value AVFormatContextObject::GetUDPStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!udpSink)
+    {
+        return env.Undefined();
+    }
+
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("packets", Napi::Number::New(env, udpSink->packets));
+    stats.Set("bytes", Napi::Number::New(env, udpSink->bytes));
+    stats.Set("drops", Napi::Number::New(env, udpSink->drops));
+    stats.Set("errors", Napi::Number::New(env, udpSink->errors));
+    return stats;
+}
+
+Napi::Value AVFormatContextObject::GetPacerStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!pacer)
+    {
+        return env.Undefined();
+    }
+
+    RtpPacer::Stats pacerStats = pacer->GetStats();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("queueDepth", Napi::Number::New(env, pacerStats.queueDepth));
+    stats.Set("queuedBytes", Napi::Number::New(env, pacerStats.queuedBytes));
+    stats.Set("maxQueueDepth", Napi::Number::New(env, pacerStats.maxQueueDepth));
+    stats.Set("sent", Napi::Number::New(env, pacerStats.sent));
+    stats.Set("averageDelay", Napi::Number::New(env, (double)pacerStats.averageDelay / 1000));
+    stats.Set("maxDelay", Napi::Number::New(env, (double)pacerStats.maxDelay / 1000));
+    return stats;
+}
+
+Napi::Value AVFormatContextObject::AdvancePacerClock(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!pacer)
+    {
+        Napi::Error::New(env, "Pacing was not enabled when the output was created").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Number expected for argument 0: milliseconds").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    pacer->Advance(info[0].As<Napi::Number>().DoubleValue() * 1000);
+    return env.Undefined();
+}
+
+Napi::Value AVFormatContextObject::SetLiveEdge(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!fmt_ctx_ || !is_input)
+    {
+        Napi::Error::New(env, "Live edge requires an open input").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    LiveEdge::Policy policy = {};
+    policy.keyframeStreamIndex = av_find_best_stream(fmt_ctx_, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (info.Length() > 0 && info[0].IsObject())
+    {
+        Napi::Object options = info[0].As<Napi::Object>();
+        // seconds.
+        policy.maxLag = 1000000;
+        if (options.Get("maxLag").IsNumber())
+        {
+            policy.maxLag = options.Get("maxLag").As<Napi::Number>().DoubleValue() * 1000000;
+        }
+        if (options.Get("maxQueuedBytes").IsNumber())
+        {
+            policy.maxQueuedBytes = options.Get("maxQueuedBytes").As<Napi::Number>().Int64Value();
+        }
+        if (options.Get("keyframeStreamIndex").IsNumber())
+        {
+            policy.keyframeStreamIndex = options.Get("keyframeStreamIndex").As<Napi::Number>().Int32Value();
+        }
+    }
+
+    if (policy.keyframeStreamIndex < 0 && (policy.maxLag || policy.maxQueuedBytes))
+    {
+        Napi::Error::New(env, "No video stream, keyframeStreamIndex is required").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!liveEdge)
+    {
+        liveEdge = new LiveEdge();
+    }
+    liveEdge->Configure(policy);
+    return env.Undefined();
+}
+
+Napi::Value AVFormatContextObject::GetLiveEdgeStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!liveEdge)
+    {
+        return env.Undefined();
+    }
+
+    LiveEdge::Stats liveEdgeStats = liveEdge->GetStats();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("lag", Napi::Number::New(env, (double)liveEdgeStats.lag / 1000000));
+    stats.Set("peakLag", Napi::Number::New(env, (double)liveEdgeStats.peakLag / 1000000));
+    stats.Set("droppedPackets", Napi::Number::New(env, liveEdgeStats.droppedPackets));
+    stats.Set("catchUps", Napi::Number::New(env, liveEdgeStats.catchUps));
+    stats.Set("catchingUp", Napi::Boolean::New(env, liveEdgeStats.catchingUp));
+    return stats;
+}
+
+Napi::Value AVFormatContextObject::GetReadaheadStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!readahead)
+    {
+        return env.Undefined();
+    }
+
+    Readahead::Stats readaheadStats = readahead->GetStats();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("packets", Napi::Number::New(env, readaheadStats.packets));
+    stats.Set("bytes", Napi::Number::New(env, readaheadStats.bytes));
+    stats.Set("duration", Napi::Number::New(env, (double)readaheadStats.duration / 1000000));
+    stats.Set("overflows", Napi::Number::New(env, readaheadStats.overflows));
+    stats.Set("underruns", Napi::Number::New(env, readaheadStats.underruns));
+    return stats;
+}
+
+Napi::Value AVFormatContextObject::GetPriority(const Napi::CallbackInfo &info)
+{
+    return Napi::String::New(info.Env(), JobScheduler::PriorityName(priority));
+}
+
+void AVFormatContextObject::SetPriority(const Napi::CallbackInfo &info, const Napi::Value &value)
+{
+    JobScheduler::ParsePriority(info.Env(), value, &priority);
+}
+
+Napi::Value AVFormatContextObject::CreateHLS(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (fmt_ctx_)
+    {
+        Napi::Error::New(env, "Format context already created").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info.Length() > 0 && info[0].IsObject() ? info[0].As<Napi::Object>() : Napi::Object::New(env);
+
+    std::string formatName = "mpegts";
+    Napi::Value formatValue = options.Get("format");
+    if (formatValue.IsString())
+    {
+        formatName = formatValue.As<Napi::String>().Utf8Value();
+    }
+    if (formatName != "mpegts" && formatName != "mp4")
+    {
+        Napi::TypeError::New(env, "HLS format must be mpegts or mp4").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int64_t segmentDuration = 2 * AV_TIME_BASE;
+    Napi::Value segmentDurationValue = options.Get("segmentDuration");
+    if (segmentDurationValue.IsNumber())
+    {
+        segmentDuration = segmentDurationValue.As<Napi::Number>().DoubleValue() * AV_TIME_BASE;
+    }
+
+    int64_t partDuration = 0;
+    Napi::Value partDurationValue = options.Get("partDuration");
+    if (partDurationValue.IsNumber())
+    {
+        partDuration = partDurationValue.As<Napi::Number>().DoubleValue() * AV_TIME_BASE;
+    }
+
+    size_t windowSize = 6;
+    Napi::Value windowSizeValue = options.Get("windowSize");
+    if (windowSizeValue.IsNumber())
+    {
+        windowSize = windowSizeValue.As<Napi::Number>().Uint32Value();
+    }
+
+    std::string prefix = "segment";
+    Napi::Value prefixValue = options.Get("prefix");
+    if (prefixValue.IsString())
+    {
+        prefix = prefixValue.As<Napi::String>().Utf8Value();
+    }
+
+    Napi::Value canBlockReloadValue = options.Get("canBlockReload");
+    bool canBlockReload = canBlockReloadValue.IsBoolean() && canBlockReloadValue.As<Napi::Boolean>().Value();
+
+    int ret = avformat_alloc_output_context2(&fmt_ctx_, NULL, formatName.c_str(), NULL);
+    if (ret)
+    {
+        Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    bool fragmentedMP4 = formatName == "mp4";
+    if (fragmentedMP4)
+    {
+        av_opt_set(fmt_ctx_->priv_data, "movflags", "frag_custom+empty_moov+default_base_moof+skip_trailer", 0);
+    }
+
+    HLSSegmenter *segmenter = new HLSSegmenter(fragmentedMP4, segmentDuration, partDuration, windowSize, prefix, canBlockReload);
+    auto onFragment = [segmenter](const OutputFragment &fragment)
+    { segmenter->OnFragment(fragment); };
+    if (partDuration > 0)
+    {
+        // parts are cut at the part target regardless of keyframes, segments start at keyframes.
+        fragmentedOutput = new FragmentedOutput(partDuration, false, onFragment);
+        fragmentedOutput->SetSegmentDuration(segmentDuration);
+    }
+    else
+    {
+        fragmentedOutput = new FragmentedOutput(segmentDuration, true, onFragment);
+    }
+
+    int MAX_MEM_SIZE = 1024 * 1024;
+    uint8_t *buffer = (uint8_t *)av_malloc(MAX_MEM_SIZE);
+    AVIOContext *avio_ctx = buffer ? avio_alloc_context(buffer, MAX_MEM_SIZE, 1, fragmentedOutput, NULL, FragmentedOutput::Write, NULL) : nullptr;
+    if (!avio_ctx)
+    {
+        av_free(buffer);
+        delete fragmentedOutput;
+        fragmentedOutput = nullptr;
+        delete segmenter;
+        avformat_free_context(fmt_ctx_);
+        fmt_ctx_ = nullptr;
+        Napi::Error::New(env, "Failed to create AVIOContext").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    hlsSegmenter = segmenter;
+    fmt_ctx_->pb = avio_ctx;
+
+    return env.Undefined();
+}
+
+static Napi::Value toBuffer(Napi::Env env, AVBufferRef *ref)
+{
+    if (!ref)
+    {
+        return env.Undefined();
+    }
+    return Napi::Buffer<uint8_t>::NewOrCopy(env, ref->data, ref->size, [](Napi::Env env, uint8_t *data, AVBufferRef *ref)
+                                            { av_buffer_unref(&ref); }, ref);
+}
+
+Napi::Value AVFormatContextObject::GetPlaylist(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!hlsSegmenter)
+    {
+        Napi::Error::New(env, "HLS segmenter not created").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::String::New(env, hlsSegmenter->GetPlaylist());
+}
+
+Napi::Value AVFormatContextObject::GetSegment(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!hlsSegmenter)
+    {
+        Napi::Error::New(env, "HLS segmenter not created").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Number expected for argument 0: sequence").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int64_t sequence = info[0].As<Napi::Number>().Int64Value();
+    int part = info.Length() > 1 && info[1].IsNumber() ? info[1].As<Napi::Number>().Int32Value() : -1;
+    return toBuffer(env, hlsSegmenter->GetSegment(sequence, part));
+}
+
+Napi::Value AVFormatContextObject::GetInit(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (!hlsSegmenter)
+    {
+        Napi::Error::New(env, "HLS segmenter not created").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return toBuffer(env, hlsSegmenter->GetInit());
+}
+
 Napi::Value createSDP(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -847,6 +1985,11 @@ Napi::Object Init(Napi::Env env, Napi::Object exports)
     AVCodecContextObject::Init(env, exports);
     AVFormatContextObject::Init(env, exports);
     AVBitstreamFilterObject::Init(env, exports);
+    AVBroadcasterObject::Init(env, exports);
+    AVFrameBusObject::Init(env, exports);
+    AVInputSchedulerObject::Init(env, exports);
+    JobScheduler::Init(env, exports);
+    CodecPool::Init(env, exports);
 
     exports.Set(Napi::String::New(env, "setLogLevel"), Napi::Function::New(env, setLogLevel));
     exports.Set(Napi::String::New(env, "createSdp"), Napi::Function::New(env, createSDP));
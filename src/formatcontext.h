@@ -22,6 +22,24 @@ extern "C"
 #endif
 }
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "worker/scheduled-worker.h"
+
+class MmapInput;
+class PushInput;
+class FragmentedOutput;
+class HLSSegmenter;
+struct SRTPContext;
+class UdpSink;
+class RtpPacer;
+class LiveEdge;
+class StreamWorker;
+class Readahead;
+
 class AVFormatContextObject : public Napi::ObjectWrap<AVFormatContextObject>
 {
 public:
@@ -32,17 +50,82 @@ public:
     AVFormatContext *fmt_ctx_;
     Napi::ThreadSafeFunction callbackRef;
     bool is_input;
+    MmapInput *mmapInput;
+    PushInput *pushInput;
+    FragmentedOutput *fragmentedOutput;
+    HLSSegmenter *hlsSegmenter;
+    // protects written packets before they reach the callback.
+    SRTPContext *srtp;
+    std::mutex srtpMutex;
+    // sends rtp output to a socket instead of the callback.
+    UdpSink *udpSink;
+    RtpPacer *pacer;
+    // drops packets of a live input to catch up after falling behind.
+    LiveEdge *liveEdge;
+    // threads of the input streams whose pipelines run in parallel, by stream index.
+    std::map<int, StreamWorker *> streamWorkers;
+    // reads the input ahead of the pipeline on its own thread, started by open.
+    Readahead *readahead;
+    // time base of the source of each output stream, ie the encoder or input stream.
+    std::vector<AVRational> sourceTimeBases;
+    // streams whose packets are rescaled from the source time base, ie streams created with addStream.
+    std::vector<bool> rescaleTimestamps;
+    bool headerWritten;
+    // the output is finished, nothing more can be added or written.
+    bool trailerWritten;
+    // set by abort and close, interrupts blocking io of the input.
+    std::atomic<bool> aborted;
+    // monotonic microseconds after which blocking io is interrupted, 0 for none.
+    std::atomic<int64_t> ioDeadline;
+    // default for reads, microseconds, 0 for none.
+    int64_t readTimeout;
+    // held while a worker uses the input, so close waits for it.
+    std::mutex ioMutex;
+    // serializes writers of an output, ie stream workers and broadcaster subscribers.
+    std::mutex writeMutex;
+    // class of the readFrame and receiveFrame workers.
+    JobScheduler::Priority priority;
+    // orders the readFrame and receiveFrame workers.
+    SerialExecutor executor;
+
+    int WritePacket(AVPacket *packet);
+    static int InterruptCallback(void *opaque);
+    // the error of io interrupted by abort or a deadline.
+    int InterruptedError();
 
 private:
     Napi::Value Open(const Napi::CallbackInfo &info);
+    Napi::Value OpenStream(const Napi::CallbackInfo &info);
+    Napi::Value Push(const Napi::CallbackInfo &info);
+    Napi::Value End(const Napi::CallbackInfo &info);
     Napi::Value Close(const Napi::CallbackInfo &info);
+    Napi::Value Abort(const Napi::CallbackInfo &info);
     Napi::Value CreateDecoder(const Napi::CallbackInfo &info);
     Napi::Value GetMetadata(const Napi::CallbackInfo &info);
     Napi::Value ReadFrame(const Napi::CallbackInfo &info);
     Napi::Value ReceiveFrame(const Napi::CallbackInfo &info);
     Napi::Value Create(const Napi::CallbackInfo &info);
     Napi::Value NewStream(const Napi::CallbackInfo &info);
+    Napi::Value AddStream(const Napi::CallbackInfo &info);
+    Napi::Value WriteHeader(const Napi::CallbackInfo &info);
+    Napi::Value WriteTrailer(const Napi::CallbackInfo &info);
+    AVStream *AddStreamFromOptions(const Napi::CallbackInfo &info);
+    void AfterWrite(AVPacket *packet, int ret);
     Napi::Value WriteFrame(const Napi::CallbackInfo &info);
     Napi::Value GetStreams(const Napi::CallbackInfo &info);
     Napi::Value CreateSDP(const Napi::CallbackInfo &info);
+    Napi::Value SetSRTP(const Napi::CallbackInfo &info);
+    Napi::Value GetUDPStats(const Napi::CallbackInfo &info);
+    Napi::Value GetPacerStats(const Napi::CallbackInfo &info);
+    Napi::Value AdvancePacerClock(const Napi::CallbackInfo &info);
+    Napi::Value SetLiveEdge(const Napi::CallbackInfo &info);
+    Napi::Value GetLiveEdgeStats(const Napi::CallbackInfo &info);
+    Napi::Value GetReadaheadStats(const Napi::CallbackInfo &info);
+    Napi::Value GetPriority(const Napi::CallbackInfo &info);
+    void SetPriority(const Napi::CallbackInfo &info, const Napi::Value &value);
+    void DestroyOutput();
+    Napi::Value CreateHLS(const Napi::CallbackInfo &info);
+    Napi::Value GetPlaylist(const Napi::CallbackInfo &info);
+    Napi::Value GetSegment(const Napi::CallbackInfo &info);
+    Napi::Value GetInit(const Napi::CallbackInfo &info);
 };
@@ -0,0 +1,196 @@
+#include "fragmented-output.h"
+
+extern "C"
+{
+#include <libavutil/mem.h>
+#include <libavutil/opt.h>
+}
+
+#include <algorithm>
+#include <cstring>
+
+FragmentedOutput::FragmentedOutput(int64_t fragmentDuration, bool keyframeAligned, std::function<void(const OutputFragment &)> onFragment)
+    : fragmentDuration(fragmentDuration), keyframeAligned(keyframeAligned), onFragment(onFragment),
+      segmentDuration(0), segmentStart(AV_NOPTS_VALUE),
+      referenceStream(0), fragmentStart(AV_NOPTS_VALUE), fragmentEnd(AV_NOPTS_VALUE), fragmentKeyframe(false), fragmentSegmentStart(false),
+      data(nullptr), size(0), capacity(0), lastSize(0)
+{
+}
+
+FragmentedOutput::~FragmentedOutput()
+{
+    av_free(data);
+}
+
+int FragmentedOutput::Write(void *opaque, const uint8_t *buf, int buf_size)
+{
+    FragmentedOutput *output = (FragmentedOutput *)opaque;
+
+    if (output->size + buf_size > output->capacity)
+    {
+        // start at the size of the previous fragment to avoid regrowing every time.
+        size_t capacity = std::max(output->capacity * 2, output->lastSize);
+        capacity = std::max(capacity, output->size + buf_size);
+        uint8_t *data = (uint8_t *)av_realloc(output->data, capacity);
+        if (!data)
+        {
+            return AVERROR(ENOMEM);
+        }
+        output->data = data;
+        output->capacity = capacity;
+    }
+
+    memcpy(output->data + output->size, buf, buf_size);
+    output->size += buf_size;
+    return buf_size;
+}
+
+void FragmentedOutput::SetSegmentDuration(int64_t duration)
+{
+    segmentDuration = duration;
+}
+
+void FragmentedOutput::Emit(bool init, bool keyframe, bool startsSegment, int64_t pts, int64_t duration)
+{
+    if (!size)
+    {
+        return;
+    }
+
+    OutputFragment fragment;
+    fragment.data = data;
+    fragment.size = size;
+    fragment.init = init;
+    fragment.keyframe = keyframe;
+    fragment.segmentStart = startsSegment;
+    fragment.pts = pts;
+    fragment.duration = duration;
+
+    lastSize = size;
+    data = nullptr;
+    size = 0;
+    capacity = 0;
+
+    onFragment(fragment);
+}
+
+int FragmentedOutput::WriteHeader(AVFormatContext *ctx, AVDictionary **options)
+{
+    referenceStream = 0;
+    for (unsigned int i = 0; i < ctx->nb_streams; i++)
+    {
+        if (ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+        {
+            referenceStream = i;
+            break;
+        }
+    }
+
+    int ret = avformat_write_header(ctx, options);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    avio_flush(ctx->pb);
+    Emit(true, false, false, AV_NOPTS_VALUE, 0);
+    return ret;
+}
+
+int FragmentedOutput::FlushFragment(AVFormatContext *ctx, int64_t nextStart)
+{
+    // a null packet makes the muxer write out everything it has buffered.
+    int ret = av_write_frame(ctx, NULL);
+    if (ret < 0)
+    {
+        return ret;
+    }
+    avio_flush(ctx->pb);
+
+    int64_t end = nextStart != AV_NOPTS_VALUE ? nextStart : fragmentEnd;
+    int64_t duration = end != AV_NOPTS_VALUE && fragmentStart != AV_NOPTS_VALUE ? end - fragmentStart : 0;
+    Emit(false, fragmentKeyframe, fragmentSegmentStart, fragmentStart, duration);
+
+    fragmentStart = AV_NOPTS_VALUE;
+    fragmentEnd = AV_NOPTS_VALUE;
+    fragmentKeyframe = false;
+    fragmentSegmentStart = false;
+    return 0;
+}
+
+int FragmentedOutput::WritePacket(AVFormatContext *ctx, AVPacket *packet)
+{
+    if (packet->stream_index == referenceStream)
+    {
+        AVStream *stream = ctx->streams[packet->stream_index];
+        int64_t ts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+        if (ts != AV_NOPTS_VALUE)
+        {
+            int64_t time = av_rescale_q(ts, stream->time_base, AV_TIME_BASE_Q);
+            int64_t packetDuration = av_rescale_q(packet->duration, stream->time_base, AV_TIME_BASE_Q);
+            bool keyframe = packet->flags & AV_PKT_FLAG_KEY;
+
+            bool cut = false;
+            bool newSegment = segmentStart == AV_NOPTS_VALUE || segmentDuration <= 0;
+            if (fragmentStart != AV_NOPTS_VALUE)
+            {
+                if (segmentDuration > 0 && keyframe && time - segmentStart >= segmentDuration)
+                {
+                    cut = true;
+                    newSegment = true;
+                }
+                else if (keyframeAligned)
+                {
+                    cut = keyframe && time - fragmentStart >= fragmentDuration;
+                }
+                else if (packetDuration > 0)
+                {
+                    // cut before the packet that would make the fragment exceed the target.
+                    cut = time + packetDuration - fragmentStart > fragmentDuration;
+                }
+                else
+                {
+                    cut = time - fragmentStart >= fragmentDuration;
+                }
+            }
+
+            if (cut)
+            {
+                int ret = FlushFragment(ctx, time);
+                if (ret < 0)
+                {
+                    return ret;
+                }
+            }
+
+            if (fragmentStart == AV_NOPTS_VALUE)
+            {
+                fragmentStart = time;
+                fragmentKeyframe = keyframe;
+                fragmentSegmentStart = newSegment;
+                if (newSegment)
+                {
+                    segmentStart = time;
+                    // each mpegts segment needs its own PAT/PMT to be decodable on its own.
+                    if (!strcmp(ctx->oformat->name, "mpegts"))
+                    {
+                        av_opt_set(ctx->priv_data, "mpegts_flags", "+resend_headers", 0);
+                    }
+                }
+            }
+            int64_t end = time + packetDuration;
+            fragmentEnd = fragmentEnd == AV_NOPTS_VALUE ? end : std::max(fragmentEnd, end);
+        }
+    }
+
+    return av_write_frame(ctx, packet);
+}
+
+int FragmentedOutput::Flush(AVFormatContext *ctx)
+{
+    if (fragmentStart == AV_NOPTS_VALUE)
+    {
+        return 0;
+    }
+    return FlushFragment(ctx, AV_NOPTS_VALUE);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+#include <functional>
+
+struct OutputFragment
+{
+    // av_malloc'd, ownership passes to the fragment callback.
+    uint8_t *data;
+    size_t size;
+    // the header written by avformat_write_header, ie the fMP4 init segment.
+    bool init;
+    // the fragment starts with a keyframe.
+    bool keyframe;
+    // the fragment starts a new segment, see SetSegmentDuration.
+    bool segmentStart;
+    // AV_TIME_BASE units.
+    int64_t pts;
+    int64_t duration;
+};
+
+// Collects muxer output in memory and cuts it into self contained fragments,
+// ie moof+mdat for fragmented mp4, by flushing the muxer at keyframes or
+// once a target duration has been written.
+// Keyframe aligned fragments are at least fragmentDuration long, otherwise
+// fragmentDuration is the maximum and cuts may fall between keyframes.
+// Requires a muxer that supports flushing (AVFMT_ALLOW_FLUSH).
+class FragmentedOutput
+{
+public:
+    FragmentedOutput(int64_t fragmentDuration, bool keyframeAligned, std::function<void(const OutputFragment &)> onFragment);
+    ~FragmentedOutput();
+
+    // additionally cut at the first keyframe after this duration and flag the
+    // fragment as the start of a segment, ie for LL-HLS parts within segments.
+    void SetSegmentDuration(int64_t duration);
+    int WriteHeader(AVFormatContext *ctx, AVDictionary **options);
+    int WritePacket(AVFormatContext *ctx, AVPacket *packet);
+    // emits any buffered packets as a final fragment.
+    int Flush(AVFormatContext *ctx);
+
+    static int Write(void *opaque, const uint8_t *buf, int buf_size);
+
+private:
+    int FlushFragment(AVFormatContext *ctx, int64_t nextStart);
+    void Emit(bool init, bool keyframe, bool startsSegment, int64_t pts, int64_t duration);
+
+    int64_t fragmentDuration;
+    bool keyframeAligned;
+    std::function<void(const OutputFragment &)> onFragment;
+    int64_t segmentDuration;
+    int64_t segmentStart;
+
+    // the stream whose timestamps and keyframes decide fragment boundaries.
+    int referenceStream;
+    int64_t fragmentStart;
+    int64_t fragmentEnd;
+    bool fragmentKeyframe;
+    bool fragmentSegmentStart;
+
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    size_t lastSize;
+};
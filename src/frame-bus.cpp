@@ -0,0 +1,351 @@
+#include "frame-bus.h"
+#include "frame.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/mathematics.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+Napi::FunctionReference AVFrameBusObject::constructor;
+
+static const size_t DEFAULT_QUEUE_SIZE = 4;
+
+Napi::Object AVFrameBusObject::Init(Napi::Env env, Napi::Object exports)
+{
+    Napi::HandleScope scope(env);
+
+    Napi::Function func = DefineClass(env, "AVFrameBus", {
+                                                             InstanceMethod(Napi::Symbol::WellKnown(env, "dispose"), &AVFrameBusObject::Close),
+                                                             InstanceMethod("publish", &AVFrameBusObject::PublishJS),
+                                                             InstanceMethod("subscribe", &AVFrameBusObject::Subscribe),
+                                                             InstanceMethod("unsubscribe", &AVFrameBusObject::Unsubscribe),
+                                                             InstanceMethod("getStats", &AVFrameBusObject::GetStats),
+                                                             InstanceMethod("close", &AVFrameBusObject::Close),
+                                                         });
+
+    constructor = Napi::Persistent(func);
+    constructor.SuppressDestruct();
+
+    exports.Set("AVFrameBus", func);
+    return exports;
+}
+
+AVFrameBusObject::AVFrameBusObject(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<AVFrameBusObject>(info), nextId(0), published(0), closed(false)
+{
+}
+
+AVFrameBusObject::~AVFrameBusObject()
+{
+    Shutdown();
+}
+
+void AVFrameBusObject::Shutdown()
+{
+    std::map<int, std::shared_ptr<Subscriber>> stopping;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        stopping.swap(subscribers);
+    }
+    for (auto &pair : stopping)
+    {
+        Stop(pair.second);
+    }
+}
+
+// frame time in microseconds, from the timestamp when it has one so files read
+// faster than realtime are throttled by media time.
+static int64_t frameTime(AVFrame *frame)
+{
+    if (frame->pts != AV_NOPTS_VALUE && frame->time_base.num > 0 && frame->time_base.den > 0)
+    {
+        return av_rescale_q(frame->pts, frame->time_base, AV_TIME_BASE_Q);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AVFrameBusObject::Offer(Subscriber *subscriber, AVFrame *frame, int64_t time)
+{
+    std::lock_guard<std::mutex> lock(subscriber->mutex);
+    if (subscriber->stopped)
+    {
+        return;
+    }
+
+    if (subscriber->minInterval)
+    {
+        // a timestamp going backwards, ie a seek or a new stream, restarts the throttle.
+        if (subscriber->lastAccepted != AV_NOPTS_VALUE && time >= subscriber->lastAccepted && time - subscriber->lastAccepted < subscriber->minInterval)
+        {
+            subscriber->skipped++;
+            return;
+        }
+        subscriber->lastAccepted = time;
+    }
+
+    size_t queueSize = subscriber->mode == MODE_LATEST ? 1 : subscriber->queueSize;
+    while (subscriber->mailbox.size() >= queueSize)
+    {
+        av_frame_free(&subscriber->mailbox.front());
+        subscriber->mailbox.pop_front();
+        subscriber->dropped++;
+    }
+
+    AVFrame *clone = av_frame_clone(frame);
+    if (!clone)
+    {
+        subscriber->dropped++;
+        return;
+    }
+    subscriber->mailbox.push_back(clone);
+}
+
+void AVFrameBusObject::Publish(AVFrame *frame)
+{
+    int64_t time = frameTime(frame);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closed)
+    {
+        return;
+    }
+
+    published++;
+    for (auto &pair : subscribers)
+    {
+        Offer(pair.second.get(), frame, time);
+        Schedule(pair.second);
+    }
+}
+
+void AVFrameBusObject::Schedule(std::shared_ptr<Subscriber> subscriber)
+{
+    std::lock_guard<std::mutex> lock(subscriber->mutex);
+    if (subscriber->stopped || subscriber->scheduled || subscriber->mailbox.empty())
+    {
+        return;
+    }
+
+    subscriber->scheduled = true;
+    napi_status status = subscriber->callbackRef.NonBlockingCall([subscriber](Napi::Env env, Napi::Function callback)
+                                                                 { Deliver(env, callback, subscriber); });
+    if (status != napi_ok)
+    {
+        subscriber->scheduled = false;
+    }
+}
+
+void AVFrameBusObject::Deliver(Napi::Env env, Napi::Function callback, std::shared_ptr<Subscriber> subscriber)
+{
+    AVFrame *frame;
+    {
+        std::lock_guard<std::mutex> lock(subscriber->mutex);
+        if (subscriber->stopped || subscriber->mailbox.empty())
+        {
+            subscriber->scheduled = false;
+            return;
+        }
+        frame = subscriber->mailbox.front();
+        subscriber->mailbox.pop_front();
+        subscriber->delivered++;
+    }
+
+    Napi::Value result = callback.Call({AVFrameObject::NewInstance(env, frame)});
+
+    auto next = [subscriber]()
+    {
+        {
+            std::lock_guard<std::mutex> lock(subscriber->mutex);
+            subscriber->scheduled = false;
+        }
+        Schedule(subscriber);
+    };
+
+    if (!result.IsEmpty() && result.IsPromise())
+    {
+        Napi::Function settled = Napi::Function::New(env, [next](const Napi::CallbackInfo &info)
+                                                      { next(); });
+        Napi::Object promise = result.As<Napi::Object>();
+        promise.Get("then").As<Napi::Function>().Call(promise, {settled, settled});
+        return;
+    }
+
+    // the next frame is delivered on a later tick so a busy mailbox doesn't starve the event loop.
+    next();
+}
+
+void AVFrameBusObject::Stop(std::shared_ptr<Subscriber> subscriber)
+{
+    {
+        std::lock_guard<std::mutex> lock(subscriber->mutex);
+        if (subscriber->stopped)
+        {
+            return;
+        }
+        subscriber->stopped = true;
+        for (AVFrame *frame : subscriber->mailbox)
+        {
+            av_frame_free(&frame);
+        }
+        subscriber->mailbox.clear();
+    }
+    subscriber->callbackRef.Release();
+}
+
+Napi::Value AVFrameBusObject::PublishJS(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Frame object expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    AVFrameObject *frameObject = Napi::ObjectWrap<AVFrameObject>::Unwrap(info[0].As<Napi::Object>());
+    if (!frameObject->frame_)
+    {
+        Napi::Error::New(env, "Frame is null").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Publish(frameObject->frame_);
+    return env.Undefined();
+}
+
+Napi::Value AVFrameBusObject::Subscribe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Object expected for argument 0: options").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    Napi::Value callback = options.Get("callback");
+    if (!callback.IsFunction())
+    {
+        Napi::TypeError::New(env, "callback expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::shared_ptr<Subscriber> subscriber = std::make_shared<Subscriber>();
+    subscriber->mode = MODE_LATEST;
+    subscriber->queueSize = DEFAULT_QUEUE_SIZE;
+    subscriber->minInterval = 0;
+    subscriber->lastAccepted = AV_NOPTS_VALUE;
+    subscriber->scheduled = false;
+    subscriber->stopped = false;
+    subscriber->delivered = 0;
+    subscriber->dropped = 0;
+    subscriber->skipped = 0;
+
+    Napi::Value mode = options.Get("mode");
+    if (mode.IsString())
+    {
+        std::string modeString = mode.As<Napi::String>().Utf8Value();
+        if (modeString == "every")
+        {
+            subscriber->mode = MODE_EVERY;
+        }
+        else if (modeString != "latest")
+        {
+            Napi::TypeError::New(env, "mode must be every or latest").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    if (options.Get("queueSize").IsNumber())
+    {
+        subscriber->queueSize = std::max(1u, options.Get("queueSize").As<Napi::Number>().Uint32Value());
+    }
+
+    if (options.Get("maxFps").IsNumber())
+    {
+        double maxFps = options.Get("maxFps").As<Napi::Number>().DoubleValue();
+        if (maxFps > 0)
+        {
+            subscriber->minInterval = (int64_t)(1000000 / maxFps);
+        }
+    }
+
+    subscriber->callbackRef = Napi::ThreadSafeFunction::New(
+        env,
+        callback.As<Napi::Function>(),
+        "napi_frame_bus",
+        0,
+        1);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closed)
+    {
+        subscriber->callbackRef.Release();
+        Napi::Error::New(env, "Frame bus is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    subscriber->id = nextId++;
+    subscribers[subscriber->id] = subscriber;
+    return Napi::Number::New(env, subscriber->id);
+}
+
+Napi::Value AVFrameBusObject::Unsubscribe(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Number expected for argument 0: subscriber id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int id = info[0].As<Napi::Number>().Int32Value();
+    std::shared_ptr<Subscriber> subscriber;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = subscribers.find(id);
+        if (it == subscribers.end())
+        {
+            return Napi::Boolean::New(env, false);
+        }
+        subscriber = it->second;
+        subscribers.erase(it);
+    }
+
+    Stop(subscriber);
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value AVFrameBusObject::GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    Napi::Object stats = Napi::Object::New(env);
+    Napi::Array subscriberStats = Napi::Array::New(env);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.Set("published", Napi::Number::New(env, published));
+    uint32_t i = 0;
+    for (auto &pair : subscribers)
+    {
+        Subscriber *subscriber = pair.second.get();
+        std::lock_guard<std::mutex> subscriberLock(subscriber->mutex);
+        Napi::Object s = Napi::Object::New(env);
+        s.Set("id", Napi::Number::New(env, subscriber->id));
+        s.Set("queued", Napi::Number::New(env, subscriber->mailbox.size()));
+        s.Set("delivered", Napi::Number::New(env, subscriber->delivered));
+        s.Set("dropped", Napi::Number::New(env, subscriber->dropped));
+        s.Set("skipped", Napi::Number::New(env, subscriber->skipped));
+        subscriberStats.Set(i++, s);
+    }
+    stats.Set("subscribers", subscriberStats);
+    return stats;
+}
+
+Napi::Value AVFrameBusObject::Close(const Napi::CallbackInfo &info)
+{
+    Shutdown();
+    return info.Env().Undefined();
+}
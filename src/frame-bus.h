@@ -0,0 +1,78 @@
+#pragma once
+
+#include <napi.h>
+extern "C"
+{
+#include <libavutil/frame.h>
+}
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Hands out references to the frames of a decoder or filter to any number of
+// js consumers, ie motion detection, object detection and thumbnails.
+// Publishing never waits on a consumer: each subscriber has a mailbox that
+// either queues every frame up to a bound, or only keeps the latest frame,
+// optionally throttled to a maximum frame rate. A consumer that returns a
+// promise is not given another frame until it settles.
+class AVFrameBusObject : public Napi::ObjectWrap<AVFrameBusObject>
+{
+public:
+    enum Mode
+    {
+        MODE_EVERY,
+        MODE_LATEST,
+    };
+
+    struct Subscriber
+    {
+        int id;
+        Mode mode;
+        size_t queueSize;
+        // microseconds between accepted frames, 0 for no limit.
+        int64_t minInterval;
+        int64_t lastAccepted;
+
+        Napi::ThreadSafeFunction callbackRef;
+        std::mutex mutex;
+        std::deque<AVFrame *> mailbox;
+        // a delivery is queued to js, or a returned promise is pending.
+        bool scheduled;
+        bool stopped;
+
+        uint64_t delivered;
+        uint64_t dropped;
+        uint64_t skipped;
+    };
+
+    static Napi::FunctionReference constructor;
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+    AVFrameBusObject(const Napi::CallbackInfo &info);
+    ~AVFrameBusObject();
+
+    // may be called from any thread, ie a read frame worker. the frame is referenced, not taken.
+    void Publish(AVFrame *frame);
+
+private:
+    Napi::Value PublishJS(const Napi::CallbackInfo &info);
+    Napi::Value Subscribe(const Napi::CallbackInfo &info);
+    Napi::Value Unsubscribe(const Napi::CallbackInfo &info);
+    Napi::Value GetStats(const Napi::CallbackInfo &info);
+    Napi::Value Close(const Napi::CallbackInfo &info);
+
+    static void Offer(Subscriber *subscriber, AVFrame *frame, int64_t time);
+    static void Schedule(std::shared_ptr<Subscriber> subscriber);
+    static void Deliver(Napi::Env env, Napi::Function callback, std::shared_ptr<Subscriber> subscriber);
+    static void Stop(std::shared_ptr<Subscriber> subscriber);
+    void Shutdown();
+
+    std::mutex mutex;
+    int nextId;
+    uint64_t published;
+    std::map<int, std::shared_ptr<Subscriber>> subscribers;
+    bool closed;
+};
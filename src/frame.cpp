@@ -17,6 +17,7 @@ extern "C"
 
 #include "error.h"
 #include "codeccontext.h"
+#include "codec-pool.h"
 #include "frame.h"
 #include "filter.h"
 
@@ -58,6 +59,8 @@ Napi::Object AVFrameObject::Init(Napi::Env env, Napi::Object exports)
 
                                                                 InstanceMethod("destroy", &AVFrameObject::Destroy),
 
+                                                                InstanceMethod("clone", &AVFrameObject::Clone),
+
                                                                 InstanceMethod("toBuffer", &AVFrameObject::ToBuffer),
 
                                                                 InstanceMethod("fromBuffer", &AVFrameObject::FromBuffer),
@@ -324,8 +327,17 @@ Napi::Value AVFrameObject::CreateEncoder(const Napi::CallbackInfo &info)
         }
     }
 
+    // a pooled encoder with the same configuration skips the open.
+    std::string poolKey = CodecPool::EncoderKey(c);
+    AVCodecContext *pooled = CodecPool::Acquire(poolKey);
+    if (pooled)
+    {
+        avcodec_free_context(&c);
+        c = pooled;
+    }
+
     int ret;
-    if ((ret = avcodec_open2(c, codec, NULL)) < 0)
+    if (!pooled && (ret = avcodec_open2(c, codec, NULL)) < 0)
     {
         avcodec_free_context(&c);
         Napi::Error::New(env, AVErrorString(ret)).ThrowAsJavaScriptException();
@@ -335,6 +347,7 @@ Napi::Value AVFrameObject::CreateEncoder(const Napi::CallbackInfo &info)
     Napi::Value codecContextObject = AVCodecContextObject::NewInstance(env);
     AVCodecContextObject *codecContextWrapper = Napi::ObjectWrap<AVCodecContextObject>::Unwrap(codecContextObject.As<Napi::Object>());
     codecContextWrapper->codecContext = c;
+    codecContextWrapper->poolKey = poolKey;
     return codecContextObject;
 }
 
@@ -425,6 +438,24 @@ Napi::Value AVFrameObject::ToBuffer(const Napi::CallbackInfo &info)
     return buffer;
 }
 
+Napi::Value AVFrameObject::Clone(const Napi::CallbackInfo &info)
+{
+    if (!frame_)
+    {
+        return info.Env().Undefined();
+    }
+
+    // references the same data, ie the same hardware surface.
+    AVFrame *newFrame = av_frame_clone(frame_);
+    if (!newFrame)
+    {
+        Napi::Error::New(info.Env(), "Failed to reference AVFrame").ThrowAsJavaScriptException();
+        return info.Env().Undefined();
+    }
+
+    return NewInstance(info.Env(), newFrame);
+}
+
 Napi::Value AVFrameObject::Destroy(const Napi::CallbackInfo &info)
 {
     if (frame_)
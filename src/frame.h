@@ -53,6 +53,7 @@ private:
     void SetSampleCount(const Napi::CallbackInfo &info, const Napi::Value &value);
 
     Napi::Value Destroy(const Napi::CallbackInfo &info);
+    Napi::Value Clone(const Napi::CallbackInfo &info);
     Napi::Value CreateEncoder(const Napi::CallbackInfo &info);
     Napi::Value ToBuffer(const Napi::CallbackInfo &info);
     Napi::Value FromBuffer(const Napi::CallbackInfo &info);
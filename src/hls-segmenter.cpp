@@ -0,0 +1,265 @@
+#include "hls-segmenter.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// parts are only listed for the segments nearest the live edge.
+static const size_t PART_SEGMENTS = 3;
+
+HLSSegmenter::HLSSegmenter(bool fragmentedMP4, int64_t segmentDuration, int64_t partDuration, size_t windowSize, const std::string &prefix, bool canBlockReload)
+    : fragmentedMP4(fragmentedMP4), segmentDuration(segmentDuration), partDuration(partDuration),
+      windowSize(std::max(windowSize, (size_t)1)), prefix(prefix), canBlockReload(canBlockReload),
+      init(nullptr), nextSequence(0), maxSegmentDuration(0)
+{
+}
+
+HLSSegmenter::~HLSSegmenter()
+{
+    for (Segment &segment : segments)
+    {
+        FreeSegment(segment);
+    }
+    av_buffer_unref(&init);
+}
+
+void HLSSegmenter::FreeParts(Segment &segment)
+{
+    for (Part &part : segment.parts)
+    {
+        av_buffer_unref(&part.data);
+    }
+    segment.parts.clear();
+}
+
+void HLSSegmenter::FreeSegment(Segment &segment)
+{
+    FreeParts(segment);
+    av_buffer_unref(&segment.data);
+}
+
+void HLSSegmenter::CompleteSegment(Segment &segment)
+{
+    if (segment.data || segment.parts.empty())
+    {
+        return;
+    }
+
+    if (segment.parts.size() == 1)
+    {
+        segment.data = av_buffer_ref(segment.parts[0].data);
+    }
+    else
+    {
+        size_t size = 0;
+        for (const Part &part : segment.parts)
+        {
+            size += part.data->size;
+        }
+        segment.data = av_buffer_alloc(size);
+        if (segment.data)
+        {
+            uint8_t *p = segment.data->data;
+            for (const Part &part : segment.parts)
+            {
+                memcpy(p, part.data->data, part.data->size);
+                p += part.data->size;
+            }
+        }
+    }
+
+    maxSegmentDuration = std::max(maxSegmentDuration, segment.duration);
+}
+
+void HLSSegmenter::OnFragment(const OutputFragment &fragment)
+{
+    // take ownership of the fragment without copying it.
+    AVBufferRef *buffer = av_buffer_create(fragment.data, fragment.size, av_buffer_default_free, NULL, 0);
+    if (!buffer)
+    {
+        av_free(fragment.data);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (fragment.init)
+    {
+        av_buffer_unref(&init);
+        init = buffer;
+        return;
+    }
+
+    if (fragment.segmentStart || segments.empty())
+    {
+        if (!segments.empty())
+        {
+            CompleteSegment(segments.back());
+        }
+        Segment segment;
+        segment.sequence = nextSequence++;
+        segment.data = nullptr;
+        segment.duration = 0;
+        segments.push_back(segment);
+    }
+
+    Segment &segment = segments.back();
+    Part part;
+    part.data = buffer;
+    part.duration = fragment.duration;
+    part.independent = fragment.keyframe;
+    segment.parts.push_back(part);
+    segment.duration += fragment.duration;
+
+    // without parts every fragment is a whole segment.
+    if (!partDuration)
+    {
+        CompleteSegment(segment);
+    }
+
+    // keep windowSize complete segments, plus the one in progress when there are parts.
+    // without parts no segment is ever in progress.
+    while (segments.size() > (partDuration ? windowSize + 1 : windowSize))
+    {
+        FreeSegment(segments.front());
+        segments.pop_front();
+    }
+
+    if (partDuration && segments.size() > PART_SEGMENTS)
+    {
+        Segment &old = segments[segments.size() - PART_SEGMENTS - 1];
+        if (old.data)
+        {
+            FreeParts(old);
+        }
+    }
+}
+
+std::string HLSSegmenter::SegmentUri(int64_t sequence, int part)
+{
+    const char *extension = fragmentedMP4 ? "m4s" : "ts";
+    char uri[64];
+    if (part < 0)
+    {
+        snprintf(uri, sizeof(uri), "%lld.%s", (long long)sequence, extension);
+    }
+    else
+    {
+        snprintf(uri, sizeof(uri), "%lld.%d.%s", (long long)sequence, part, extension);
+    }
+    return prefix + uri;
+}
+
+std::string HLSSegmenter::GetPlaylist()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    char line[256];
+    std::string playlist = "#EXTM3U\n";
+
+    snprintf(line, sizeof(line), "#EXT-X-VERSION:%d\n", fragmentedMP4 || partDuration ? 6 : 3);
+    playlist += line;
+
+    int64_t target = std::max(segmentDuration, maxSegmentDuration);
+    snprintf(line, sizeof(line), "#EXT-X-TARGETDURATION:%d\n", (int)std::ceil((double)target / AV_TIME_BASE));
+    playlist += line;
+
+    if (partDuration)
+    {
+        double partTarget = (double)partDuration / AV_TIME_BASE;
+        snprintf(line, sizeof(line), "#EXT-X-SERVER-CONTROL:%sPART-HOLD-BACK=%.3f\n",
+                 canBlockReload ? "CAN-BLOCK-RELOAD=YES," : "", partTarget * 3);
+        playlist += line;
+        snprintf(line, sizeof(line), "#EXT-X-PART-INF:PART-TARGET=%.3f\n", partTarget);
+        playlist += line;
+    }
+
+    // the sequence of the first listed segment.
+    int64_t mediaSequence = nextSequence;
+    for (const Segment &segment : segments)
+    {
+        if (segment.data || (partDuration && !segment.parts.empty()))
+        {
+            mediaSequence = segment.sequence;
+            break;
+        }
+    }
+    snprintf(line, sizeof(line), "#EXT-X-MEDIA-SEQUENCE:%lld\n", (long long)mediaSequence);
+    playlist += line;
+
+    if (fragmentedMP4)
+    {
+        playlist += "#EXT-X-MAP:URI=\"" + prefix + "init.mp4\"\n";
+    }
+
+    for (const Segment &segment : segments)
+    {
+        if (segment.sequence < mediaSequence)
+        {
+            continue;
+        }
+
+        if (partDuration)
+        {
+            for (size_t i = 0; i < segment.parts.size(); i++)
+            {
+                const Part &part = segment.parts[i];
+                snprintf(line, sizeof(line), "#EXT-X-PART:DURATION=%.5f,URI=\"%s\"%s\n",
+                         (double)part.duration / AV_TIME_BASE, SegmentUri(segment.sequence, i).c_str(),
+                         part.independent ? ",INDEPENDENT=YES" : "");
+                playlist += line;
+            }
+        }
+
+        if (segment.data)
+        {
+            snprintf(line, sizeof(line), "#EXTINF:%.5f,\n", (double)segment.duration / AV_TIME_BASE);
+            playlist += line;
+            playlist += SegmentUri(segment.sequence, -1) + "\n";
+        }
+    }
+
+    if (partDuration && !segments.empty())
+    {
+        // hint the next part of the segment in progress.
+        const Segment &segment = segments.back();
+        int64_t sequence = segment.data ? segment.sequence + 1 : segment.sequence;
+        int part = segment.data ? 0 : segment.parts.size();
+        playlist += "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"" + SegmentUri(sequence, part) + "\"\n";
+    }
+
+    return playlist;
+}
+
+AVBufferRef *HLSSegmenter::GetSegment(int64_t sequence, int part)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (segments.empty() || sequence < segments.front().sequence || sequence > segments.back().sequence)
+    {
+        return nullptr;
+    }
+
+    Segment &segment = segments[sequence - segments.front().sequence];
+    if (part < 0)
+    {
+        return segment.data ? av_buffer_ref(segment.data) : nullptr;
+    }
+    if ((size_t)part >= segment.parts.size())
+    {
+        return nullptr;
+    }
+    return av_buffer_ref(segment.parts[part].data);
+}
+
+AVBufferRef *HLSSegmenter::GetInit()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return init ? av_buffer_ref(init) : nullptr;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/buffer.h>
+}
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "fragmented-output.h"
+
+// Keeps a sliding window of HLS segments, and LL-HLS partial segments,
+// in refcounted memory and renders the media playlist on request.
+// Fragments arrive on the muxing thread, reads happen on the js thread.
+class HLSSegmenter
+{
+public:
+    HLSSegmenter(bool fragmentedMP4, int64_t segmentDuration, int64_t partDuration, size_t windowSize, const std::string &prefix, bool canBlockReload);
+    ~HLSSegmenter();
+
+    void OnFragment(const OutputFragment &fragment);
+    std::string GetPlaylist();
+    // returns a new reference, or null if the segment or part is not available.
+    // part < 0 requests the complete segment.
+    AVBufferRef *GetSegment(int64_t sequence, int part);
+    AVBufferRef *GetInit();
+
+private:
+    struct Part
+    {
+        AVBufferRef *data;
+        int64_t duration;
+        bool independent;
+    };
+
+    struct Segment
+    {
+        int64_t sequence;
+        std::vector<Part> parts;
+        // null until the segment is complete.
+        AVBufferRef *data;
+        int64_t duration;
+    };
+
+    void CompleteSegment(Segment &segment);
+    static void FreeSegment(Segment &segment);
+    static void FreeParts(Segment &segment);
+    std::string SegmentUri(int64_t sequence, int part);
+
+    bool fragmentedMP4;
+    int64_t segmentDuration;
+    int64_t partDuration;
+    size_t windowSize;
+    std::string prefix;
+    bool canBlockReload;
+
+    std::mutex mutex;
+    std::deque<Segment> segments;
+    AVBufferRef *init;
+    int64_t nextSequence;
+    int64_t maxSegmentDuration;
+};
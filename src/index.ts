@@ -118,6 +118,10 @@ export interface AVFrame extends AVTimeBase {
 
     [Symbol.dispose](): void;
     destroy(): void;
+    /**
+     * A new frame referencing the same data. Neither frame may be written while both are alive.
+     */
+    clone(): AVFrame;
     toBuffer(): Buffer;
     fromBuffer(buffer: Buffer): void;
     createEncoder(options: {
@@ -168,6 +172,56 @@ export interface AVPacket {
     destroy(): void;
 }
 
+/**
+ * lowLatency: slice threads and low delay output, for live view.
+ * throughput: a frame thread per core, which adds a frame of latency per thread, for bulk analysis.
+ * economy: one thread and no loop filter, for many streams that are decoded in the background.
+ */
+export type AVDecoderProfile = 'lowLatency' | 'throughput' | 'economy';
+
+/**
+ * Options given explicitly override the profile's.
+ * @param threads 0 picks a count from the cores. Defaults to 1.
+ * @param lowDelay Output frames without the reordering delay.
+ * @param fast Allow speedups that are not spec compliant.
+ * @param skipLoopFilter Skip the deblocking filter, at some cost in quality.
+ * @param opts Decoder private options.
+ */
+export interface AVDecoderOptions {
+    profile?: AVDecoderProfile;
+    threads?: number;
+    threadType?: 'frame' | 'slice' | 'auto';
+    lowDelay?: boolean;
+    fast?: boolean;
+    skipLoopFilter?: boolean;
+    opts?: Record<string, string>;
+}
+
+export interface AVDecodeStats {
+    profile?: AVDecoderProfile;
+    threads: number;
+    /**
+     * The threading the decoder is actually using.
+     */
+    threadType: 'frame' | 'slice' | 'none';
+    frames: number;
+    /**
+     * Milliseconds from sending a packet to receiving its frame, including reordering and threading delay.
+     */
+    averageLatency: number;
+    maxLatency: number;
+    lastLatency: number;
+}
+
+export interface AVEncodeResult {
+    packets: number;
+    bytes: number;
+    /**
+     * Whether each written packet was a keyframe, in write order.
+     */
+    keyframes: boolean[];
+}
+
 export interface AVCodecContext extends AVTimeBase {
     readonly hardwareDevice: string;
     /**
@@ -179,13 +233,91 @@ export interface AVCodecContext extends AVTimeBase {
     readonly vendorInfo: Record<string, any>;
     keyIntMin: number;
     gopSize: number;
+    /**
+     * The scheduling class of sendPacket, receiveFrame, sendFrame, receivePacket and snapshots
+     * using this codec. Defaults to live. See setSchedulerLimits.
+     */
+    priority: AVPriority;
 
     [Symbol.dispose](): void;
+    /**
+     * Frees the codec, or returns it to the codec pool, see setCodecPoolLimits.
+     * Pending calls finish first, the codec is released after the last of them.
+     * Throws while a pipeline uses the codec, ie a pending receiveFrame, an input scheduler input,
+     * or packets still queued to a stream thread.
+     */
     destroy(): void;
+    /**
+     * sendPacket, receiveFrame, sendFrame, receivePacket, decode, flush and encodeTo run one at a time in the order they
+     * were called, so they can be issued without awaiting each one, ie
+     * Promise.all([sendPacket(p), receiveFrame(), receiveFrame()]). A failed call doesn't cancel
+     * the ones after it. The packet or frame is referenced when sent, and may be destroyed
+     * before the promise resolves.
+     */
     sendPacket(packet: AVPacket): Promise<boolean>;
     receiveFrame(): Promise<AVFrame>;
     sendFrame(packet: AVFrame): Promise<boolean>;
     receivePacket(): Promise<AVPacket>;
+    /**
+     * Send a packet to the decoder and receive every frame it produced, in one call.
+     * Frames dropped by setOutputRate are not included.
+     */
+    decode(packet: AVPacket): Promise<AVFrame[]>;
+    /**
+     * At end of stream, receive the frames left in the decoder. The decoder is then reset,
+     * and can decode again, ie after a seek.
+     */
+    flush(): Promise<AVFrame[]>;
+    /**
+     * Send frames to the encoder and write every packet it produced to a stream of writeContext,
+     * without the packets reaching js. Timestamps are rescaled as in writeFrame.
+     * Pass null at end of stream to write the packets left in the encoder, an empty array sends nothing.
+     * writeContext must be an output with its header written.
+     * @returns The number of packets and bytes written, and whether each packet was a keyframe.
+     */
+    encodeTo(frame: AVFrame | AVFrame[] | null, writeContext: AVFormatContext, streamIndex: number): Promise<AVEncodeResult>;
+    /**
+     * Change the encoder's rate control, ie for congestion control. Applied at the next frame sent,
+     * including by a running receiveFrame pipeline. Only encoders that change rate control in place
+     * are supported: libx264, nvenc and qsv. Other encoders throw, recreate them instead.
+     * @param options.bitrate Bits per second.
+     * @param options.maxRate Bits per second.
+     * @param options.bufSize Rate control buffer size in bits.
+     */
+    reconfigure(options: {
+        bitrate?: number,
+        maxRate?: number,
+        bufSize?: number,
+    }): void;
+    /**
+     * Encode the next frame sent as a keyframe, ie on a packet loss report.
+     */
+    requestKeyframe(): void;
+    /**
+     * Drop decoded frames natively, before any filter or js object, in receiveFrame and pipelines.
+     * All given limits must pass. Pass undefined to deliver every frame.
+     * @param policy.maxFps Frames per second by timestamp.
+     * @param policy.everyNth Only deliver every nth frame.
+     * @param policy.minPtsInterval Minimum seconds between frames by timestamp.
+     * @param policy.keyframesOnly Also has the decoder skip non keyframes, where supported.
+     */
+    setOutputRate(policy?: {
+        maxFps?: number,
+        everyNth?: number,
+        minPtsInterval?: number,
+        keyframesOnly?: boolean,
+    }): void;
+    /**
+     * @returns undefined without an output rate policy.
+     */
+    getOutputRateStats(): {
+        accepted: number,
+        dropped: number,
+    } | undefined;
+    /**
+     * @returns undefined for encoders.
+     */
+    getDecodeStats(): AVDecodeStats | undefined;
 }
 
 export interface AVStream extends AVTimeBase {
@@ -201,37 +333,534 @@ export interface AVTimeBase {
     readonly timeBaseDen: number,
 }
 
+export interface AVOutputFragment {
+    type: 'init' | 'fragment';
+    size: number;
+    keyframe: boolean;
+    /**
+     * Seconds.
+     */
+    duration: number;
+    /**
+     * Seconds.
+     */
+    pts?: number;
+}
+
+export interface AVSRTPOptions {
+    /**
+     * Defaults to AES_CM_128_HMAC_SHA1_80.
+     */
+    suite?: 'AES_CM_128_HMAC_SHA1_80' | 'AES_CM_128_HMAC_SHA1_32' | 'SRTP_AES128_CM_HMAC_SHA1_80' | 'SRTP_AES128_CM_HMAC_SHA1_32';
+    /**
+     * The 16 byte master key, or the master key followed by the master salt if salt is not provided.
+     */
+    key: Buffer;
+    /**
+     * The 14 byte master salt.
+     */
+    salt?: Buffer;
+}
+
+export interface AVPacingOptions {
+    /**
+     * Token bucket rate in bits per second. Defaults to 0, only spread frames over time.
+     */
+    bitrate?: number;
+    /**
+     * Token bucket size in bytes. Defaults to 10ms at the bitrate.
+     */
+    burst?: number;
+    /**
+     * Fraction of the frame interval a frame's packets are spread over. Defaults to 0.5.
+     */
+    spread?: number;
+    /**
+     * 'manual' paces against a clock advanced by advancePacerClock instead of a native timer thread, for tests.
+     */
+    clock?: 'realtime' | 'manual';
+}
+
+export type AVStreamSource = {
+    codecContext?: AVCodecContext
+} | {
+    formatContext?: AVFormatContext,
+    streamIndex?: number,
+} | {
+    bsf: AVBitstreamFilter,
+};
+
 export interface AVFormatContext extends AsyncDisposable {
     readonly metadata: any;
     readonly streams: AVStream[];
+    /**
+     * The scheduling class of readFrame and receiveFrame. Defaults to live. See setSchedulerLimits.
+     * readFrame and receiveFrame calls run one at a time in the order they were called.
+     */
+    priority: AVPriority;
 
     // dispose is async here because the format context may be using a network input
     // like RTSP which may require issuing and waiting for a TEARDOWN
     [Symbol.asyncDispose](): Promise<void>;
-    open(input: string, options?: Record<string, string>): Promise<void>;
-    createDecoder(streamIndex: number, hardwareDevice?: string, decoder?: string, deviceName?: string): AVCodecContext;
-    readFrame(): Promise<AVPacket>;
+    /**
+     * Open an input for demuxing.
+     * @param options Demuxer and protocol options.
+     * @param ioOptions Options handled by the addon:
+     * mmap serves a local file from a memory mapping rather than the file protocol,
+     * which avoids read syscalls when opening and seeking many short recordings.
+     * timeout is the milliseconds the open may block before failing with ETIMEDOUT.
+     * readTimeout is the default for readFrame and receiveFrame.
+     * readahead reads packets on a dedicated thread into a queue that the pipeline consumes, so the network
+     * keeps being read while decoding. The queue is bounded by maxPackets (default 512), maxBytes (default 16MB)
+     * and maxDuration, in seconds of timestamps (default unbounded).
+     * The readahead thread owns the demuxer, which may add streams as it reads, ie mpegts. Use streams,
+     * createDecoder and addStream with this input only for the streams found by open.
+     */
+    open(input: string, options?: Record<string, string>, ioOptions?: {
+        mmap?: boolean,
+        timeout?: number,
+        readTimeout?: number,
+        readahead?: boolean | {
+            maxPackets?: number,
+            maxBytes?: number,
+            maxDuration?: number,
+        },
+    }): Promise<void>;
+    /**
+     * Open a demuxer that reads from buffers provided by push() rather than a url.
+     * The returned promise resolves once enough data has been pushed to read the stream header.
+     * @param format The input format, ie 'h264' or 'mpegts'. An empty string probes the pushed data.
+     */
+    openStream(format: string, options?: Record<string, string>): Promise<void>;
+    /**
+     * Queue a buffer for a context opened with openStream. The buffer is referenced, not copied,
+     * and must not be modified until it has been read.
+     * Throws once end(), abort() or close() was called.
+     * @returns false if the queue is full and the buffer was not queued. Retry once the demuxer has read some.
+     */
+    push(buffer: Buffer): boolean;
+    /**
+     * Signal the end of the pushed stream.
+     */
+    end(): void;
+    createDecoder(streamIndex: number, hardwareDevice?: string, decoder?: string, deviceName?: string, options?: AVDecoderOptions): AVCodecContext;
+    createDecoder(streamIndex: number, options: AVDecoderOptions): AVCodecContext;
+    /**
+     * @param options.timeout Milliseconds the read may block before failing with ETIMEDOUT.
+     */
+    readFrame(options?: { timeout?: number }): Promise<AVPacket>;
     receiveFrame(pipelines: {
         streamIndex: number;
         decoder?: AVCodecContext;
         filter?: AVFilter;
         encoder?: AVCodecContext;
         writeFormatContext?: AVFormatContext;
-    }[]): Promise<(AVFrame & { streamIndex: number; type: 'frame'; }) | (AVPacket & { type: 'packet'; inputStreamIndex?: number; }) | null | undefined>;
-    create(format: string, callback: (buffer: Buffer) => void): void;
-    newStream(options: {
-        codecContext?: AVCodecContext
-    } | {
-        formatContext?: AVFormatContext,
-        streamIndex?: number,
-    } | {
-        bsf: AVBitstreamFilter,
-    }): number;
+        /**
+         * Fan out the encoder output, or the demuxed packets without a decoder, to the broadcaster's subscribers.
+         */
+        broadcaster?: AVBroadcaster;
+        /**
+         * Publish the filter output, or the decoder output if there is no filter, to the frame bus's subscribers.
+         * Frames are still returned or encoded as usual.
+         */
+        frameBus?: AVFrameBus;
+        /**
+         * Run the decoder, filter and encoder of this stream on its own thread, fed by a bounded packet queue,
+         * so streams decode and encode in parallel and a slow encode doesn't delay the other streams.
+         * Requires a decoder. The stream's results are returned as they become available, interleaved with
+         * the other streams' rather than in demux order. The thread stops when the context is closed.
+         */
+        thread?: boolean;
+        /**
+         * The stream in writeFormatContext or broadcaster, defaults to 0.
+         */
+        writeStreamIndex?: number;
+    }[], options?: {
+        /**
+         * Milliseconds a read may block before failing with ETIMEDOUT.
+         */
+        timeout?: number,
+    }): Promise<(AVFrame & { streamIndex: number; type: 'frame'; }) | (AVPacket & { type: 'packet'; inputStreamIndex?: number; }) | null | undefined>;
+    /**
+     * Create an output context that delivers muxed data to the callback.
+     * @param options.fragmented Deliver output in self contained fragments rather than as written.
+     * The header (the fMP4 init segment) is delivered once, followed by one buffer per fragment (moof+mdat).
+     * mp4 and mov outputs are configured for fragmented mp4 automatically.
+     * @param options.fragmentDuration Fragment duration in seconds. Defaults to 0, a fragment per keyframe.
+     * This is the minimum for keyframe aligned fragments and the maximum otherwise.
+     * @param options.keyframeAligned Only start fragments at keyframes. Defaults to true.
+     * @param options.srtp Protect rtp output with SRTP/SRTCP before it is delivered to the callback.
+     * @param options.udp Send each write as a datagram from the muxing thread rather than calling the callback,
+     * which may then be undefined. Either a numeric address and port, or the fd of a socket with an
+     * optional address and port. Datagrams are dropped when the socket buffer is full, see getUDPStats.
+     * @param options.pacing Spread each frame's rtp packets over a fraction of the frame interval rather
+     * than sending them in a burst.
+     */
+    create(format: string, callback: ((buffer: Buffer, fragment?: AVOutputFragment) => void) | undefined, options?: {
+        fragmented?: boolean,
+        fragmentDuration?: number,
+        keyframeAligned?: boolean,
+        srtp?: AVSRTPOptions,
+        udp?: {
+            address?: string,
+            port?: number,
+            fd?: number,
+        },
+        pacing?: AVPacingOptions,
+    }): void;
+    /**
+     * Add a stream and write the header, for single stream outputs like rtp.
+     * Packets are written in the time base of their source.
+     */
+    newStream(options: AVStreamSource): number;
+    /**
+     * Add a stream without writing the header. Call writeHeader once every stream has been added.
+     * Packets are written in the time base of their source and rescaled to the muxer's.
+     */
+    addStream(options: AVStreamSource): number;
+    /**
+     * @param options Muxer options. max_interleave_delta defaults to 1 second (in microseconds).
+     */
+    writeHeader(options?: Record<string, string>): void;
+    /**
+     * Flush any interleaved packets and write the trailer.
+     * The output is finished after it, later writeFrame, addStream and writeHeader calls throw.
+     */
+    writeTrailer(): void;
+    /**
+     * Outputs with more than one stream interleave packets by timestamp, buffering at most max_interleave_delta.
+     */
     writeFrame(streamIndex: number, packet: AVPacket): void;
     createSDP(): string;
+    /**
+     * Replace the SRTP master key of an output created with the srtp option.
+     */
+    setSRTP(options: AVSRTPOptions): void;
+    /**
+     * @returns undefined if the output was not created with the pacing option.
+     */
+    getPacerStats(): {
+        /**
+         * Datagrams waiting to be sent.
+         */
+        queueDepth: number,
+        queuedBytes: number,
+        maxQueueDepth: number,
+        sent: number,
+        /**
+         * Milliseconds between a frame being muxed and its datagrams being sent.
+         */
+        averageDelay: number,
+        maxDelay: number,
+    } | undefined;
+    /**
+     * Advance a manual pacing clock and send the datagrams that have become due.
+     */
+    advancePacerClock(milliseconds: number): void;
+    /**
+     * @returns undefined if the output was not created with the udp option.
+     */
+    getUDPStats(): {
+        packets: number,
+        bytes: number,
+        /**
+         * Datagrams dropped because the socket buffer was full.
+         */
+        drops: number,
+        errors: number,
+    } | undefined;
+    /**
+     * Keep a live input near real time when reading falls behind, ie a stalled decoder or event loop.
+     * Lag is measured from the keyframe stream's timestamps against the wallclock, relative to the
+     * fastest delivery seen. While behind, all packets are dropped up to a keyframe back at the live edge.
+     * Pass undefined to disable.
+     * @param options.maxLag Seconds of lag before catching up. Defaults to 1, 0 disables lag detection.
+     * @param options.maxQueuedBytes Also catch up when more than this is queued by push.
+     * @param options.keyframeStreamIndex Defaults to the best video stream.
+     */
+    setLiveEdge(options?: {
+        maxLag?: number,
+        maxQueuedBytes?: number,
+        keyframeStreamIndex?: number,
+    }): void;
+    /**
+     * Lag values are in seconds.
+     * @returns undefined if setLiveEdge was not called.
+     */
+    getLiveEdgeStats(): {
+        lag: number,
+        peakLag: number,
+        droppedPackets: number,
+        catchUps: number,
+        catchingUp: boolean,
+    } | undefined;
+    /**
+     * Overflows count the times the reader waited on a full queue, ie decoding is behind (cpu bound),
+     * and underruns the times the pipeline found the queue empty, ie the input is behind (network bound).
+     * duration is the timestamp span of the queue in seconds.
+     * @returns undefined if the input was not opened with readahead.
+     */
+    getReadaheadStats(): {
+        packets: number,
+        bytes: number,
+        duration: number,
+        overflows: number,
+        underruns: number,
+    } | undefined;
+    /**
+     * Create an output context that keeps a sliding window of HLS segments in memory,
+     * to be served with getPlaylist, getSegment and getInit.
+     * Segments start at keyframes once segmentDuration has elapsed.
+     * @param options.format mpegts (default) or mp4 for fragmented mp4 segments.
+     * @param options.segmentDuration Target segment duration in seconds. Defaults to 2.
+     * @param options.partDuration LL-HLS part duration in seconds. Defaults to 0, no parts.
+     * @param options.windowSize Number of segments in the playlist. Defaults to 6.
+     * @param options.prefix Prefix of segment URIs in the playlist, ie 'segment' for segment12.ts and segment12.3.ts.
+     * @param options.canBlockReload Advertise blocking playlist reload. The server must implement _HLS_msn and _HLS_part.
+     */
+    createHLS(options?: {
+        format?: 'mpegts' | 'mp4',
+        segmentDuration?: number,
+        partDuration?: number,
+        windowSize?: number,
+        prefix?: string,
+        canBlockReload?: boolean,
+    }): void;
+    getPlaylist(): string;
+    /**
+     * @param part The part index within the segment. Omit for the complete segment.
+     * @returns undefined if the segment or part is not, or is no longer, available.
+     */
+    getSegment(sequence: number, part?: number): Buffer | undefined;
+    getInit(): Buffer | undefined;
+    /**
+     * Interrupt a pending open or read of the input, and fail any later ones.
+     * close() also aborts, then waits for the pending call to return before freeing the context.
+     */
+    abort(): void;
     close(): Promise<void>;
 }
 
+export interface AVBroadcasterStats {
+    /**
+     * Packets since the last keyframe, sent to new subscribers.
+     */
+    cachedPackets: number;
+    subscribers: {
+        id: number;
+        queued: number;
+        sent: number;
+        dropped: number;
+        errors: number;
+        waitingForKeyframe: boolean;
+        lastError?: string;
+    }[];
+}
+
+/**
+ * Shares one encoder or demuxer with any number of muxers or callbacks, ie one per viewer.
+ * Subscribers join at the most recent keyframe and are delivered to from their own
+ * native thread and bounded queue, so a slow subscriber only drops its own packets.
+ */
+export interface AVBroadcaster extends Disposable {
+    /**
+     * The packet is referenced, not copied, and may be destroyed after writing.
+     */
+    write(packet: AVPacket): void;
+    /**
+     * @param options.formatContext An output context with its streams and header already written.
+     * Packets are written with writeFrame semantics from a native thread. If it is closed while subscribed,
+     * later packets count as errors until the subscriber is unsubscribed.
+     * @param options.callback Called with each packet, one at a time.
+     * @param options.streamMap Broadcast stream index to output stream index. Defaults to all streams, unmapped.
+     * @param options.queueSize Packets queued before dropping. Defaults to 256.
+     * @param options.dropPolicy What to drop when the queue is full.
+     * keyframe (default) discards the queue and resumes at the next keyframe, oldest and newest drop a single packet.
+     * @returns The subscriber id.
+     */
+    subscribe(options: {
+        formatContext?: AVFormatContext,
+        callback?: (packet: AVPacket) => void,
+        streamMap?: Record<number, number>,
+        queueSize?: number,
+        dropPolicy?: 'keyframe' | 'oldest' | 'newest',
+    }): number;
+    /**
+     * Waits for a write in progress to the subscriber's format context.
+     * @returns false if the subscriber was not found.
+     */
+    unsubscribe(id: number): boolean;
+    getStats(): AVBroadcasterStats;
+    /**
+     * Decode the cached packets of the keyframe stream, from the last keyframe, and return the newest frame.
+     * This allows a stream to serve snapshots, ie with toJpeg, without decoding continuously:
+     * feed the broadcaster from receiveFrame without a decoder, and keep an idle decoder for snapshots.
+     * The decoder is flushed before and after use, and must not be used elsewhere at the same time.
+     * @returns undefined before the first keyframe.
+     */
+    snapshot(decoder: AVCodecContext): Promise<AVFrame | undefined>;
+    close(): void;
+}
+
+export interface AVFrameBusStats {
+    published: number;
+    subscribers: {
+        id: number;
+        queued: number;
+        delivered: number;
+        /**
+         * Frames replaced in, or evicted from, the mailbox before delivery.
+         */
+        dropped: number;
+        /**
+         * Frames not accepted because of maxFps.
+         */
+        skipped: number;
+    }[];
+}
+
+/**
+ * Shares the decoded frames of one pipeline with any number of consumers, ie motion detection,
+ * object detection and thumbnails. Subscribers receive references to the frames, not copies,
+ * and publishing never waits on a subscriber.
+ */
+export interface AVFrameBus extends Disposable {
+    /**
+     * The frame is referenced, not copied, and may be destroyed after publishing.
+     */
+    publish(frame: AVFrame): void;
+    /**
+     * @param options.callback Called with each frame, which the callback must destroy.
+     * If a promise is returned, the next frame is not delivered until it settles.
+     * @param options.mode latest (default) keeps only the newest undelivered frame,
+     * every queues frames up to queueSize and drops the oldest.
+     * @param options.queueSize Mailbox size in every mode. Defaults to 4. Hardware frames hold decoder surfaces while queued.
+     * @param options.maxFps Accept at most this many frames per second, by frame timestamp when available.
+     * @returns The subscriber id.
+     */
+    subscribe(options: {
+        callback: (frame: AVFrame) => void | Promise<void>,
+        mode?: 'latest' | 'every',
+        queueSize?: number,
+        maxFps?: number,
+    }): number;
+    /**
+     * @returns false if the subscriber was not found.
+     */
+    unsubscribe(id: number): boolean;
+    getStats(): AVFrameBusStats;
+    close(): void;
+}
+
+export type AVInputSchedulerEvent = { input: number, tag: string } & (
+    (AVFrame & { streamIndex: number; type: 'frame'; })
+    | (AVPacket & { type: 'packet'; inputStreamIndex?: number; })
+    | { type: 'end' }
+    | { type: 'error', error: Error });
+
+export interface AVInputSchedulerStats {
+    threads: number;
+    /**
+     * Inputs waiting for a thread.
+     */
+    ready: number;
+    /**
+     * Inputs that had nothing to read, waiting to be polled again.
+     */
+    waiting: number;
+    inputs: {
+        input: number;
+        tag: string;
+        steps: number;
+        results: number;
+        /**
+         * Steps that found nothing to read.
+         */
+        idle: number;
+        /**
+         * Results queued to the callback.
+         */
+        pending: number;
+        paused: boolean;
+    }[];
+}
+
+/**
+ * Runs the receiveFrame pipelines of many inputs on a small native thread pool rather than
+ * a pending receiveFrame per input, and delivers the results of all of them to one callback.
+ * Inputs are switched to non blocking reads: an input with nothing to read is polled again
+ * later instead of holding a thread. Demuxers without non blocking support still hold a thread
+ * while they wait for data. Push inputs are only read once data has been pushed.
+ */
+export interface AVInputScheduler extends Disposable {
+    /**
+     * The format context and the pipeline objects must not be used elsewhere until the input is removed.
+     * The context is read non blocking while it is scheduled, and gets its original read mode back once
+     * the input is detached: right away if it is idle, otherwise when its read in progress returns.
+     * The input is removed after its end or error event.
+     * @param tag Included in the input's events.
+     * @returns The input id.
+     */
+    add(formatContext: AVFormatContext, pipelines: Parameters<AVFormatContext['receiveFrame']>[0], tag?: string): number;
+    /**
+     * A read in progress finishes first and its result is still delivered.
+     * @returns false if the input was not found.
+     */
+    remove(id: number): boolean;
+    getStats(): AVInputSchedulerStats;
+    /**
+     * Returns without waiting for reads in progress. Their threads exit once the reads return,
+     * and their inputs are detached then. Abort blocking inputs for a prompt shutdown.
+     */
+    close(): void;
+}
+
+export type AVPriority = 'live' | 'background';
+
+export interface AVSchedulerClassStats {
+    limit: number;
+    running: number;
+    waiting: number;
+    completed: number;
+    /**
+     * Milliseconds calls waited to be admitted to the thread pool.
+     */
+    averageWait: number;
+    maxWait: number;
+}
+
+/**
+ * Calls of live and background objects share the libuv thread pool. Live calls are admitted up to
+ * the live limit, which defaults to the pool size. Background calls are admitted only while no live
+ * call is waiting, up to the background limit (default 1), and never take the last pool thread not
+ * running live work. Each pipeline call handles about a frame, so background work yields between frames.
+ * @param limits.poolSize The libuv pool size, if UV_THREADPOOL_SIZE was changed from within the process.
+ */
+export function setSchedulerLimits(limits: { live?: number, background?: number, poolSize?: number }) {
+    loadAddon().setSchedulerLimits(limits);
+}
+
+export function getSchedulerStats(): { poolSize: number, live: AVSchedulerClassStats, background: AVSchedulerClassStats } {
+    return loadAddon().getSchedulerStats();
+}
+
+/**
+ * Destroyed decoders and encoders are kept open, flushed, and handed out again by createDecoder and
+ * createEncoder for the same configuration: codec, hardware device, stream parameters or size,
+ * pixel format, rate control and encoder options. This skips the open and device setup for repeat
+ * viewers. Encoders that buffer frames are only pooled if they can be flushed, and a reconfigured
+ * encoder is not pooled.
+ * @param limits.capacity The most idle codecs kept, least recently destroyed are freed first. Defaults to 0, disabled.
+ * @param limits.idleTimeout Seconds an idle codec is kept. Defaults to 60.
+ */
+export function setCodecPoolLimits(limits: { capacity?: number, idleTimeout?: number }) {
+    loadAddon().setCodecPoolLimits(limits);
+}
+
+export function getCodecPoolStats(): { capacity: number, idleTimeout: number, idle: number, hits: number, misses: number, evictions: number } {
+    return loadAddon().getCodecPoolStats();
+}
+
 export function setAVLogLevel(level: 'quiet' | 'panic' | 'fatal' | 'error' | 'warning' | 'info' | 'verbose' | 'debug' | 'trace') {
     loadAddon().setLogLevel(level);
 }
@@ -266,10 +895,62 @@ export function createAVFrame(
     return new (loadAddon().AVFrame)(width, height, pixelFormat, fillBlack);
 }
 
+/**
+ * Create a packet from data received outside of FFmpeg, ie a custom transport,
+ * for use with sendPacket, bitstream filters, or writeFrame.
+ * The buffer is wrapped without copying and must not be modified while the packet is alive.
+ * Decoders may read past the end of the data, so the buffer is copied into a pooled padded buffer
+ * unless its backing store has AV_INPUT_BUFFER_PADDING_SIZE (64) zeroed bytes past the view that no other
+ * Buffer uses, ie Buffer.alloc(size + 64).subarray(0, size). Small Buffers from Node's shared pool are copied.
+ * The padding must stay zeroed while the packet is alive. Set padding to false to always wrap.
+ * @param options.copy Always copy into a pooled buffer, for short lived or reused buffers.
+ * @param options.padding Set to false when the packet will not be sent to a decoder.
+ */
+export function createAVPacket(buffer: Buffer, options?: {
+    pts?: number,
+    dts?: number,
+    duration?: number,
+    flags?: number,
+    streamIndex?: number,
+    copy?: boolean,
+    padding?: boolean,
+}): AVPacket {
+    return new (loadAddon().AVPacket)(buffer, options);
+}
+
 export function createAVBitstreamFilter(filter: string): AVBitstreamFilter {
     return new (loadAddon().AVBitstreamFilter)(filter);
 }
 
+/**
+ * @param options.keyframeStreamIndex The stream whose keyframes subscribers join and resume at, ie the video stream. Defaults to 0.
+ * @param options.maxCachedPackets Bound on the packets cached since the last keyframe. Defaults to 2048.
+ */
+export function createAVBroadcaster(options?: {
+    keyframeStreamIndex?: number,
+    maxCachedPackets?: number,
+}): AVBroadcaster {
+    return new (loadAddon().AVBroadcaster)(options);
+}
+
+export function createAVFrameBus(): AVFrameBus {
+    return new (loadAddon().AVFrameBus)();
+}
+
+/**
+ * @param options.callback Called with the packets and frames of every input, and once with an end or error event per input.
+ * Packets and frames must be destroyed by the callback.
+ * @param options.threads Defaults to the number of cores.
+ * @param options.maxPending Results queued to the callback per input before that input is paused. Defaults to 4.
+ */
+export function createAVInputScheduler(options: {
+    callback: (event: AVInputSchedulerEvent) => void,
+    threads?: number,
+    maxPending?: number,
+}): AVInputScheduler {
+    return new (loadAddon().AVInputScheduler)(options);
+}
+
 export function getBinaryUrl() {
     const libc = process.env.LIBC || process.env.npm_config_libc ||
         (detectLibc.isNonGlibcLinuxSync() && detectLibc.familySync()) || ''
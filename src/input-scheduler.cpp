@@ -0,0 +1,434 @@
+#include "input-scheduler.h"
+#include "formatcontext.h"
+#include "push-input.h"
+#include "error.h"
+
+extern "C"
+{
+#include <libavutil/time.h>
+}
+
+#include <algorithm>
+#include <chrono>
+
+Napi::FunctionReference AVInputSchedulerObject::constructor;
+
+static const int DEFAULT_MAX_PENDING = 4;
+// polling backoff of inputs with nothing to read, in microseconds.
+static const int64_t MIN_BACKOFF = 1000;
+static const int64_t MAX_BACKOFF = 20000;
+
+Napi::Object AVInputSchedulerObject::Init(Napi::Env env, Napi::Object exports)
+{
+    Napi::HandleScope scope(env);
+
+    Napi::Function func = DefineClass(env, "AVInputScheduler", {
+                                                                   InstanceMethod(Napi::Symbol::WellKnown(env, "dispose"), &AVInputSchedulerObject::Close),
+                                                                   InstanceMethod("add", &AVInputSchedulerObject::Add),
+                                                                   InstanceMethod("remove", &AVInputSchedulerObject::Remove),
+                                                                   InstanceMethod("getStats", &AVInputSchedulerObject::GetStats),
+                                                                   InstanceMethod("close", &AVInputSchedulerObject::Close),
+                                                               });
+
+    constructor = Napi::Persistent(func);
+    constructor.SuppressDestruct();
+
+    exports.Set("AVInputScheduler", func);
+    return exports;
+}
+
+AVInputSchedulerObject::AVInputSchedulerObject(const Napi::CallbackInfo &info)
+    : Napi::ObjectWrap<AVInputSchedulerObject>(info), maxPending(DEFAULT_MAX_PENDING), nextId(0), stopping(false), closed(true)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Object expected for argument 0: options").ThrowAsJavaScriptException();
+        return;
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+    Napi::Value callback = options.Get("callback");
+    if (!callback.IsFunction())
+    {
+        Napi::TypeError::New(env, "callback expected").ThrowAsJavaScriptException();
+        return;
+    }
+
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    if (options.Get("threads").IsNumber())
+    {
+        threadCount = std::max(1u, options.Get("threads").As<Napi::Number>().Uint32Value());
+    }
+    if (options.Get("maxPending").IsNumber())
+    {
+        maxPending = std::max(1, options.Get("maxPending").As<Napi::Number>().Int32Value());
+    }
+
+    // results are queued to js from the pool, the scheduler stays alive until the last one is delivered.
+    Ref();
+    callbackRef = Napi::ThreadSafeFunction::New(
+        env,
+        callback.As<Napi::Function>(),
+        "napi_input_scheduler",
+        0,
+        1,
+        [this](Napi::Env)
+        { Unref(); });
+
+    closed = false;
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        threads.emplace_back(&AVInputSchedulerObject::Run, this);
+    }
+}
+
+AVInputSchedulerObject::~AVInputSchedulerObject()
+{
+    if (closer.joinable())
+    {
+        closer.join();
+    }
+    StopThreads();
+}
+
+void AVInputSchedulerObject::StopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    // a thread in a blocking read finishes it first.
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+}
+
+void AVInputSchedulerObject::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        int64_t now = av_gettime_relative();
+        while (!waiting.empty() && waiting.begin()->first <= now)
+        {
+            ready.push_back(waiting.begin()->second);
+            waiting.erase(waiting.begin());
+        }
+
+        if (ready.empty())
+        {
+            if (waiting.empty())
+            {
+                condition.wait(lock);
+            }
+            else
+            {
+                condition.wait_for(lock, std::chrono::microseconds(waiting.begin()->first - now));
+            }
+            continue;
+        }
+
+        std::shared_ptr<Input> input = ready.front();
+        ready.pop_front();
+        // removed while queued, its references are already gone.
+        if (input->removed)
+        {
+            continue;
+        }
+
+        input->running = true;
+        lock.unlock();
+        PipelineResult result;
+        int ret = Step(input.get(), &result);
+        lock.lock();
+        input->running = false;
+        Reschedule(input, ret, &result);
+    }
+}
+
+int AVInputSchedulerObject::Step(Input *input, PipelineResult *result)
+{
+    AVFormatContextObject *formatContext = input->formatContext;
+    std::lock_guard<std::mutex> lock(formatContext->ioMutex);
+    result->packet = nullptr;
+    result->frame = nullptr;
+    if (!formatContext->fmt_ctx_ || formatContext->aborted)
+    {
+        return AVERROR_EXIT;
+    }
+
+    // a push input would block the thread until js pushes more data.
+    if (formatContext->pushInput && !formatContext->pushInput->Readable())
+    {
+        return AVERROR(EAGAIN);
+    }
+
+    int64_t deadline = formatContext->readTimeout ? av_gettime_relative() + formatContext->readTimeout : 0;
+    return input->pipeline.Step(formatContext, deadline, result);
+}
+
+// called with the scheduler lock held.
+void AVInputSchedulerObject::Reschedule(std::shared_ptr<Input> input, int ret, PipelineResult *result)
+{
+    if (input->removed)
+    {
+        av_packet_free(&result->packet);
+        av_frame_free(&result->frame);
+        // the references can only be released on the js thread.
+        callbackRef.NonBlockingCall([input](Napi::Env env, Napi::Function callback)
+                                    { Detach(input); });
+        return;
+    }
+
+    input->steps++;
+    if (ret == AVERROR(EAGAIN))
+    {
+        input->idle++;
+        input->backoff = std::min(std::max(input->backoff * 2, MIN_BACKOFF), MAX_BACKOFF);
+        waiting.emplace(av_gettime_relative() + input->backoff, input);
+        return;
+    }
+    input->backoff = 0;
+
+    if (ret < 0)
+    {
+        input->removed = true;
+        inputs.erase(input->id);
+        callbackRef.NonBlockingCall([this, input, ret](Napi::Env env, Napi::Function callback)
+                                    { Finish(env, callback, input, ret); });
+        return;
+    }
+
+    if (result->packet || result->frame)
+    {
+        PipelineResult *delivered = new PipelineResult(*result);
+        napi_status status = callbackRef.NonBlockingCall([this, input, delivered](Napi::Env env, Napi::Function callback)
+                                                         { Deliver(env, callback, input, delivered); });
+        if (status != napi_ok)
+        {
+            av_packet_free(&delivered->packet);
+            av_frame_free(&delivered->frame);
+            delete delivered;
+        }
+        else
+        {
+            input->results++;
+            input->pending++;
+        }
+    }
+
+    if (input->pending >= maxPending)
+    {
+        input->paused = true;
+        return;
+    }
+
+    // to the back, so a busy input doesn't starve the others.
+    ready.push_back(input);
+    condition.notify_one();
+}
+
+void AVInputSchedulerObject::Deliver(Napi::Env env, Napi::Function callback, std::shared_ptr<Input> input, PipelineResult *result)
+{
+    Napi::Value value = Pipeline::ToValue(env, result);
+    delete result;
+    if (value.IsObject())
+    {
+        Napi::Object event = value.As<Napi::Object>();
+        event.Set("input", Napi::Number::New(env, input->id));
+        event.Set("tag", Napi::String::New(env, input->tag));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        input->pending--;
+        if (input->paused && !input->removed)
+        {
+            input->paused = false;
+            ready.push_back(input);
+            condition.notify_one();
+        }
+    }
+
+    // results of a removed input are still handed over, the packet or frame belongs to js now.
+    callback.Call({value});
+}
+
+void AVInputSchedulerObject::Finish(Napi::Env env, Napi::Function callback, std::shared_ptr<Input> input, int ret)
+{
+    Detach(input);
+
+    Napi::Object event = Napi::Object::New(env);
+    event.Set("input", Napi::Number::New(env, input->id));
+    event.Set("tag", Napi::String::New(env, input->tag));
+    if (ret == AVERROR_EOF)
+    {
+        event.Set("type", "end");
+    }
+    else
+    {
+        event.Set("type", "error");
+        event.Set("error", Napi::Error::New(env, AVErrorString(ret)).Value());
+    }
+    callback.Call({event});
+}
+
+void AVInputSchedulerObject::Detach(std::shared_ptr<Input> input)
+{
+    // no thread steps the input anymore, hand the context back in its original read mode.
+    AVFormatContext *fmt_ctx = input->formatContext->fmt_ctx_;
+    if (fmt_ctx && !input->nonblock)
+    {
+        fmt_ctx->flags &= ~AVFMT_FLAG_NONBLOCK;
+    }
+    input->formatContextRef.Reset();
+    input->pipelinesRef.Reset();
+}
+
+Napi::Value AVInputSchedulerObject::Add(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsArray())
+    {
+        Napi::TypeError::New(env, "Format context and pipelines array expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    AVFormatContextObject *formatContext = Napi::ObjectWrap<AVFormatContextObject>::Unwrap(info[0].As<Napi::Object>());
+    if (!formatContext->fmt_ctx_ || !formatContext->is_input)
+    {
+        Napi::Error::New(env, "Open input format context expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::shared_ptr<Input> input = std::make_shared<Input>();
+    if (!input->pipeline.Parse(env, info[1].As<Napi::Array>()))
+    {
+        return env.Undefined();
+    }
+    input->formatContext = formatContext;
+    input->running = false;
+    input->pending = 0;
+    input->paused = false;
+    input->removed = false;
+    input->backoff = 0;
+    input->steps = 0;
+    input->results = 0;
+    input->idle = 0;
+    if (info.Length() > 2 && info[2].IsString())
+    {
+        input->tag = info[2].As<Napi::String>().Utf8Value();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closed)
+    {
+        Napi::Error::New(env, "Input scheduler is closed").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // demuxers that support it return EAGAIN rather than waiting for the network.
+    input->nonblock = formatContext->fmt_ctx_->flags & AVFMT_FLAG_NONBLOCK;
+    formatContext->fmt_ctx_->flags |= AVFMT_FLAG_NONBLOCK;
+    input->formatContextRef = Napi::Persistent(info[0].As<Napi::Object>());
+    input->pipelinesRef = Napi::Persistent(info[1].As<Napi::Object>());
+    input->id = nextId++;
+    inputs[input->id] = input;
+    ready.push_back(input);
+    condition.notify_one();
+    return Napi::Number::New(env, input->id);
+}
+
+Napi::Value AVInputSchedulerObject::Remove(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Number expected for argument 0: input id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int id = info[0].As<Napi::Number>().Int32Value();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = inputs.find(id);
+    if (it == inputs.end())
+    {
+        return Napi::Boolean::New(env, false);
+    }
+
+    std::shared_ptr<Input> input = it->second;
+    inputs.erase(it);
+    input->removed = true;
+    // otherwise the thread stepping it detaches it once the step returns.
+    if (!input->running)
+    {
+        Detach(input);
+    }
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value AVInputSchedulerObject::GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    Napi::Object stats = Napi::Object::New(env);
+    Napi::Array inputStats = Napi::Array::New(env);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.Set("threads", Napi::Number::New(env, threads.size()));
+    stats.Set("ready", Napi::Number::New(env, ready.size()));
+    stats.Set("waiting", Napi::Number::New(env, waiting.size()));
+    uint32_t i = 0;
+    for (auto &pair : inputs)
+    {
+        Input *input = pair.second.get();
+        Napi::Object s = Napi::Object::New(env);
+        s.Set("input", Napi::Number::New(env, input->id));
+        s.Set("tag", Napi::String::New(env, input->tag));
+        s.Set("steps", Napi::Number::New(env, input->steps));
+        s.Set("results", Napi::Number::New(env, input->results));
+        s.Set("idle", Napi::Number::New(env, input->idle));
+        s.Set("pending", Napi::Number::New(env, input->pending));
+        s.Set("paused", Napi::Boolean::New(env, input->paused));
+        inputStats.Set(i++, s);
+    }
+    stats.Set("inputs", inputStats);
+    return stats;
+}
+
+Napi::Value AVInputSchedulerObject::Close(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed)
+        {
+            return env.Undefined();
+        }
+        closed = true;
+        for (auto &pair : inputs)
+        {
+            pair.second->removed = true;
+            // otherwise the thread stepping it detaches it once the step returns.
+            if (!pair.second->running)
+            {
+                Detach(pair.second);
+            }
+        }
+        inputs.clear();
+        ready.clear();
+        waiting.clear();
+    }
+
+    // a thread may be stuck in a demuxer that ignores AVFMT_FLAG_NONBLOCK, so the pool is
+    // joined off the js thread. results already queued are still delivered, and the finalizer
+    // releases the scheduler once the last thread is gone.
+    closer = std::thread([this]()
+                         {
+        StopThreads();
+        callbackRef.Release(); });
+    return env.Undefined();
+}
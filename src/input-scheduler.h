@@ -0,0 +1,89 @@
+#pragma once
+
+#include <napi.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline.h"
+
+class AVFormatContextObject;
+
+// Drives the receiveFrame pipelines of many inputs on a small pool of threads,
+// rather than a blocked worker per input. Inputs are read non blocking: an
+// input with nothing to read is parked and polled with a backoff, and any
+// thread picks up the next ready input, so a few threads serve many streams.
+// Results of all inputs are delivered to a single js callback, tagged with
+// the input they came from.
+class AVInputSchedulerObject : public Napi::ObjectWrap<AVInputSchedulerObject>
+{
+public:
+    struct Input
+    {
+        int id;
+        std::string tag;
+        AVFormatContextObject *formatContext;
+        // the context was non blocking before it was added, detaching leaves it that way.
+        bool nonblock;
+        Pipeline pipeline;
+        // js thread only, keep the context and the pipeline objects alive while scheduled.
+        Napi::ObjectReference formatContextRef;
+        Napi::ObjectReference pipelinesRef;
+
+        // a thread is stepping the input, only that thread may touch its pipeline.
+        bool running;
+        // results queued to js, the input is paused at maxPending until js catches up.
+        int pending;
+        bool paused;
+        bool removed;
+        // microseconds until an idle input is polled again.
+        int64_t backoff;
+
+        uint64_t steps;
+        uint64_t results;
+        uint64_t idle;
+    };
+
+    static Napi::FunctionReference constructor;
+    static Napi::Object Init(Napi::Env env, Napi::Object exports);
+
+    AVInputSchedulerObject(const Napi::CallbackInfo &info);
+    ~AVInputSchedulerObject();
+
+private:
+    Napi::Value Add(const Napi::CallbackInfo &info);
+    Napi::Value Remove(const Napi::CallbackInfo &info);
+    Napi::Value GetStats(const Napi::CallbackInfo &info);
+    Napi::Value Close(const Napi::CallbackInfo &info);
+
+    void Run();
+    int Step(Input *input, PipelineResult *result);
+    void Reschedule(std::shared_ptr<Input> input, int ret, PipelineResult *result);
+    void Deliver(Napi::Env env, Napi::Function callback, std::shared_ptr<Input> input, PipelineResult *result);
+    void Finish(Napi::Env env, Napi::Function callback, std::shared_ptr<Input> input, int ret);
+    static void Detach(std::shared_ptr<Input> input);
+    void StopThreads();
+
+    Napi::ThreadSafeFunction callbackRef;
+    int maxPending;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    int nextId;
+    std::map<int, std::shared_ptr<Input>> inputs;
+    std::deque<std::shared_ptr<Input>> ready;
+    // idle inputs by the av_gettime_relative time they are polled again.
+    std::multimap<int64_t, std::shared_ptr<Input>> waiting;
+    std::vector<std::thread> threads;
+    // joins the pool after close, off the js thread.
+    std::thread closer;
+    bool stopping;
+    bool closed;
+};
@@ -0,0 +1,119 @@
+#include "live-edge.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/mathematics.h>
+}
+
+#include <algorithm>
+#include <chrono>
+
+// a timestamp going back further than this is a discontinuity, ie a camera restart or a loop.
+static const int64_t DISCONTINUITY = 1000000;
+
+LiveEdge::LiveEdge()
+    : policy({0, 0, 0}), anchorTime(AV_NOPTS_VALUE), anchorWall(0), lastTime(AV_NOPTS_VALUE), lag(0),
+      lastKeyframeLag(AV_NOPTS_VALUE), catchingUp(false), peakLag(0), droppedPackets(0), catchUps(0)
+{
+}
+
+void LiveEdge::Configure(const Policy &policy)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->policy = policy;
+    anchorTime = AV_NOPTS_VALUE;
+    lastTime = AV_NOPTS_VALUE;
+    lag = 0;
+    catchingUp = false;
+}
+
+void LiveEdge::Anchor(int64_t time, int64_t now)
+{
+    anchorTime = time;
+    anchorWall = now;
+    lag = 0;
+}
+
+bool LiveEdge::Drop(AVPacket *packet, AVRational timeBase, size_t queuedBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!policy.maxLag && !policy.maxQueuedBytes)
+    {
+        return false;
+    }
+
+    bool keyStream = packet->stream_index == policy.keyframeStreamIndex;
+    int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    // dts increases in delivery order, pts goes backwards at every B-frame.
+    int64_t ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    int64_t time = AV_NOPTS_VALUE;
+    if (policy.maxLag && keyStream && ts != AV_NOPTS_VALUE)
+    {
+        time = av_rescale_q(ts, timeBase, AV_TIME_BASE_Q);
+        // a large jump back is a discontinuity, not a catch up.
+        if (anchorTime == AV_NOPTS_VALUE || time < lastTime - DISCONTINUITY)
+        {
+            Anchor(time, now);
+        }
+        lastTime = time;
+
+        lag = (now - anchorWall) - (time - anchorTime);
+        // arriving sooner than ever before moves the baseline.
+        if (lag < 0)
+        {
+            Anchor(time, now);
+        }
+        peakLag = std::max(peakLag, lag);
+    }
+
+    bool behind = (policy.maxLag && lag > policy.maxLag) || (policy.maxQueuedBytes && queuedBytes > policy.maxQueuedBytes);
+    bool keyframe = keyStream && (packet->flags & AV_PKT_FLAG_KEY);
+
+    if (!catchingUp)
+    {
+        if (!behind)
+        {
+            return false;
+        }
+        catchingUp = true;
+        lastKeyframeLag = AV_NOPTS_VALUE;
+        catchUps++;
+    }
+
+    if (keyframe)
+    {
+        if (!behind)
+        {
+            catchingUp = false;
+            return false;
+        }
+
+        // dropping reads through buffered data faster than real time, so lag should fall
+        // between keyframes. if it doesn't, the source clock drifts rather than the
+        // reader being behind, so accept the lag as the new baseline.
+        if (lastKeyframeLag != AV_NOPTS_VALUE && time != AV_NOPTS_VALUE && lag > lastKeyframeLag - policy.maxLag / 4 &&
+            !(policy.maxQueuedBytes && queuedBytes > policy.maxQueuedBytes))
+        {
+            Anchor(time, now);
+            catchingUp = false;
+            return false;
+        }
+        lastKeyframeLag = lag;
+    }
+
+    droppedPackets++;
+    return true;
+}
+
+LiveEdge::Stats LiveEdge::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.lag = lag;
+    stats.peakLag = peakLag;
+    stats.droppedPackets = droppedPackets;
+    stats.catchUps = catchUps;
+    stats.catchingUp = catchingUp;
+    return stats;
+}
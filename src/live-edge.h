@@ -0,0 +1,63 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/packet.h>
+#include <libavutil/rational.h>
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Keeps a live input near real time when reading falls behind, ie the decoder or
+// js stalled while the network kept buffering. Lag is the delivery delay of the
+// keyframe stream relative to the best seen so far, from dts against the wallclock,
+// and optionally the bytes queued by a push input. While lagging, packets are
+// dropped up to a keyframe that is back at the live edge.
+// Times are in microseconds.
+class LiveEdge
+{
+public:
+    struct Policy
+    {
+        // 0 disables lag detection.
+        int64_t maxLag;
+        // 0 disables backlog detection.
+        size_t maxQueuedBytes;
+        int keyframeStreamIndex;
+    };
+
+    struct Stats
+    {
+        int64_t lag;
+        int64_t peakLag;
+        uint64_t droppedPackets;
+        uint64_t catchUps;
+        bool catchingUp;
+    };
+
+    LiveEdge();
+
+    void Configure(const Policy &policy);
+    // true if the packet should be dropped.
+    bool Drop(AVPacket *packet, AVRational timeBase, size_t queuedBytes);
+    Stats GetStats();
+
+private:
+    void Anchor(int64_t time, int64_t now);
+
+    std::mutex mutex;
+    Policy policy;
+    int64_t anchorTime;
+    int64_t anchorWall;
+    int64_t lastTime;
+    int64_t lag;
+    // lag at the previous keyframe passed while catching up.
+    int64_t lastKeyframeLag;
+    bool catchingUp;
+
+    int64_t peakLag;
+    uint64_t droppedPackets;
+    uint64_t catchUps;
+};
@@ -0,0 +1,184 @@
+#include "mmap-input.h"
+
+extern "C"
+{
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// buffer used by avio for small reads (avio_r8, probing, etc).
+static const int AVIO_BUFFER_SIZE = 64 * 1024;
+// how much of the file to prefetch after opening or seeking.
+static const size_t WILLNEED_WINDOW = 4 * 1024 * 1024;
+
+MmapInput::MmapInput()
+    : avio_ctx(nullptr), data(nullptr), size(0), position(0)
+{
+}
+
+MmapInput::~MmapInput()
+{
+    if (avio_ctx)
+    {
+        av_freep(&avio_ctx->buffer);
+        avio_context_free(&avio_ctx);
+    }
+#ifndef _WIN32
+    if (data)
+    {
+        munmap(data, size);
+    }
+#endif
+}
+
+MmapInput *MmapInput::Open(const std::string &filename, int *error)
+{
+#ifdef _WIN32
+    *error = AVERROR(ENOSYS);
+    return nullptr;
+#else
+    std::string path = filename;
+    if (path.rfind("file:", 0) == 0)
+    {
+        path = path.substr(5);
+    }
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        *error = AVERROR(errno);
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        *error = AVERROR(errno);
+        close(fd);
+        return nullptr;
+    }
+
+    if (!S_ISREG(st.st_mode) || st.st_size <= 0)
+    {
+        close(fd);
+        *error = AVERROR(EINVAL);
+        return nullptr;
+    }
+
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping holds its own reference to the file.
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        *error = AVERROR(errno);
+        return nullptr;
+    }
+
+    MmapInput *input = new MmapInput();
+    input->data = (uint8_t *)mapping;
+    input->size = st.st_size;
+
+    madvise(input->data, input->size, MADV_SEQUENTIAL);
+    input->WillNeed(0);
+
+    uint8_t *buffer = (uint8_t *)av_malloc(AVIO_BUFFER_SIZE);
+    if (!buffer)
+    {
+        delete input;
+        *error = AVERROR(ENOMEM);
+        return nullptr;
+    }
+
+    input->avio_ctx = avio_alloc_context(buffer, AVIO_BUFFER_SIZE, 0, input, ReadPacket, NULL, Seek);
+    if (!input->avio_ctx)
+    {
+        av_free(buffer);
+        delete input;
+        *error = AVERROR(ENOMEM);
+        return nullptr;
+    }
+
+    // large reads bypass the avio buffer and copy directly out of the mapping.
+    input->avio_ctx->direct = 1;
+    input->avio_ctx->seekable = AVIO_SEEKABLE_NORMAL;
+
+    return input;
+#endif
+}
+
+void MmapInput::WillNeed(size_t offset)
+{
+#ifndef _WIN32
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t start = offset - (offset % pageSize);
+    if (start >= size)
+    {
+        return;
+    }
+    size_t length = std::min(WILLNEED_WINDOW, size - start);
+    madvise(data + start, length, MADV_WILLNEED);
+#endif
+}
+
+int MmapInput::ReadPacket(void *opaque, uint8_t *buf, int buf_size)
+{
+    MmapInput *input = (MmapInput *)opaque;
+    if (input->position >= input->size)
+    {
+        return AVERROR_EOF;
+    }
+
+    size_t available = input->size - input->position;
+    size_t length = std::min((size_t)buf_size, available);
+    memcpy(buf, input->data + input->position, length);
+    input->position += length;
+    return (int)length;
+}
+
+int64_t MmapInput::Seek(void *opaque, int64_t offset, int whence)
+{
+    MmapInput *input = (MmapInput *)opaque;
+
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE)
+    {
+    case AVSEEK_SIZE:
+        return input->size;
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = input->position + offset;
+        break;
+    case SEEK_END:
+        target = input->size + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+
+    if (target < 0 || target > (int64_t)input->size)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    // a seek is a jump out of the sequential read pattern, so prefetch
+    // the region the demuxer is about to read.
+    if ((size_t)target != input->position)
+    {
+        input->WillNeed(target);
+    }
+    input->position = target;
+    return target;
+}
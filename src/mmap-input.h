@@ -0,0 +1,31 @@
+#pragma once
+
+extern "C"
+{
+#include <libavformat/avio.h>
+}
+
+#include <string>
+
+// Serves a local file to the demuxer from a read only memory mapping.
+// The AVIOContext runs in direct mode, so avio_read copies straight from
+// the mapping into the caller's buffer without read() syscalls or an
+// intermediate AVIO buffer copy, and seeks are pointer arithmetic.
+class MmapInput
+{
+public:
+    static MmapInput *Open(const std::string &filename, int *error);
+    ~MmapInput();
+
+    AVIOContext *avio_ctx;
+
+private:
+    MmapInput();
+    static int ReadPacket(void *opaque, uint8_t *buf, int buf_size);
+    static int64_t Seek(void *opaque, int64_t offset, int whence);
+    void WillNeed(size_t offset);
+
+    uint8_t *data;
+    size_t size;
+    size_t position;
+};
@@ -0,0 +1,86 @@
+#include "output-rate.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/mathematics.h>
+}
+
+#include <algorithm>
+#include <chrono>
+
+OutputRate::OutputRate(const Policy &policy)
+    : policy(policy), interval(0), nextAt(AV_NOPTS_VALUE), lastTime(AV_NOPTS_VALUE), candidates(0), accepted(0), dropped(0)
+{
+    double seconds = policy.minPtsInterval;
+    if (policy.maxFps > 0)
+    {
+        seconds = std::max(seconds, 1 / policy.maxFps);
+    }
+    interval = (int64_t)(seconds * 1000000);
+}
+
+bool OutputRate::Accept(AVFrame *frame, AVRational timeBase)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (policy.keyframesOnly && !(frame->flags & AV_FRAME_FLAG_KEY))
+    {
+        dropped++;
+        return false;
+    }
+
+    if (policy.everyNth > 1 && candidates++ % policy.everyNth)
+    {
+        dropped++;
+        return false;
+    }
+
+    if (interval)
+    {
+        int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+        int64_t time;
+        if (pts != AV_NOPTS_VALUE && timeBase.num > 0 && timeBase.den > 0)
+        {
+            time = av_rescale_q(pts, timeBase, AV_TIME_BASE_Q);
+        }
+        else
+        {
+            time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // a timestamp going backwards, ie a seek or discontinuity, restarts the schedule.
+        if (lastTime != AV_NOPTS_VALUE && time < lastTime)
+        {
+            nextAt = AV_NOPTS_VALUE;
+        }
+        lastTime = time;
+
+        if (nextAt != AV_NOPTS_VALUE && time < nextAt)
+        {
+            dropped++;
+            return false;
+        }
+
+        // advance on a fixed schedule so frame jitter doesn't lower the rate,
+        // unless a gap has put the schedule behind.
+        if (nextAt == AV_NOPTS_VALUE || time - nextAt >= interval)
+        {
+            nextAt = time + interval;
+        }
+        else
+        {
+            nextAt += interval;
+        }
+    }
+
+    accepted++;
+    return true;
+}
+
+void OutputRate::GetStats(uint64_t *accepted, uint64_t *dropped)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    *accepted = this->accepted;
+    *dropped = this->dropped;
+}
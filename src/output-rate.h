@@ -0,0 +1,45 @@
+#pragma once
+
+extern "C"
+{
+#include <libavutil/frame.h>
+#include <libavutil/rational.h>
+}
+
+#include <cstdint>
+#include <mutex>
+
+// Drops decoded frames a consumer doesn't want, ie detection that only needs
+// a few frames per second, before they reach a filter or js.
+// All configured limits must pass for a frame to be accepted.
+class OutputRate
+{
+public:
+    struct Policy
+    {
+        // 0 for no limit.
+        double maxFps;
+        // 0 or 1 for every frame.
+        int everyNth;
+        // seconds, 0 for no limit.
+        double minPtsInterval;
+        bool keyframesOnly;
+    };
+
+    OutputRate(const Policy &policy);
+
+    // frame times come from the pts in the time base, or the wallclock without one.
+    bool Accept(AVFrame *frame, AVRational timeBase);
+    void GetStats(uint64_t *accepted, uint64_t *dropped);
+    Policy policy;
+
+private:
+    std::mutex mutex;
+    // microseconds.
+    int64_t interval;
+    int64_t nextAt;
+    int64_t lastTime;
+    uint64_t candidates;
+    uint64_t accepted;
+    uint64_t dropped;
+};
@@ -12,12 +12,62 @@ extern "C"
 }
 
 #include <thread>
+#include <map>
 
 
 #include "packet.h"
+#include "error.h"
 
 Napi::FunctionReference AVPacketObject::constructor;
 
+// js buffers wrapped by packets may be released by a decoder or muxer thread,
+// but references can only be deleted on the js thread.
+static Napi::ThreadSafeFunction releaseBufferRef;
+static std::thread::id mainThreadId;
+static napi_env mainEnv;
+
+// pools for packets copied from js, bucketed by power of two size.
+static std::map<size_t, AVBufferPool *> copyPools;
+static const size_t MAX_POOLED_SIZE = 8 * 1024 * 1024;
+
+static void releaseWrappedBuffer(void *opaque, uint8_t *data)
+{
+    napi_ref ref = (napi_ref)opaque;
+    if (std::this_thread::get_id() == mainThreadId)
+    {
+        napi_delete_reference(mainEnv, ref);
+        return;
+    }
+
+    releaseBufferRef.NonBlockingCall([ref](Napi::Env env, Napi::Function jsCallback)
+                                     { napi_delete_reference(env, ref); });
+}
+
+// Buffers smaller than half of Buffer.poolSize are slices of a shared pool,
+// so the bytes past the view belong to other Buffers and may change.
+static bool isPooledBuffer(Napi::Env env, Napi::Buffer<uint8_t> buffer)
+{
+    Napi::Value poolSizeValue = env.Global().Get("Buffer").As<Napi::Object>().Get("poolSize");
+    if (!poolSizeValue.IsNumber())
+    {
+        return true;
+    }
+    size_t poolSize = poolSizeValue.As<Napi::Number>().Int64Value();
+    return buffer.ArrayBuffer().ByteLength() == poolSize && buffer.Length() < poolSize / 2;
+}
+
+static bool isZero(const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        if (data[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 Napi::Object AVPacketObject::Init(Napi::Env env, Napi::Object exports)
 {
     Napi::HandleScope scope(env);
@@ -37,9 +87,73 @@ Napi::Object AVPacketObject::Init(Napi::Env env, Napi::Object exports)
 
     constructor = Napi::Persistent(func);
     constructor.SuppressDestruct();
+
+    mainThreadId = std::this_thread::get_id();
+    mainEnv = env;
+    releaseBufferRef = Napi::ThreadSafeFunction::New(env, Napi::Function(), "napi_release_buffer", 0, 1);
+    // pending releases should not keep the process alive.
+    releaseBufferRef.Unref(env);
+
+    exports.Set("AVPacket", func);
     return exports;
 }
 
+AVBufferRef *AVPacketObject::WrapBuffer(Napi::Env env, Napi::Buffer<uint8_t> buffer)
+{
+    napi_ref ref;
+    if (napi_create_reference(env, buffer, 1, &ref) != napi_ok)
+    {
+        return nullptr;
+    }
+
+    AVBufferRef *buf = av_buffer_create(buffer.Data(), buffer.Length(), releaseWrappedBuffer, ref, AV_BUFFER_FLAG_READONLY);
+    if (!buf)
+    {
+        napi_delete_reference(env, ref);
+        return nullptr;
+    }
+    return buf;
+}
+
+AVBufferRef *AVPacketObject::CopyBuffer(const uint8_t *data, size_t size)
+{
+    size_t padded = size + AV_INPUT_BUFFER_PADDING_SIZE;
+    AVBufferRef *buf;
+    if (padded > MAX_POOLED_SIZE)
+    {
+        buf = av_buffer_alloc(padded);
+    }
+    else
+    {
+        size_t bucket = 1024;
+        while (bucket < padded)
+        {
+            bucket <<= 1;
+        }
+
+        // only called on the js thread, the pools themselves are thread safe.
+        AVBufferPool *&pool = copyPools[bucket];
+        if (!pool)
+        {
+            pool = av_buffer_pool_init(bucket, NULL);
+            if (!pool)
+            {
+                return nullptr;
+            }
+        }
+        buf = av_buffer_pool_get(pool);
+    }
+
+    if (!buf)
+    {
+        return nullptr;
+    }
+
+    memcpy(buf->data, data, size);
+    memset(buf->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    return buf;
+}
+
 Napi::Object AVPacketObject::NewInstance(Napi::Env env, AVPacket *packet)
 {
     Napi::Object obj = constructor.New({});
@@ -52,6 +166,97 @@ AVPacketObject::AVPacketObject(const Napi::CallbackInfo &info)
     : Napi::ObjectWrap<AVPacketObject>(info)
 {
     packet = nullptr;
+
+    if (!info.Length())
+    {
+        return;
+    }
+
+    Napi::Env env = info.Env();
+    if (!info[0].IsBuffer())
+    {
+        Napi::TypeError::New(env, "Buffer expected for argument 0: data").ThrowAsJavaScriptException();
+        return;
+    }
+
+    Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
+    Napi::Object options = info.Length() > 1 && info[1].IsObject() ? info[1].As<Napi::Object>() : Napi::Object::New(env);
+
+    bool copy = false;
+    Napi::Value copyValue = options.Get("copy");
+    if (copyValue.IsBoolean())
+    {
+        copy = copyValue.As<Napi::Boolean>().Value();
+    }
+
+    // decoders may read up to AV_INPUT_BUFFER_PADDING_SIZE bytes past the end of the data.
+    // muxers and bitstream filters do not, so padding can be disabled for those.
+    bool padding = true;
+    Napi::Value paddingValue = options.Get("padding");
+    if (paddingValue.IsBoolean())
+    {
+        padding = paddingValue.As<Napi::Boolean>().Value();
+    }
+
+    if (!copy && padding)
+    {
+        // the buffer can still be wrapped if its backing store has room past the view,
+        // that room is not shared with other Buffers, and it is zeroed like FFmpeg's own padding.
+        size_t end = buffer.ByteOffset() + buffer.Length();
+        size_t slack = buffer.ArrayBuffer().ByteLength() - end;
+        copy = slack < AV_INPUT_BUFFER_PADDING_SIZE
+            || isPooledBuffer(env, buffer)
+            || !isZero(buffer.Data() + buffer.Length(), AV_INPUT_BUFFER_PADDING_SIZE);
+    }
+
+    AVBufferRef *buf = copy ? CopyBuffer(buffer.Data(), buffer.Length()) : WrapBuffer(env, buffer);
+    if (!buf)
+    {
+        Napi::Error::New(env, "Failed to allocate packet buffer").ThrowAsJavaScriptException();
+        return;
+    }
+
+    packet = av_packet_alloc();
+    if (!packet)
+    {
+        av_buffer_unref(&buf);
+        Napi::Error::New(env, "Failed to allocate new AVPacket").ThrowAsJavaScriptException();
+        return;
+    }
+
+    packet->buf = buf;
+    packet->data = buf->data;
+    packet->size = buffer.Length();
+
+    Napi::Value ptsValue = options.Get("pts");
+    if (ptsValue.IsNumber())
+    {
+        packet->pts = ptsValue.As<Napi::Number>().Int64Value();
+    }
+
+    Napi::Value dtsValue = options.Get("dts");
+    if (dtsValue.IsNumber())
+    {
+        packet->dts = dtsValue.As<Napi::Number>().Int64Value();
+    }
+
+    Napi::Value durationValue = options.Get("duration");
+    if (durationValue.IsNumber())
+    {
+        packet->duration = durationValue.As<Napi::Number>().Int64Value();
+    }
+
+    Napi::Value flagsValue = options.Get("flags");
+    if (flagsValue.IsNumber())
+    {
+        packet->flags = flagsValue.As<Napi::Number>().Int32Value();
+    }
+
+    Napi::Value streamIndexValue = options.Get("streamIndex");
+    if (streamIndexValue.IsNumber())
+    {
+        packet->stream_index = streamIndexValue.As<Napi::Number>().Int32Value();
+    }
 }
 
 AVPacketObject::~AVPacketObject()
@@ -22,6 +22,8 @@ public:
     static Napi::FunctionReference constructor;
     static Napi::Object Init(Napi::Env env, Napi::Object exports);
     static Napi::Object NewInstance(Napi::Env env, AVPacket *packet);
+    static AVBufferRef *WrapBuffer(Napi::Env env, Napi::Buffer<uint8_t> buffer);
+    static AVBufferRef *CopyBuffer(const uint8_t *data, size_t size);
 
     AVPacketObject(const Napi::CallbackInfo &info);
     ~AVPacketObject();
@@ -0,0 +1,546 @@
+#include "pipeline.h"
+#include "formatcontext.h"
+#include "codeccontext.h"
+#include "filter.h"
+#include "broadcaster.h"
+#include "frame-bus.h"
+#include "packet.h"
+#include "frame.h"
+#include "av-pointer.h"
+#include "live-edge.h"
+#include "push-input.h"
+#include "stream-worker.h"
+#include "readahead.h"
+
+Pipeline::Pipeline()
+    : counted(false)
+{
+}
+
+Pipeline::Pipeline(const Pipeline &other)
+    : decoders(other.decoders), filters(other.filters), encoders(other.encoders), writeFormatContexts(other.writeFormatContexts),
+      writeStreamIndexes(other.writeStreamIndexes), broadcasters(other.broadcasters), frameBuses(other.frameBuses),
+      threaded(other.threaded), counted(other.counted)
+{
+    if (counted)
+    {
+        UseCodecs(1);
+    }
+}
+
+Pipeline::~Pipeline()
+{
+    if (counted)
+    {
+        UseCodecs(-1);
+    }
+}
+
+void Pipeline::UseCodecs(int delta)
+{
+    for (auto &pair : decoders)
+    {
+        pair.second->pipelineUses += delta;
+    }
+    for (auto &pair : encoders)
+    {
+        pair.second->pipelineUses += delta;
+    }
+    for (auto &pair : threaded)
+    {
+        UseCodecs(pair.second, delta);
+    }
+}
+
+void Pipeline::UseCodecs(const StreamChain &chain, int delta)
+{
+    if (chain.decoder)
+    {
+        chain.decoder->pipelineUses += delta;
+    }
+    if (chain.encoder)
+    {
+        chain.encoder->pipelineUses += delta;
+    }
+}
+
+bool Pipeline::Parse(Napi::Env env, Napi::Array pipelinesArray)
+{
+    for (uint32_t i = 0; i < pipelinesArray.Length(); i++)
+    {
+        Napi::Value item = pipelinesArray[i];
+        if (!item.IsObject())
+        {
+            Napi::TypeError::New(env, "Each decoder must be an object").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        Napi::Object pipeline = item.As<Napi::Object>();
+        if (!pipeline.Has("streamIndex"))
+        {
+            Napi::TypeError::New(env, "Pipeline objects must have streamIndex").ThrowAsJavaScriptException();
+            return false;
+        }
+
+        int streamIndex = pipeline.Get("streamIndex").As<Napi::Number>().Int32Value();
+
+        if (pipeline.Has("decoder"))
+        {
+            AVCodecContextObject *codecContextObject = Napi::ObjectWrap<AVCodecContextObject>::Unwrap(
+                pipeline.Get("decoder").As<Napi::Object>());
+
+            decoders[streamIndex] = codecContextObject;
+        }
+
+        if (pipeline.Has("filter"))
+        {
+            auto filter = pipeline.Get("filter");
+            if (filter.IsObject())
+            {
+                AVFilterGraphObject *filterObject = Napi::ObjectWrap<AVFilterGraphObject>::Unwrap(
+                    pipeline.Get("filter").As<Napi::Object>());
+                filters[streamIndex] = filterObject;
+            }
+        }
+
+        if (pipeline.Has("encoder"))
+        {
+            auto encoder = pipeline.Get("encoder");
+            if (encoder.IsObject())
+            {
+                AVCodecContextObject *encoderObject = Napi::ObjectWrap<AVCodecContextObject>::Unwrap(
+                    encoder.As<Napi::Object>());
+                encoders[streamIndex] = encoderObject;
+            }
+        }
+
+        if (pipeline.Has("writeFormatContext"))
+        {
+            auto writeContext = pipeline.Get("writeFormatContext");
+            if (writeContext.IsObject())
+            {
+                AVFormatContextObject *writeContextObject = Napi::ObjectWrap<AVFormatContextObject>::Unwrap(
+                    writeContext.As<Napi::Object>());
+                writeFormatContexts[streamIndex] = writeContextObject;
+            }
+        }
+
+        if (pipeline.Has("writeStreamIndex"))
+        {
+            auto writeStreamIndex = pipeline.Get("writeStreamIndex");
+            if (writeStreamIndex.IsNumber())
+            {
+                writeStreamIndexes[streamIndex] = writeStreamIndex.As<Napi::Number>().Int32Value();
+            }
+        }
+
+        if (pipeline.Has("broadcaster"))
+        {
+            auto broadcaster = pipeline.Get("broadcaster");
+            if (broadcaster.IsObject())
+            {
+                broadcasters[streamIndex] = Napi::ObjectWrap<AVBroadcasterObject>::Unwrap(broadcaster.As<Napi::Object>());
+            }
+        }
+
+        if (pipeline.Has("frameBus"))
+        {
+            auto frameBus = pipeline.Get("frameBus");
+            if (frameBus.IsObject())
+            {
+                frameBuses[streamIndex] = Napi::ObjectWrap<AVFrameBusObject>::Unwrap(frameBus.As<Napi::Object>());
+            }
+        }
+
+        // a chain needs a decoder to run on its own thread.
+        if (pipeline.Get("thread").ToBoolean() && decoders.count(streamIndex))
+        {
+            threaded[streamIndex] = Chain(streamIndex);
+            decoders.erase(streamIndex);
+            filters.erase(streamIndex);
+            encoders.erase(streamIndex);
+            writeFormatContexts.erase(streamIndex);
+            writeStreamIndexes.erase(streamIndex);
+            broadcasters.erase(streamIndex);
+            frameBuses.erase(streamIndex);
+        }
+    }
+    counted = true;
+    UseCodecs(1);
+    return true;
+}
+
+template <typename T>
+static T find(const std::map<int, T> &map, int streamIndex)
+{
+    auto it = map.find(streamIndex);
+    return it != map.end() ? it->second : T();
+}
+
+StreamChain Pipeline::Chain(int streamIndex) const
+{
+    StreamChain chain;
+    chain.streamIndex = streamIndex;
+    chain.decoder = find(decoders, streamIndex);
+    chain.filter = find(filters, streamIndex);
+    chain.encoder = find(encoders, streamIndex);
+    chain.writeFormatContext = find(writeFormatContexts, streamIndex);
+    chain.writeStreamIndex = find(writeStreamIndexes, streamIndex);
+    chain.broadcaster = find(broadcasters, streamIndex);
+    chain.frameBus = find(frameBuses, streamIndex);
+    return chain;
+}
+
+int Pipeline::WriteOutputs(const StreamChain &chain, AVPacket *packet, bool *written)
+{
+    *written = chain.writeFormatContext || chain.broadcaster;
+    if (!*written)
+    {
+        return 0;
+    }
+
+    packet->stream_index = chain.writeStreamIndex;
+    if (chain.broadcaster)
+    {
+        int ret = chain.broadcaster->Write(packet);
+        if (ret < 0)
+        {
+            return ret;
+        }
+    }
+    if (chain.writeFormatContext)
+    {
+        return chain.writeFormatContext->WritePacket(packet);
+    }
+    return 0;
+}
+
+void Pipeline::PublishFrame(const StreamChain &chain, AVFrame *frame)
+{
+    if (!chain.frameBus)
+    {
+        return;
+    }
+
+    // decoders and filters leave the time base unset, the bus throttles by timestamp.
+    if (!frame->time_base.num)
+    {
+        if (chain.filter)
+        {
+            frame->time_base = av_buffersink_get_time_base(chain.filter->buffersink_ctxs[0]);
+        }
+        else if (chain.decoder)
+        {
+            frame->time_base = chain.decoder->codecContext->pkt_timebase;
+        }
+    }
+    chain.frameBus->Publish(frame);
+}
+
+int Pipeline::ReceiveThreaded(AVFormatContextObject *input, PipelineResult *result, bool drain)
+{
+    while (true)
+    {
+        StreamWorker *waitFor = nullptr;
+        for (auto &pair : input->streamWorkers)
+        {
+            StreamWorker *worker = pair.second;
+            int ret = worker->TakeError();
+            if (ret < 0)
+            {
+                return ret;
+            }
+            if (worker->Receive(result))
+            {
+                return 1;
+            }
+            if (!worker->Flush() || (drain && worker->Busy()))
+            {
+                waitFor = worker;
+            }
+        }
+        if (!waitFor)
+        {
+            return 0;
+        }
+        waitFor->Wait();
+    }
+}
+
+int Pipeline::Step(AVFormatContextObject *input, int64_t deadline, PipelineResult *result)
+{
+    result->packet = nullptr;
+    result->packetInputStreamIndex = -1;
+    result->frame = nullptr;
+    result->frameStreamIndex = -1;
+
+    AVFormatContext *fmt_ctx_ = input->fmt_ctx_;
+    FreePointer<AVFrame, av_frame_free> frame(av_frame_alloc());
+    FreePointer<AVPacket, av_packet_free> packet(av_packet_alloc());
+    if (!packet.get() || !frame.get())
+    {
+        return AVERROR(ENOMEM);
+    }
+
+    int ret;
+    while (true)
+    {
+        // results of streams running on their own threads
+        ret = ReceiveThreaded(input, result, false);
+        if (ret)
+        {
+            return ret < 0 ? ret : 0;
+        }
+
+        // Try to receive encoded packets first
+        for (const auto &pair : encoders)
+        {
+            AVCodecContext *encoderContext = pair.second->codecContext;
+            if (!encoderContext)
+                continue;
+
+            ret = avcodec_receive_packet(encoderContext, packet.get());
+            if (!ret)
+            {
+                // Got an encoded packet
+                bool written;
+                ret = WriteOutputs(Chain(pair.first), packet.get(), &written);
+                if (ret < 0)
+                {
+                    return ret;
+                }
+                if (written)
+                {
+                    // writing a muxer doesn't have a result so keep
+                    // going until something is available or demuxer needs
+                    // more data.
+                    // nevermind, its possible to loop infinitely.
+                    return 0;
+                }
+
+                result->packet = packet.release();
+                result->packetInputStreamIndex = pair.first;
+                return 0;
+            }
+            else if (ret != AVERROR(EAGAIN))
+            {
+                return ret;
+            }
+        }
+
+        // Try to receive filtered frames and feed to encoders
+        for (const auto &pair : filters)
+        {
+            auto filter = pair.second;
+            auto buffersink_ctx = filter->buffersink_ctxs[0];
+
+            FreePointer<AVFrame, av_frame_free> filtered_frame(av_frame_alloc());
+            ret = av_buffersink_get_frame(buffersink_ctx, filtered_frame.get());
+
+            if (!ret)
+            {
+                PublishFrame(Chain(pair.first), filtered_frame.get());
+
+                // Check for encoder
+                auto encoderIt = encoders.find(pair.first);
+                if (encoderIt == encoders.end())
+                {
+                    // No encoder, use filtered frame directly
+                    result->frame = filtered_frame.release();
+                    result->frameStreamIndex = pair.first;
+                    return 0;
+                }
+
+                // Send filtered frame to encoder
+                ret = encoderIt->second->EncodeFrame(filtered_frame.get());
+                if (ret < 0)
+                {
+                    return ret;
+                }
+                continue;
+            }
+            else if (ret != AVERROR(EAGAIN))
+            {
+                return ret;
+            }
+        }
+
+        // Try to receive frames from each decoder context
+        for (const auto &pair : decoders)
+        {
+            auto codecContext = pair.second->codecContext;
+            if (!codecContext)
+                continue;
+
+            ret = avcodec_receive_frame(codecContext, frame.get());
+            if (!ret)
+            {
+                // dropped before the filter or a js object is involved.
+                if (!pair.second->AcceptFrame(frame.get()))
+                {
+                    av_frame_unref(frame.get());
+                    continue;
+                }
+
+                // Check if there's a filter for this stream
+                auto filterIt = filters.find(pair.first);
+                if (filterIt != filters.end())
+                {
+                    // Feed frame to filter and continue - filter output will be handled in filter loop
+                    AVFilterContext *buffersrc_ctx = filterIt->second->buffersrc_ctxs[0];
+                    ret = av_buffersrc_add_frame_flags(buffersrc_ctx, frame.get(), AV_BUFFERSRC_FLAG_KEEP_REF);
+                    if (ret < 0)
+                    {
+                        return ret;
+                    }
+                    continue;
+                }
+
+                PublishFrame(Chain(pair.first), frame.get());
+
+                // No filter, check for encoder
+                auto encoderIt = encoders.find(pair.first);
+                if (encoderIt == encoders.end())
+                {
+                    // No encoder, use decoded frame directly
+                    result->frame = frame.release();
+                    result->frameStreamIndex = pair.first;
+                    return 0;
+                }
+
+                // Send frame to encoder
+                ret = encoderIt->second->EncodeFrame(frame.get());
+                if (ret < 0)
+                {
+                    return ret;
+                }
+                continue;
+            }
+            else if (ret != AVERROR(EAGAIN))
+            {
+                return ret;
+            }
+        }
+
+        // Need more data, try to read a packet
+        if (input->readahead)
+        {
+            ret = input->readahead->Read(packet.get(), deadline, input->aborted, fmt_ctx_->flags & AVFMT_FLAG_NONBLOCK);
+        }
+        else
+        {
+            input->ioDeadline = deadline;
+            ret = av_read_frame(fmt_ctx_, packet.get());
+            input->ioDeadline = 0;
+        }
+        if (ret == AVERROR_EXIT)
+        {
+            ret = input->InterruptedError();
+        }
+        if (ret && ret != AVERROR(EAGAIN))
+        {
+            // hand back what the stream threads still have before the end of the input.
+            int drained = ReceiveThreaded(input, result, true);
+            if (drained)
+            {
+                return drained < 0 ? drained : 0;
+            }
+        }
+        if (ret)
+        {
+            // EAGAIN, try reading again later
+            return ret;
+        }
+
+        LiveEdge *liveEdge = input->liveEdge;
+        if (liveEdge)
+        {
+            size_t queuedBytes = input->pushInput ? input->pushInput->QueuedBytes() : 0;
+            if (input->readahead)
+            {
+                queuedBytes += input->readahead->QueuedBytes();
+            }
+            // the readahead thread may be adding streams, so it hands over the time base with the packet.
+            AVRational timeBase = input->readahead ? packet.get()->time_base : fmt_ctx_->streams[packet.get()->stream_index]->time_base;
+            if (liveEdge->Drop(packet.get(), timeBase, queuedBytes))
+            {
+                av_packet_unref(packet.get());
+                continue;
+            }
+        }
+
+        auto threadedIt = threaded.find(packet.get()->stream_index);
+        if (threadedIt != threaded.end())
+        {
+            StreamWorker *&worker = input->streamWorkers[threadedIt->first];
+            if (!worker)
+            {
+                worker = new StreamWorker();
+            }
+            AVPacket *handover = av_packet_alloc();
+            if (!handover)
+            {
+                return AVERROR(ENOMEM);
+            }
+            av_packet_move_ref(handover, packet.get());
+            // a full queue is waited on when looking for results.
+            worker->Send(handover, threadedIt->second);
+            continue;
+        }
+
+        // Check if we have a decoder for this stream
+        auto it = decoders.find(packet.get()->stream_index);
+        if (it == decoders.end())
+        {
+            int inputStreamIndex = packet.get()->stream_index;
+            bool written;
+            ret = WriteOutputs(Chain(inputStreamIndex), packet.get(), &written);
+            if (ret < 0)
+            {
+                return ret;
+            }
+            if (written)
+            {
+                result->packetInputStreamIndex = inputStreamIndex;
+            }
+
+            // No decoder for this stream, return the packet as-is
+            result->packet = packet.release();
+            return 0;
+        }
+
+        // Send packet to appropriate decoder
+        ret = it->second->DecodePacket(packet.get());
+        av_packet_unref(packet.get());
+
+        if (ret)
+        {
+            // On decoder feed error, try again with next packet
+            return 0;
+        }
+
+        // Packet sent successfully, loop to try receiving frames
+    }
+}
+
+Napi::Value Pipeline::ToValue(Napi::Env env, PipelineResult *result)
+{
+    if (result->packet)
+    {
+        Napi::Object value = AVPacketObject::NewInstance(env, result->packet);
+        result->packet = nullptr;
+        value.Set("type", "packet");
+        if (result->packetInputStreamIndex >= 0)
+            value.Set("inputStreamIndex", Napi::Number::New(env, result->packetInputStreamIndex));
+        return value;
+    }
+    if (result->frame)
+    {
+        Napi::Object value = AVFrameObject::NewInstance(env, result->frame);
+        result->frame = nullptr;
+        value.Set("streamIndex", result->frameStreamIndex);
+        value.Set("type", "frame");
+        return value;
+    }
+    return env.Undefined();
+}
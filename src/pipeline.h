@@ -0,0 +1,94 @@
+#pragma once
+
+#include <napi.h>
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include <map>
+
+class AVFormatContextObject;
+class AVCodecContextObject;
+class AVFilterGraphObject;
+class AVBroadcasterObject;
+class AVFrameBusObject;
+
+struct PipelineResult
+{
+    AVPacket *packet;
+    // set when the packet was also written to a muxer or broadcaster, -1 otherwise.
+    int packetInputStreamIndex;
+    AVFrame *frame;
+    int frameStreamIndex;
+};
+
+// the stages of one input stream.
+struct StreamChain
+{
+    int streamIndex;
+    AVCodecContextObject *decoder;
+    AVFilterGraphObject *filter;
+    AVCodecContextObject *encoder;
+    AVFormatContextObject *writeFormatContext;
+    int writeStreamIndex;
+    AVBroadcasterObject *broadcaster;
+    AVFrameBusObject *frameBus;
+};
+
+// The per stream decode, filter, encode and write stages of receiveFrame.
+// A step reads and processes packets of an input until there is a result,
+// shared by the read frame worker and the input scheduler. Steps of the same
+// input must not overlap, the codec and filter contexts are not thread safe.
+class Pipeline
+{
+public:
+    std::map<int, AVCodecContextObject *> decoders;
+    std::map<int, AVFilterGraphObject *> filters;
+    std::map<int, AVCodecContextObject *> encoders;
+    std::map<int, AVFormatContextObject *> writeFormatContexts;
+    // output stream of each input stream in its write context, 0 if unset.
+    std::map<int, int> writeStreamIndexes;
+    std::map<int, AVBroadcasterObject *> broadcasters;
+    // receives the filter output of the stream, or the decoder output if there is no filter.
+    std::map<int, AVFrameBusObject *> frameBuses;
+    // streams whose chain runs on a stream worker thread rather than in the step,
+    // they are not in the maps above.
+    std::map<int, StreamChain> threaded;
+
+    Pipeline();
+    // a copy uses the codecs too, they stay out of the codec pool until every copy is gone.
+    Pipeline(const Pipeline &other);
+    ~Pipeline();
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    // from a receiveFrame pipelines array, throws and returns false if it is malformed.
+    bool Parse(Napi::Env env, Napi::Array pipelines);
+
+    // the input must be open and its io mutex held. deadline is an av_gettime_relative
+    // time the read may block until, 0 for none. returns AVERROR(EAGAIN) if a non
+    // blocking demuxer has nothing to read yet, otherwise 0 with or without a result,
+    // ie a packet that was only written to a muxer.
+    int Step(AVFormatContextObject *input, int64_t deadline, PipelineResult *result);
+
+    // takes the packet or frame of the result, undefined if there is none.
+    static Napi::Value ToValue(Napi::Env env, PipelineResult *result);
+
+    // writes the packet to the muxer and broadcaster of the chain, if any.
+    static int WriteOutputs(const StreamChain &chain, AVPacket *packet, bool *written);
+    static void PublishFrame(const StreamChain &chain, AVFrame *frame);
+    // counts the codecs of the chain in or out of use, ie while a stream worker holds a packet for it.
+    static void UseCodecs(const StreamChain &chain, int delta);
+
+private:
+    void UseCodecs(int delta);
+    // the codecs are counted once parsing succeeded.
+    bool counted;
+
+    StreamChain Chain(int streamIndex) const;
+    // returns a result of the stream workers of the input if there is one,
+    // waiting for one while a handed over packet doesn't fit, or, with drain,
+    // until the workers are idle. 1 for a result, or an error of a chain.
+    int ReceiveThreaded(AVFormatContextObject *input, PipelineResult *result, bool drain);
+};
@@ -0,0 +1,197 @@
+#include "push-input.h"
+
+extern "C"
+{
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const int AVIO_BUFFER_SIZE = 32 * 1024;
+// how often a waiting read checks the interrupt callback, ie for a read deadline.
+static const std::chrono::milliseconds INTERRUPT_POLL(10);
+
+PushInput::PushInput(size_t capacity)
+    : avio_ctx(nullptr), interrupt({nullptr, nullptr}), chunks(capacity), mask(capacity - 1),
+      head(0), tail(0), released(0), offset(0), queuedBytes(0),
+      ended(false), aborted(false)
+{
+}
+
+PushInput::~PushInput()
+{
+    if (avio_ctx)
+    {
+        av_freep(&avio_ctx->buffer);
+        avio_context_free(&avio_ctx);
+    }
+}
+
+PushInput *PushInput::Create(size_t capacity, int *error)
+{
+    // round up to a power of two so indices can be masked.
+    size_t size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    PushInput *input = new PushInput(size);
+
+    uint8_t *buffer = (uint8_t *)av_malloc(AVIO_BUFFER_SIZE);
+    if (!buffer)
+    {
+        delete input;
+        *error = AVERROR(ENOMEM);
+        return nullptr;
+    }
+
+    input->avio_ctx = avio_alloc_context(buffer, AVIO_BUFFER_SIZE, 0, input, ReadPacket, NULL, NULL);
+    if (!input->avio_ctx)
+    {
+        av_free(buffer);
+        delete input;
+        *error = AVERROR(ENOMEM);
+        return nullptr;
+    }
+    input->avio_ctx->seekable = 0;
+
+    return input;
+}
+
+int PushInput::Push(napi_env env, napi_value buffer, const uint8_t *data, size_t length)
+{
+    ReleaseConsumed(env);
+
+    if (aborted)
+    {
+        return AVERROR_EXIT;
+    }
+    if (ended)
+    {
+        return AVERROR_EOF;
+    }
+
+    if (!length)
+    {
+        return 0;
+    }
+
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - released > mask)
+    {
+        return AVERROR(EAGAIN);
+    }
+
+    Chunk &chunk = chunks[h & mask];
+    if (napi_create_reference(env, buffer, 1, &chunk.ref) != napi_ok)
+    {
+        return AVERROR(ENOMEM);
+    }
+    chunk.data = data;
+    chunk.length = length;
+    queuedBytes += length;
+    head.store(h + 1, std::memory_order_release);
+
+    // lock so the wakeup can't slip in between the consumer's empty check and its wait.
+    std::lock_guard<std::mutex> lock(waitMutex);
+    waitCondition.notify_one();
+    return 0;
+}
+
+void PushInput::End()
+{
+    std::lock_guard<std::mutex> lock(waitMutex);
+    ended = true;
+    waitCondition.notify_one();
+}
+
+void PushInput::Abort()
+{
+    std::lock_guard<std::mutex> lock(waitMutex);
+    aborted = true;
+    waitCondition.notify_one();
+}
+
+void PushInput::ReleaseConsumed(napi_env env)
+{
+    size_t t = tail.load(std::memory_order_acquire);
+    while (released != t)
+    {
+        napi_delete_reference(env, chunks[released & mask].ref);
+        released++;
+    }
+}
+
+void PushInput::ReleaseAll(napi_env env)
+{
+    size_t h = head.load(std::memory_order_acquire);
+    while (released != h)
+    {
+        napi_delete_reference(env, chunks[released & mask].ref);
+        released++;
+    }
+    tail.store(h, std::memory_order_release);
+    queuedBytes = 0;
+}
+
+size_t PushInput::QueuedBytes() const
+{
+    return queuedBytes;
+}
+
+bool PushInput::Readable() const
+{
+    return queuedBytes || ended || aborted;
+}
+
+int PushInput::ReadPacket(void *opaque, uint8_t *buf, int buf_size)
+{
+    PushInput *input = (PushInput *)opaque;
+
+    size_t t = input->tail.load(std::memory_order_relaxed);
+    if (t == input->head.load(std::memory_order_acquire))
+    {
+        std::unique_lock<std::mutex> lock(input->waitMutex);
+        while (!input->waitCondition.wait_for(lock, INTERRUPT_POLL, [input, t]()
+                                              { return t != input->head.load(std::memory_order_acquire) || input->ended || input->aborted; }))
+        {
+            if (input->interrupt.callback && input->interrupt.callback(input->interrupt.opaque))
+            {
+                return AVERROR_EXIT;
+            }
+        }
+        if (input->aborted)
+        {
+            return AVERROR_EXIT;
+        }
+        if (t == input->head.load(std::memory_order_acquire))
+        {
+            return AVERROR_EOF;
+        }
+    }
+
+    int total = 0;
+    while (total < buf_size && t != input->head.load(std::memory_order_acquire))
+    {
+        const Chunk &chunk = input->chunks[t & input->mask];
+        size_t length = std::min((size_t)(buf_size - total), chunk.length - input->offset);
+        memcpy(buf + total, chunk.data + input->offset, length);
+        total += length;
+        input->offset += length;
+        input->queuedBytes -= length;
+
+        if (input->offset == chunk.length)
+        {
+            input->offset = 0;
+            t++;
+            // hand the chunk back to the producer for release.
+            input->tail.store(t, std::memory_order_release);
+        }
+    }
+
+    return total;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <napi.h>
+extern "C"
+{
+#include <libavformat/avio.h>
+}
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// Feeds a demuxer from Buffers pushed by JS.
+// Pushed Buffers are queued by reference in a single producer (JS thread),
+// single consumer (demuxer thread) ring, and the AVIO read callback copies
+// out of them directly. References are dropped on the JS thread once the
+// demuxer has consumed a Buffer.
+class PushInput
+{
+public:
+    static PushInput *Create(size_t capacity, int *error);
+    ~PushInput();
+
+    // returns AVERROR(EAGAIN) if the queue is full and the buffer was not queued,
+    // AVERROR_EOF after End and AVERROR_EXIT after Abort.
+    int Push(napi_env env, napi_value buffer, const uint8_t *data, size_t length);
+    void End();
+    void Abort();
+    // js thread only.
+    void ReleaseConsumed(napi_env env);
+    void ReleaseAll(napi_env env);
+    size_t QueuedBytes() const;
+    // a read would not wait for js to push more data.
+    bool Readable() const;
+
+    AVIOContext *avio_ctx;
+    // polled while a read waits for data, custom io is not interrupted by the demuxer.
+    AVIOInterruptCB interrupt;
+
+private:
+    struct Chunk
+    {
+        napi_ref ref;
+        const uint8_t *data;
+        size_t length;
+    };
+
+    PushInput(size_t capacity);
+    static int ReadPacket(void *opaque, uint8_t *buf, int buf_size);
+
+    std::vector<Chunk> chunks;
+    size_t mask;
+    // head is written by the producer, tail by the consumer.
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    // producer only: chunks below this index have had their references deleted.
+    size_t released;
+    // consumer only: read offset into the chunk at tail.
+    size_t offset;
+    std::atomic<size_t> queuedBytes;
+    std::atomic<bool> ended;
+    std::atomic<bool> aborted;
+    // only used to park the consumer while the queue is empty.
+    std::mutex waitMutex;
+    std::condition_variable waitCondition;
+};
@@ -0,0 +1,169 @@
+#include "readahead.h"
+
+extern "C"
+{
+#include <libavutil/mathematics.h>
+#include <libavutil/time.h>
+}
+
+#include <algorithm>
+#include <chrono>
+
+// how often a waiting reader or consumer rechecks, ie for abort or a non blocking demuxer.
+static const int64_t POLL_INTERVAL = 5000;
+
+Readahead::Readahead(AVFormatContext *fmt_ctx, const Limits &limits)
+    : fmt_ctx(fmt_ctx), limits(limits), bytes(0), error(0), stopping(false), overflows(0), underruns(0)
+{
+    thread = std::thread(&Readahead::Run, this);
+}
+
+Readahead::~Readahead()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    thread.join();
+
+    for (Entry &entry : queue)
+    {
+        av_packet_free(&entry.packet);
+    }
+}
+
+bool Readahead::Full()
+{
+    return queue.size() >= limits.maxPackets || (limits.maxBytes && bytes >= limits.maxBytes) || (limits.maxDuration && Duration() >= limits.maxDuration);
+}
+
+int64_t Readahead::Duration()
+{
+    if (queue.size() < 2 || queue.front().time == AV_NOPTS_VALUE || queue.back().time == AV_NOPTS_VALUE)
+    {
+        return 0;
+    }
+    return std::max((int64_t)0, queue.back().time - queue.front().time);
+}
+
+void Readahead::Run()
+{
+    AVPacket *packet = av_packet_alloc();
+    if (!packet)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = AVERROR(ENOMEM);
+        condition.notify_all();
+        return;
+    }
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!stopping && Full())
+            {
+                overflows++;
+                condition.wait(lock, [this]()
+                               { return stopping || !Full(); });
+            }
+            if (stopping)
+            {
+                break;
+            }
+        }
+
+        int ret = av_read_frame(fmt_ctx, packet);
+        if (ret == AVERROR(EAGAIN))
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait_for(lock, std::chrono::microseconds(POLL_INTERVAL), [this]()
+                               { return stopping; });
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ret < 0)
+        {
+            error = ret;
+            condition.notify_all();
+            break;
+        }
+
+        AVStream *stream = fmt_ctx->streams[packet->stream_index];
+        packet->time_base = stream->time_base;
+        int64_t timestamp = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+        int64_t time = timestamp != AV_NOPTS_VALUE ? av_rescale_q(timestamp, stream->time_base, AV_TIME_BASE_Q) : AV_NOPTS_VALUE;
+        queue.push_back({packet, time});
+        bytes += packet->size;
+        condition.notify_all();
+
+        packet = av_packet_alloc();
+        if (!packet)
+        {
+            error = AVERROR(ENOMEM);
+            break;
+        }
+    }
+    av_packet_free(&packet);
+}
+
+int Readahead::Read(AVPacket *packet, int64_t deadline, const std::atomic<bool> &aborted, bool nonblocking)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (queue.empty() && !error)
+    {
+        underruns++;
+    }
+
+    while (queue.empty() && !error)
+    {
+        if (aborted)
+        {
+            return AVERROR_EXIT;
+        }
+        if (nonblocking)
+        {
+            return AVERROR(EAGAIN);
+        }
+        int64_t now = av_gettime_relative();
+        if (deadline && now >= deadline)
+        {
+            return AVERROR_EXIT;
+        }
+        int64_t wait = deadline ? std::min(deadline - now, POLL_INTERVAL * 20) : POLL_INTERVAL * 20;
+        condition.wait_for(lock, std::chrono::microseconds(wait));
+    }
+
+    if (queue.empty())
+    {
+        return error;
+    }
+
+    Entry entry = queue.front();
+    queue.pop_front();
+    bytes -= entry.packet->size;
+    av_packet_move_ref(packet, entry.packet);
+    av_packet_free(&entry.packet);
+    condition.notify_all();
+    return 0;
+}
+
+size_t Readahead::QueuedBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+Readahead::Stats Readahead::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.packets = queue.size();
+    stats.bytes = bytes;
+    stats.duration = Duration();
+    stats.overflows = overflows;
+    stats.underruns = underruns;
+    return stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+extern "C"
+{
+#include <libavformat/avformat.h>
+}
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Reads the packets of an input on a dedicated thread into a bounded queue,
+// so the network keeps being read while the pipeline decodes, and decoding
+// isn't held up by a read. Overflows count the times the reader waited on a
+// full queue (the pipeline is behind, cpu bound), underruns the times the
+// pipeline found it empty (the input is behind, network bound).
+// The demuxer may add streams while this thread reads, so fmt_ctx->streams is
+// not safe to index from the consumer. Packets carry their stream's time base
+// in time_base instead.
+// Times are in microseconds.
+class Readahead
+{
+public:
+    struct Limits
+    {
+        // 0 disables readahead.
+        size_t maxPackets;
+        size_t maxBytes;
+        // timestamp span of the queue, 0 for no limit.
+        int64_t maxDuration;
+    };
+
+    struct Stats
+    {
+        size_t packets;
+        size_t bytes;
+        int64_t duration;
+        uint64_t overflows;
+        uint64_t underruns;
+    };
+
+    // starts reading, the input must be open and no longer read by anyone else.
+    Readahead(AVFormatContext *fmt_ctx, const Limits &limits);
+    // a read in progress must be interrupted first, ie by abort.
+    ~Readahead();
+
+    // moves the next packet into packet. waits until the deadline, an
+    // av_gettime_relative time or 0 for none, and returns AVERROR_EXIT if
+    // it passes or aborted is set, or AVERROR(EAGAIN) if the queue is empty
+    // and nonblocking. the reader's error is returned once the queue is empty.
+    int Read(AVPacket *packet, int64_t deadline, const std::atomic<bool> &aborted, bool nonblocking);
+    size_t QueuedBytes();
+    Stats GetStats();
+
+private:
+    struct Entry
+    {
+        AVPacket *packet;
+        int64_t time;
+    };
+
+    void Run();
+    bool Full();
+    int64_t Duration();
+
+    AVFormatContext *fmt_ctx;
+    Limits limits;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Entry> queue;
+    size_t bytes;
+    // the error that stopped the reader, ie AVERROR_EOF.
+    int error;
+    bool stopping;
+    uint64_t overflows;
+    uint64_t underruns;
+    std::thread thread;
+};
@@ -0,0 +1,245 @@
+#include "rtp-pacer.h"
+
+extern "C"
+{
+#include <libavutil/avutil.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+// used until a stream has a frame duration or two timestamps.
+static const int64_t DEFAULT_FRAME_INTERVAL = 1000000 / 30;
+
+RtpPacer::RtpPacer(int64_t bitrate, int64_t burst, double spread, bool manualClock, std::function<void(std::vector<Packet> &)> onSend)
+    : bitrate(bitrate), burst(burst ? burst : bitrate / 8 / 100), spread(std::min(std::max(spread, 0.0), 1.0)),
+      manualClock(manualClock), onSend(onSend),
+      tokens(0), lastRefill(0), manualNow(0), stopped(false),
+      queuedBytes(0), maxQueueDepth(0), sent(0), totalDelay(0), maxDelay(0)
+{
+    tokens = this->burst;
+    lastRefill = Now();
+    if (!manualClock)
+    {
+        thread = std::thread(&RtpPacer::Run, this);
+    }
+}
+
+RtpPacer::~RtpPacer()
+{
+    Stop();
+
+    for (Packet &packet : pending)
+    {
+        av_free(packet.data);
+    }
+    for (Packet &packet : queue)
+    {
+        av_free(packet.data);
+    }
+}
+
+void RtpPacer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        condition.notify_one();
+    }
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+int64_t RtpPacer::Now()
+{
+    if (manualClock)
+    {
+        return manualNow;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RtpPacer::Enqueue(uint8_t *data, int size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Packet packet;
+    packet.data = data;
+    packet.size = size;
+    packet.sendAt = 0;
+    packet.queuedAt = 0;
+    pending.push_back(packet);
+}
+
+void RtpPacer::EndFrame(int streamIndex, int64_t pts, int64_t duration)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = streams.find(streamIndex);
+    if (found == streams.end())
+    {
+        found = streams.insert({streamIndex, {AV_NOPTS_VALUE, DEFAULT_FRAME_INTERVAL, 0}}).first;
+    }
+    StreamState &stream = found->second;
+
+    int64_t interval = duration;
+    if (pts != AV_NOPTS_VALUE)
+    {
+        if (interval <= 0 && stream.lastPts != AV_NOPTS_VALUE && pts > stream.lastPts)
+        {
+            interval = pts - stream.lastPts;
+        }
+        stream.lastPts = pts;
+    }
+    if (interval > 0)
+    {
+        stream.interval = interval;
+    }
+
+    if (pending.empty())
+    {
+        return;
+    }
+
+    int64_t now = Now();
+    int64_t span = stream.interval * spread;
+    // a frame that arrives while the previous one of its stream is still being paced goes after it.
+    int64_t start = std::max(now, stream.scheduledUntil);
+    size_t count = pending.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        Packet &packet = pending[i];
+        packet.sendAt = start + span * (int64_t)i / (int64_t)count;
+        packet.queuedAt = now;
+        queuedBytes += packet.size;
+        // streams are scheduled independently, so the queue is kept in send order across them.
+        auto at = std::upper_bound(queue.begin(), queue.end(), packet.sendAt, [](int64_t sendAt, const Packet &queued)
+                                   { return sendAt < queued.sendAt; });
+        queue.insert(at, packet);
+    }
+    pending.clear();
+    stream.scheduledUntil = start + span;
+    maxQueueDepth = std::max(maxQueueDepth, queue.size());
+
+    condition.notify_one();
+}
+
+int64_t RtpPacer::Pump(int64_t now, std::vector<Packet> &sending)
+{
+    if (bitrate > 0)
+    {
+        tokens = std::min((double)burst, tokens + (double)(now - lastRefill) * bitrate / 8 / 1000000);
+    }
+    lastRefill = now;
+
+    while (!queue.empty())
+    {
+        Packet &packet = queue.front();
+        if (packet.sendAt > now)
+        {
+            return packet.sendAt;
+        }
+
+        if (bitrate > 0)
+        {
+            // a datagram larger than the bucket goes out once the bucket is full.
+            double needed = std::min((double)packet.size, (double)burst);
+            if (tokens < needed)
+            {
+                return now + (int64_t)((needed - tokens) * 8 * 1000000 / bitrate) + 1;
+            }
+            tokens -= packet.size;
+        }
+
+        int64_t delay = now - packet.queuedAt;
+        totalDelay += delay;
+        maxDelay = std::max(maxDelay, delay);
+        queuedBytes -= packet.size;
+        sent++;
+        sending.push_back(packet);
+        queue.pop_front();
+    }
+
+    return INT64_MAX;
+}
+
+void RtpPacer::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<Packet> sending;
+    while (!stopped)
+    {
+        int64_t next = Pump(Now(), sending);
+        if (!sending.empty())
+        {
+            lock.unlock();
+            onSend(sending);
+            sending.clear();
+            lock.lock();
+            continue;
+        }
+
+        if (next == INT64_MAX)
+        {
+            condition.wait(lock);
+        }
+        else
+        {
+            condition.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::microseconds(next)));
+        }
+    }
+}
+
+void RtpPacer::Advance(int64_t microseconds)
+{
+    std::vector<Packet> sending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!manualClock)
+        {
+            return;
+        }
+        manualNow += microseconds;
+        Pump(manualNow, sending);
+    }
+    if (!sending.empty())
+    {
+        onSend(sending);
+    }
+}
+
+void RtpPacer::Drain()
+{
+    // stop the timer thread first so nothing is sent out of order.
+    Stop();
+
+    std::vector<Packet> sending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sending.assign(queue.begin(), queue.end());
+        sending.insert(sending.end(), pending.begin(), pending.end());
+        queue.clear();
+        pending.clear();
+        queuedBytes = 0;
+    }
+    if (!sending.empty())
+    {
+        onSend(sending);
+    }
+}
+
+RtpPacer::Stats RtpPacer::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.queueDepth = queue.size() + pending.size();
+    stats.queuedBytes = queuedBytes;
+    stats.maxQueueDepth = maxQueueDepth;
+    stats.sent = sent;
+    stats.averageDelay = sent ? totalDelay / (int64_t)sent : 0;
+    stats.maxDelay = maxDelay;
+    return stats;
+}
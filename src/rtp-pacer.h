@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Spreads each muxed frame's datagrams over a fraction of the frame interval,
+// and optionally holds them to a token bucket at the target bitrate, so a
+// keyframe doesn't hit the network as a single burst.
+// Datagrams are released from a native timer thread, or, with a manual clock,
+// synchronously from Advance so pacing can be tested deterministically.
+// Times are in microseconds.
+class RtpPacer
+{
+public:
+    struct Packet
+    {
+        // av_malloc'd, ownership passes to the send callback.
+        uint8_t *data;
+        int size;
+        int64_t sendAt;
+        int64_t queuedAt;
+    };
+
+    struct Stats
+    {
+        size_t queueDepth;
+        size_t queuedBytes;
+        size_t maxQueueDepth;
+        uint64_t sent;
+        int64_t averageDelay;
+        int64_t maxDelay;
+    };
+
+    // bitrate is in bits per second, 0 disables the token bucket.
+    // burst is the bucket size in bytes, 0 picks 10ms of bitrate.
+    RtpPacer(int64_t bitrate, int64_t burst, double spread, bool manualClock, std::function<void(std::vector<Packet> &)> onSend);
+    ~RtpPacer();
+
+    // queues a datagram of the frame being muxed.
+    void Enqueue(uint8_t *data, int size);
+    // schedules the datagrams queued since the last call. pts and duration may be AV_NOPTS_VALUE/0,
+    // the interval then comes from the previous frame of the stream.
+    void EndFrame(int streamIndex, int64_t pts, int64_t duration);
+    // manual clock only.
+    void Advance(int64_t microseconds);
+    // stops pacing and sends everything queued immediately, ie on close.
+    void Drain();
+    Stats GetStats();
+
+private:
+    void Stop();
+    int64_t Now();
+    // moves due packets to sending, returns when the next one is due.
+    int64_t Pump(int64_t now, std::vector<Packet> &sending);
+    void Run();
+
+    int64_t bitrate;
+    int64_t burst;
+    double spread;
+    bool manualClock;
+    std::function<void(std::vector<Packet> &)> onSend;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Packet> pending;
+    std::deque<Packet> queue;
+    // per stream index, so one stream's frames don't set another's spread or wait behind it.
+    struct StreamState
+    {
+        int64_t lastPts;
+        int64_t interval;
+        int64_t scheduledUntil;
+    };
+    std::map<int, StreamState> streams;
+    double tokens;
+    int64_t lastRefill;
+    int64_t manualNow;
+    bool stopped;
+
+    size_t queuedBytes;
+    size_t maxQueueDepth;
+    uint64_t sent;
+    int64_t totalDelay;
+    int64_t maxDelay;
+
+    std::thread thread;
+};
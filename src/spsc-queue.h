@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded single producer, single consumer ring. Push and Pop never lock or
+// block, callers park on their own condition when the ring is full or empty.
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+        : head(0), tail(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        items.resize(size);
+        mask = size - 1;
+    }
+
+    // producer only, returns false if the ring is full.
+    bool Push(const T &item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask)
+        {
+            return false;
+        }
+        items[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, returns false if the ring is empty.
+    bool Pop(T *item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        *item = items[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    bool Full() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire) > mask;
+    }
+
+private:
+    std::vector<T> items;
+    size_t mask;
+    // head is written by the producer, tail by the consumer.
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
@@ -0,0 +1,263 @@
+#include "stream-worker.h"
+#include "codeccontext.h"
+#include "filter.h"
+#include "av-pointer.h"
+
+#include <chrono>
+
+static const size_t PACKET_QUEUE_SIZE = 32;
+// decoded frames hold decoder surfaces, keep few of them waiting on js.
+static const size_t RESULT_QUEUE_SIZE = 4;
+
+StreamWorker::StreamWorker()
+    : packets(PACKET_QUEUE_SIZE), results(RESULT_QUEUE_SIZE), held{nullptr, {}}, processing(false), stopped(false), error(0)
+{
+    thread = std::thread(&StreamWorker::Run, this);
+}
+
+StreamWorker::~StreamWorker()
+{
+    stopped = true;
+    Notify(workerCondition);
+    thread.join();
+
+    Item item;
+    while (packets.Pop(&item))
+    {
+        av_packet_free(&item.packet);
+        Pipeline::UseCodecs(item.chain, -1);
+    }
+    if (held.packet)
+    {
+        av_packet_free(&held.packet);
+        Pipeline::UseCodecs(held.chain, -1);
+    }
+    PipelineResult result;
+    while (results.Pop(&result))
+    {
+        av_packet_free(&result.packet);
+        av_frame_free(&result.frame);
+    }
+}
+
+// lock so the wakeup can't slip in between the other side's check and its wait.
+void StreamWorker::Notify(std::condition_variable &condition)
+{
+    std::lock_guard<std::mutex> lock(waitMutex);
+    condition.notify_one();
+}
+
+bool StreamWorker::Send(AVPacket *packet, const StreamChain &chain)
+{
+    // the pipeline that sent it may be gone before the packet is processed.
+    Pipeline::UseCodecs(chain, 1);
+    held = {packet, chain};
+    return Flush();
+}
+
+bool StreamWorker::Flush()
+{
+    if (!held.packet)
+    {
+        return true;
+    }
+    if (!packets.Push(held))
+    {
+        return false;
+    }
+    held.packet = nullptr;
+    Notify(workerCondition);
+    return true;
+}
+
+bool StreamWorker::Receive(PipelineResult *result)
+{
+    if (!results.Pop(result))
+    {
+        return false;
+    }
+    Notify(workerCondition);
+    return true;
+}
+
+bool StreamWorker::Busy()
+{
+    return held.packet || processing || !packets.Empty() || !results.Empty();
+}
+
+void StreamWorker::Wait()
+{
+    std::unique_lock<std::mutex> lock(waitMutex);
+    // the timeout only guards against a missed state, ie a chain error.
+    demuxerCondition.wait_for(lock, std::chrono::milliseconds(10), [this]()
+                              { return (held.packet && !packets.Full()) || !results.Empty() || (!processing && packets.Empty()); });
+}
+
+int StreamWorker::TakeError()
+{
+    return error.exchange(0);
+}
+
+void StreamWorker::Run()
+{
+    while (!stopped)
+    {
+        Item item;
+        // set before the pop so Busy never sees an empty queue and an idle worker in between.
+        processing = true;
+        if (!packets.Pop(&item))
+        {
+            processing = false;
+            Notify(demuxerCondition);
+            std::unique_lock<std::mutex> lock(waitMutex);
+            workerCondition.wait(lock, [this]()
+                                 { return stopped || !packets.Empty(); });
+            continue;
+        }
+        Notify(demuxerCondition);
+
+        int ret = Process(item.chain, item.packet);
+        av_packet_free(&item.packet);
+        Pipeline::UseCodecs(item.chain, -1);
+        if (ret < 0)
+        {
+            int expected = 0;
+            error.compare_exchange_strong(expected, ret);
+        }
+    }
+    processing = false;
+}
+
+int StreamWorker::Process(const StreamChain &chain, AVPacket *packet)
+{
+    AVCodecContext *codecContext = chain.decoder->codecContext;
+    if (!codecContext)
+    {
+        return 0;
+    }
+
+    // On decoder feed error, try again with next packet
+    if (chain.decoder->DecodePacket(packet))
+    {
+        return 0;
+    }
+
+    FreePointer<AVFrame, av_frame_free> frame(av_frame_alloc());
+    if (!frame.get())
+    {
+        return AVERROR(ENOMEM);
+    }
+
+    int ret = 0;
+    while (!stopped && !(ret = avcodec_receive_frame(codecContext, frame.get())))
+    {
+        // dropped before the filter or a js object is involved.
+        if (!chain.decoder->AcceptFrame(frame.get()))
+        {
+            av_frame_unref(frame.get());
+            continue;
+        }
+
+        if (!chain.filter)
+        {
+            ret = Output(chain, frame.get());
+            av_frame_unref(frame.get());
+            if (ret < 0)
+            {
+                return ret;
+            }
+            continue;
+        }
+
+        ret = av_buffersrc_add_frame_flags(chain.filter->buffersrc_ctxs[0], frame.get(), 0);
+        if (ret < 0)
+        {
+            return ret;
+        }
+        while (!(ret = av_buffersink_get_frame(chain.filter->buffersink_ctxs[0], frame.get())))
+        {
+            ret = Output(chain, frame.get());
+            av_frame_unref(frame.get());
+            if (ret < 0)
+            {
+                return ret;
+            }
+        }
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+        {
+            return ret;
+        }
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+// publishes and encodes or emits the frame, which is referenced, not taken.
+int StreamWorker::Output(const StreamChain &chain, AVFrame *frame)
+{
+    Pipeline::PublishFrame(chain, frame);
+
+    if (!chain.encoder)
+    {
+        AVFrame *clone = av_frame_clone(frame);
+        if (!clone)
+        {
+            return AVERROR(ENOMEM);
+        }
+        Emit({nullptr, -1, clone, chain.streamIndex});
+        return 0;
+    }
+
+    int ret = chain.encoder->EncodeFrame(frame);
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    while (true)
+    {
+        FreePointer<AVPacket, av_packet_free> packet(av_packet_alloc());
+        if (!packet.get())
+        {
+            return AVERROR(ENOMEM);
+        }
+        ret = avcodec_receive_packet(chain.encoder->codecContext, packet.get());
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+        {
+            return 0;
+        }
+        if (ret < 0)
+        {
+            return ret;
+        }
+
+        bool written;
+        ret = Pipeline::WriteOutputs(chain, packet.get(), &written);
+        if (ret < 0)
+        {
+            return ret;
+        }
+        if (!written)
+        {
+            Emit({packet.release(), chain.streamIndex, nullptr, -1});
+        }
+    }
+}
+
+// parks while js is behind, which backs up into the packet queue and then the demuxer.
+void StreamWorker::Emit(const PipelineResult &result)
+{
+    while (!results.Push(result))
+    {
+        std::unique_lock<std::mutex> lock(waitMutex);
+        workerCondition.wait(lock, [this]()
+                             { return stopped || !results.Full(); });
+        if (stopped)
+        {
+            PipelineResult dropped = result;
+            av_packet_free(&dropped.packet);
+            av_frame_free(&dropped.frame);
+            return;
+        }
+    }
+    Notify(demuxerCondition);
+}
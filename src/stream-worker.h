@@ -0,0 +1,68 @@
+#pragma once
+
+extern "C"
+{
+#include <libavcodec/avcodec.h>
+}
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "pipeline.h"
+#include "spsc-queue.h"
+
+// Runs the decoder, filter and encoder chain of one input stream on its own
+// thread, so the streams of an input decode and encode in parallel and a slow
+// video encode doesn't hold up audio. Packets are handed over by the demuxer
+// and results handed back through lock free queues, the mutex and conditions
+// only park a side that has nothing to do.
+// Send, Receive, Wait and Busy are called by whoever holds the io mutex of
+// the input, one thread at a time.
+class StreamWorker
+{
+public:
+    StreamWorker();
+    // stops the thread after the packet being processed.
+    ~StreamWorker();
+
+    // takes the packet. returns false if the queue is full, the packet is then
+    // held until Flush finds room for it and no other packet may be sent.
+    bool Send(AVPacket *packet, const StreamChain &chain);
+    bool Flush();
+    bool Receive(PipelineResult *result);
+    // parks until there is room for a packet, a result, or the worker is idle.
+    void Wait();
+    // packets are queued, held or being processed.
+    bool Busy();
+    // the first error of the chain, returned once.
+    int TakeError();
+
+private:
+    struct Item
+    {
+        AVPacket *packet;
+        StreamChain chain;
+    };
+
+    void Run();
+    int Process(const StreamChain &chain, AVPacket *packet);
+    int Output(const StreamChain &chain, AVFrame *frame);
+    void Emit(const PipelineResult &result);
+    void Notify(std::condition_variable &condition);
+
+    SpscQueue<Item> packets;
+    SpscQueue<PipelineResult> results;
+    // demuxer side, a packet that didn't fit.
+    Item held;
+    std::atomic<bool> processing;
+    std::atomic<bool> stopped;
+    std::atomic<int> error;
+    std::mutex waitMutex;
+    // the worker parks on this while it has no packet or no room for a result.
+    std::condition_variable workerCondition;
+    // the demuxer parks on this while it has no room for a packet.
+    std::condition_variable demuxerCondition;
+    std::thread thread;
+};
@@ -0,0 +1,213 @@
+#include "udp-sink.h"
+
+extern "C"
+{
+#include <libavutil/error.h>
+}
+
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+// enough for a keyframe's worth of full size datagrams per syscall.
+static const size_t MAX_BATCH = 64;
+static const size_t ARENA_SIZE = 256 * 1024;
+
+UdpSink::UdpSink(int fd, bool ownsFd)
+    : packets(0), bytes(0), drops(0), errors(0), fd(fd), ownsFd(ownsFd),
+      arena(ARENA_SIZE), used(0)
+{
+#ifndef _WIN32
+    memset(&destination, 0, sizeof(destination));
+    destinationLength = 0;
+#endif
+    offsets.reserve(MAX_BATCH);
+    lengths.reserve(MAX_BATCH);
+}
+
+UdpSink::~UdpSink()
+{
+#ifndef _WIN32
+    if (ownsFd)
+    {
+        close(fd);
+    }
+#endif
+}
+
+int UdpSink::SetDestination(const std::string &address, int port)
+{
+#ifdef _WIN32
+    return AVERROR(ENOSYS);
+#else
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_DGRAM;
+    // numeric only, so creating a sink never blocks on a dns lookup.
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+
+    addrinfo *result = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(address.c_str(), service.c_str(), &hints, &result) || !result)
+    {
+        return AVERROR(EINVAL);
+    }
+
+    memcpy(&destination, result->ai_addr, result->ai_addrlen);
+    destinationLength = result->ai_addrlen;
+    freeaddrinfo(result);
+    return 0;
+#endif
+}
+
+UdpSink *UdpSink::Create(const std::string &address, int port, int *error)
+{
+#ifdef _WIN32
+    *error = AVERROR(ENOSYS);
+    return nullptr;
+#else
+    UdpSink *sink = new UdpSink(-1, true);
+    int ret = sink->SetDestination(address, port);
+    if (ret < 0)
+    {
+        delete sink;
+        *error = ret;
+        return nullptr;
+    }
+
+    sink->fd = socket(sink->destination.ss_family, SOCK_DGRAM, 0);
+    if (sink->fd < 0)
+    {
+        *error = AVERROR(errno);
+        delete sink;
+        return nullptr;
+    }
+    fcntl(sink->fd, F_SETFD, FD_CLOEXEC);
+    fcntl(sink->fd, F_SETFL, fcntl(sink->fd, F_GETFL) | O_NONBLOCK);
+
+    return sink;
+#endif
+}
+
+UdpSink *UdpSink::FromFd(int fd, const std::string &address, int port, int *error)
+{
+#ifdef _WIN32
+    *error = AVERROR(ENOSYS);
+    return nullptr;
+#else
+    UdpSink *sink = new UdpSink(fd, false);
+    if (!address.empty())
+    {
+        int ret = sink->SetDestination(address, port);
+        if (ret < 0)
+        {
+            delete sink;
+            *error = ret;
+            return nullptr;
+        }
+    }
+
+    // the socket may be shared with js, so it is made non blocking per send rather than globally.
+    return sink;
+#endif
+}
+
+uint8_t *UdpSink::Reserve(size_t capacity)
+{
+    if (offsets.size() == MAX_BATCH || used + capacity > arena.size())
+    {
+        Flush();
+    }
+    if (capacity > arena.size())
+    {
+        arena.resize(capacity);
+    }
+    return arena.data() + used;
+}
+
+void UdpSink::Commit(size_t length)
+{
+    offsets.push_back(used);
+    lengths.push_back(length);
+    used += length;
+}
+
+void UdpSink::Flush()
+{
+#ifndef _WIN32
+    size_t count = offsets.size();
+    size_t sent = 0;
+    sockaddr *name = destinationLength ? (sockaddr *)&destination : nullptr;
+    int flags = ownsFd ? 0 : MSG_DONTWAIT;
+
+    while (sent < count)
+    {
+#ifdef __linux__
+        mmsghdr messages[MAX_BATCH];
+        iovec iovecs[MAX_BATCH];
+        size_t batch = count - sent;
+        for (size_t i = 0; i < batch; i++)
+        {
+            iovecs[i].iov_base = arena.data() + offsets[sent + i];
+            iovecs[i].iov_len = lengths[sent + i];
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_name = name;
+            messages[i].msg_hdr.msg_namelen = destinationLength;
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int ret = sendmmsg(fd, messages, batch, flags);
+        if (ret > 0)
+        {
+            for (int i = 0; i < ret; i++)
+            {
+                bytes += messages[i].msg_len;
+            }
+            packets += ret;
+            sent += ret;
+            continue;
+        }
+        if (ret == 0)
+        {
+            // nothing was sent and errno is not set, so the rest of the batch is dropped.
+            drops += count - sent;
+            break;
+        }
+#else
+        const uint8_t *data = arena.data() + offsets[sent];
+        ssize_t ret = sendto(fd, data, lengths[sent], flags, name, destinationLength);
+        if (ret >= 0)
+        {
+            bytes += ret;
+            packets++;
+            sent++;
+            continue;
+        }
+#endif
+
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+        {
+            // the rest of the batch would fail the same way.
+            drops += count - sent;
+            break;
+        }
+        // skip the datagram the socket rejected.
+        errors++;
+        sent++;
+    }
+#endif
+
+    offsets.clear();
+    lengths.clear();
+    used = 0;
+}
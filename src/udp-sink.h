@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+// Sends muxer output straight to a UDP socket from the muxing thread.
+// Each write is one datagram; datagrams are queued and sent in a batch
+// (sendmmsg where available) when Flush is called, ie once per muxed frame.
+// The socket is non blocking, datagrams that don't fit in the socket buffer
+// are dropped and counted rather than stalling the muxer.
+class UdpSink
+{
+public:
+    // sends to address:port from a new socket.
+    static UdpSink *Create(const std::string &address, int port, int *error);
+    // sends on a socket owned by the caller, to address:port if given, otherwise the socket must be connected.
+    static UdpSink *FromFd(int fd, const std::string &address, int port, int *error);
+    ~UdpSink();
+
+    // returns space for a datagram of up to capacity bytes, flushing first if the batch is full.
+    uint8_t *Reserve(size_t capacity);
+    void Commit(size_t length);
+    void Flush();
+
+    std::atomic<uint64_t> packets;
+    std::atomic<uint64_t> bytes;
+    // datagrams dropped because the socket buffer was full.
+    std::atomic<uint64_t> drops;
+    // datagrams rejected by the socket, ie ECONNREFUSED after an ICMP unreachable.
+    std::atomic<uint64_t> errors;
+
+private:
+    UdpSink(int fd, bool ownsFd);
+    int SetDestination(const std::string &address, int port);
+
+    int fd;
+    bool ownsFd;
+#ifndef _WIN32
+    sockaddr_storage destination;
+    socklen_t destinationLength;
+#endif
+
+    // datagrams are packed back to back in the arena.
+    std::vector<uint8_t> arena;
+    size_t used;
+    std::vector<size_t> offsets;
+    std::vector<size_t> lengths;
+};
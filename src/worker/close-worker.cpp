@@ -1,6 +1,20 @@
 #include "close-worker.h"
 #include "../formatcontext.h"
 #include "../error.h"
+#include "../mmap-input.h"
+#include "../push-input.h"
+#include "../fragmented-output.h"
+#include "../hls-segmenter.h"
+#include "../udp-sink.h"
+#include "../rtp-pacer.h"
+#include "../live-edge.h"
+#include "../stream-worker.h"
+#include "../readahead.h"
+
+extern "C"
+{
+#include <libavformat/srtp.h>
+}
 
 CloseWorker::CloseWorker(napi_env env, napi_deferred deferred, AVFormatContextObject *formatContextObject)
     : Napi::AsyncWorker(env), deferred(deferred), formatContextObject(formatContextObject)
@@ -9,20 +23,79 @@ CloseWorker::CloseWorker(napi_env env, napi_deferred deferred, AVFormatContextOb
 
 void CloseWorker::Execute()
 {
+    // an in flight read or open was interrupted by close, wait for it to return.
+    std::lock_guard<std::mutex> lock(formatContextObject->ioMutex);
+    // the stream threads use the decoders, so they stop before close resolves.
+    for (auto &pair : formatContextObject->streamWorkers) {
+        delete pair.second;
+    }
+    formatContextObject->streamWorkers.clear();
+    // close aborted its read, it stops before the demuxer is closed.
+    if (formatContextObject->readahead) {
+        delete formatContextObject->readahead;
+        formatContextObject->readahead = nullptr;
+    }
+    // broadcaster subscribers write into an output from their own threads, the context
+    // is freed between their writes, which then see it is gone.
+    std::lock_guard<std::mutex> writeLock(formatContextObject->writeMutex);
     if (formatContextObject->fmt_ctx_) {
         if (formatContextObject->is_input) {
             avformat_close_input(&formatContextObject->fmt_ctx_);
         }
+        if (formatContextObject->fragmentedOutput) {
+            // deliver whatever was written since the last fragment.
+            formatContextObject->fragmentedOutput->Flush(formatContextObject->fmt_ctx_);
+            delete formatContextObject->fragmentedOutput;
+            formatContextObject->fragmentedOutput = nullptr;
+        }
+        if (formatContextObject->pacer) {
+            // send what is still being paced rather than dropping the end of the stream.
+            formatContextObject->pacer->Drain();
+        }
         if (formatContextObject->callbackRef) {
             formatContextObject->callbackRef.Release();
         }
         avformat_free_context(formatContextObject->fmt_ctx_);
         formatContextObject->fmt_ctx_ = nullptr;
     }
+    if (formatContextObject->srtp) {
+        std::lock_guard<std::mutex> lock(formatContextObject->srtpMutex);
+        ff_srtp_free(formatContextObject->srtp);
+        av_freep(&formatContextObject->srtp);
+    }
+    // custom io is left open by avformat_close_input.
+    if (formatContextObject->mmapInput) {
+        delete formatContextObject->mmapInput;
+        formatContextObject->mmapInput = nullptr;
+    }
 }
 
 void CloseWorker::OnOK()
 {
+    // pushed buffers are referenced from js, so they can only be released here.
+    if (formatContextObject->pushInput) {
+        formatContextObject->pushInput->ReleaseAll(Env());
+        delete formatContextObject->pushInput;
+        formatContextObject->pushInput = nullptr;
+    }
+    // stats may be read from js until the muxer is gone.
+    if (formatContextObject->pacer) {
+        delete formatContextObject->pacer;
+        formatContextObject->pacer = nullptr;
+    }
+    if (formatContextObject->udpSink) {
+        delete formatContextObject->udpSink;
+        formatContextObject->udpSink = nullptr;
+    }
+    if (formatContextObject->liveEdge) {
+        delete formatContextObject->liveEdge;
+        formatContextObject->liveEdge = nullptr;
+    }
+    // segments may be requested from js until the muxer is gone.
+    if (formatContextObject->hlsSegmenter) {
+        delete formatContextObject->hlsSegmenter;
+        formatContextObject->hlsSegmenter = nullptr;
+    }
     napi_resolve_deferred(Env(), deferred, Env().Undefined());
 }
 
@@ -0,0 +1,87 @@
+#include "decode-worker.h"
+#include "../error.h"
+#include "../frame.h"
+#include "../av-pointer.h"
+
+DecodeWorker::DecodeWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext, AVPacketObject *packet)
+    : ScheduledWorker(env, codecContext->priority, &codecContext->executor), deferred(deferred), codecContext(codecContext),
+      flush(!packet), packet(packet && packet->packet ? av_packet_clone(packet->packet) : nullptr)
+{
+}
+
+DecodeWorker::~DecodeWorker()
+{
+    av_packet_free(&packet);
+    for (AVFrame *frame : frames) {
+        av_frame_free(&frame);
+    }
+}
+
+// receives until the decoder needs more input, skipping frames dropped by the output rate policy.
+int DecodeWorker::ReceiveFrames() {
+    while (true) {
+        FreePointer<AVFrame, av_frame_free> frame(av_frame_alloc());
+        if (!frame.get()) {
+            return AVERROR(ENOMEM);
+        }
+        int ret = avcodec_receive_frame(codecContext->codecContext, frame.get());
+        if (ret < 0) {
+            return ret;
+        }
+        if (codecContext->AcceptFrame(frame.get())) {
+            frames.push_back(frame.release());
+        }
+    }
+}
+
+void DecodeWorker::Execute() {
+    if (!codecContext || !codecContext->codecContext) {
+        SetError("Codec Context is null");
+        return;
+    }
+    if (!flush && !packet) {
+        SetError("Decode received null packet");
+        return;
+    }
+
+    int ret = codecContext->DecodePacket(packet);
+    // the decoder is full, ie frames were left by receiveFrame. drain it and send again.
+    if (ret == AVERROR(EAGAIN)) {
+        ret = ReceiveFrames();
+        if (ret != AVERROR(EAGAIN)) {
+            SetError(AVErrorString(ret));
+            return;
+        }
+        ret = codecContext->DecodePacket(packet);
+    }
+    // a decoder that is already draining returns EOF, the remaining frames are still received.
+    if (ret < 0 && !(flush && ret == AVERROR_EOF)) {
+        SetError(AVErrorString(ret));
+        return;
+    }
+
+    ret = ReceiveFrames();
+    if (ret == AVERROR_EOF) {
+        // ready for the next stream, ie after a seek.
+        avcodec_flush_buffers(codecContext->codecContext);
+        return;
+    }
+    if (ret != AVERROR(EAGAIN)) {
+        SetError(AVErrorString(ret));
+    }
+}
+
+void DecodeWorker::OnOK() {
+    Napi::Env env = Env();
+    Napi::Array array = Napi::Array::New(env, frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        array.Set(i, AVFrameObject::NewInstance(env, frames[i]));
+    }
+    frames.clear();
+    napi_resolve_deferred(env, deferred, array);
+}
+
+void DecodeWorker::OnError(const Napi::Error &e) {
+    napi_value error = e.Value();
+    napi_reject_deferred(Env(), deferred, error);
+}
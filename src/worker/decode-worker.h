@@ -0,0 +1,31 @@
+#pragma once
+#include <napi.h>
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+#include <vector>
+#include "../packet.h"
+#include "../codeccontext.h"
+#include "scheduled-worker.h"
+
+// Sends a packet and receives every frame it produces in one worker, rather
+// than a worker per sendPacket and receiveFrame call. Without a packet it
+// drains the decoder at end of stream and resets it for reuse.
+class DecodeWorker : public ScheduledWorker {
+public:
+    // references the packet now, js may reuse or destroy it before the worker runs.
+    DecodeWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext, AVPacketObject *packet);
+    ~DecodeWorker();
+    void Execute() override;
+    void OnOK() override;
+    void OnError(const Napi::Error &e) override;
+
+private:
+    int ReceiveFrames();
+
+    napi_deferred deferred;
+    AVCodecContextObject *codecContext;
+    bool flush;
+    AVPacket *packet;
+    std::vector<AVFrame *> frames;
+};
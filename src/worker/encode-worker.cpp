@@ -0,0 +1,97 @@
+#include "encode-worker.h"
+#include "../error.h"
+#include "../av-pointer.h"
+
+EncodeWorker::EncodeWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext, std::vector<AVFrame *> frames,
+                           bool drain, Napi::Object writeContext, int streamIndex)
+    : ScheduledWorker(env, codecContext->priority, &codecContext->executor), deferred(deferred), codecContext(codecContext),
+      frames(std::move(frames)), writeContextRef(Napi::Persistent(writeContext)),
+      writeContext(Napi::ObjectWrap<AVFormatContextObject>::Unwrap(writeContext)), streamIndex(streamIndex), bytes(0)
+{
+    // an empty batch leaves the encoder as it is, only a drain sends it the null frame.
+    if (drain) {
+        this->frames.push_back(nullptr);
+    }
+}
+
+EncodeWorker::~EncodeWorker()
+{
+    for (AVFrame *frame : frames) {
+        av_frame_free(&frame);
+    }
+}
+
+// receives and writes until the encoder needs more input.
+int EncodeWorker::WritePackets() {
+    FreePointer<AVPacket, av_packet_free> packet(av_packet_alloc());
+    if (!packet.get()) {
+        return AVERROR(ENOMEM);
+    }
+
+    while (true) {
+        int ret = avcodec_receive_packet(codecContext->codecContext, packet.get());
+        if (ret < 0) {
+            return ret;
+        }
+
+        packet->stream_index = streamIndex;
+        bool keyframe = packet->flags & AV_PKT_FLAG_KEY;
+        int size = packet->size;
+        ret = writeContext->WritePacket(packet.get());
+        av_packet_unref(packet.get());
+        if (ret < 0) {
+            return ret;
+        }
+        keyframes.push_back(keyframe);
+        bytes += size;
+    }
+}
+
+void EncodeWorker::Execute() {
+    if (!codecContext || !codecContext->codecContext) {
+        SetError("Codec Context is null");
+        return;
+    }
+
+    for (AVFrame *frame : frames) {
+        int ret = codecContext->EncodeFrame(frame);
+        // the encoder is full, ie packets were left by receivePacket. write them and send again.
+        if (ret == AVERROR(EAGAIN)) {
+            ret = WritePackets();
+            if (ret != AVERROR(EAGAIN)) {
+                SetError(AVErrorString(ret));
+                return;
+            }
+            ret = codecContext->EncodeFrame(frame);
+        }
+        // an encoder that is already draining returns EOF.
+        if (ret < 0 && !(!frame && ret == AVERROR_EOF)) {
+            SetError(AVErrorString(ret));
+            return;
+        }
+
+        ret = WritePackets();
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+            SetError(AVErrorString(ret));
+            return;
+        }
+    }
+}
+
+void EncodeWorker::OnOK() {
+    Napi::Env env = Env();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("packets", Napi::Number::New(env, keyframes.size()));
+    result.Set("bytes", Napi::Number::New(env, bytes));
+    Napi::Array keyframesArray = Napi::Array::New(env, keyframes.size());
+    for (size_t i = 0; i < keyframes.size(); i++) {
+        keyframesArray.Set(i, Napi::Boolean::New(env, keyframes[i]));
+    }
+    result.Set("keyframes", keyframesArray);
+    napi_resolve_deferred(env, deferred, result);
+}
+
+void EncodeWorker::OnError(const Napi::Error &e) {
+    napi_value error = e.Value();
+    napi_reject_deferred(Env(), deferred, error);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <napi.h>
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+#include <vector>
+#include "../codeccontext.h"
+#include "../formatcontext.h"
+#include "scheduled-worker.h"
+
+// Sends frames to an encoder and muxes every packet it produces into a stream
+// of a write context, in one worker, so packets never reach js. With drain set
+// it instead drains the encoder at end of stream.
+class EncodeWorker : public ScheduledWorker {
+public:
+    // takes ownership of the frames.
+    EncodeWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext, std::vector<AVFrame *> frames,
+                 bool drain, Napi::Object writeContext, int streamIndex);
+    ~EncodeWorker();
+    void Execute() override;
+    void OnOK() override;
+    void OnError(const Napi::Error &e) override;
+
+private:
+    int WritePackets();
+
+    napi_deferred deferred;
+    AVCodecContextObject *codecContext;
+    std::vector<AVFrame *> frames;
+    // keep the write context alive while muxing.
+    Napi::ObjectReference writeContextRef;
+    AVFormatContextObject *writeContext;
+    int streamIndex;
+    int64_t bytes;
+    std::vector<bool> keyframes;
+};
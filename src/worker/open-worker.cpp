@@ -1,17 +1,87 @@
 #include "open-worker.h"
 #include "../formatcontext.h"
 #include "../error.h"
+#include "../mmap-input.h"
+#include "../push-input.h"
 
-OpenWorker::OpenWorker(napi_env env, napi_deferred deferred, AVFormatContextObject *formatContextObject, const std::string &filename, AVDictionary* options)
-    : Napi::AsyncWorker(env), deferred(deferred), formatContextObject(formatContextObject), filename(filename), options(options)
+extern "C"
+{
+#include <libavutil/time.h>
+}
+
+OpenWorker::OpenWorker(napi_env env, napi_deferred deferred, AVFormatContextObject *formatContextObject, const std::string &filename, AVDictionary* options, bool useMmap, const AVInputFormat *inputFormat, int64_t timeout, const Readahead::Limits &readahead)
+    : Napi::AsyncWorker(env), deferred(deferred), formatContextObject(formatContextObject), filename(filename), options(options), useMmap(useMmap), inputFormat(inputFormat), timeout(timeout), readahead(readahead)
 {
 }
 
 void OpenWorker::Execute()
 {
-    int ret = avformat_open_input(&formatContextObject->fmt_ctx_, filename.c_str(), NULL, &options);
+    std::lock_guard<std::mutex> lock(formatContextObject->ioMutex);
+    if (formatContextObject->aborted)
+    {
+        av_dict_free(&options);
+        SetError(AVErrorString(AVERROR_EXIT));
+        return;
+    }
+
+    int ret;
+    if (useMmap)
+    {
+        formatContextObject->mmapInput = MmapInput::Open(filename, &ret);
+        if (!formatContextObject->mmapInput)
+        {
+            SetError(AVErrorString(ret));
+            return;
+        }
+
+        formatContextObject->fmt_ctx_ = avformat_alloc_context();
+        if (!formatContextObject->fmt_ctx_)
+        {
+            delete formatContextObject->mmapInput;
+            formatContextObject->mmapInput = nullptr;
+            SetError("Failed to allocate format context");
+            return;
+        }
+        formatContextObject->fmt_ctx_->pb = formatContextObject->mmapInput->avio_ctx;
+    }
+    else if (formatContextObject->pushInput)
+    {
+        formatContextObject->fmt_ctx_ = avformat_alloc_context();
+        if (!formatContextObject->fmt_ctx_)
+        {
+            SetError("Failed to allocate format context");
+            return;
+        }
+        formatContextObject->fmt_ctx_->pb = formatContextObject->pushInput->avio_ctx;
+    }
+    else
+    {
+        formatContextObject->fmt_ctx_ = avformat_alloc_context();
+        if (!formatContextObject->fmt_ctx_)
+        {
+            SetError("Failed to allocate format context");
+            return;
+        }
+    }
+
+    // lets abort, close and the deadline interrupt a stalled connection.
+    formatContextObject->fmt_ctx_->interrupt_callback.callback = AVFormatContextObject::InterruptCallback;
+    formatContextObject->fmt_ctx_->interrupt_callback.opaque = formatContextObject;
+    formatContextObject->ioDeadline = timeout ? av_gettime_relative() + timeout : 0;
+    ret = avformat_open_input(&formatContextObject->fmt_ctx_, filename.c_str(), inputFormat, &options);
+    formatContextObject->ioDeadline = 0;
+    if (ret == AVERROR_EXIT)
+    {
+        ret = formatContextObject->InterruptedError();
+    }
     if (ret < 0)
     {
+        // custom io is not freed by avformat_open_input on failure.
+        if (formatContextObject->mmapInput)
+        {
+            delete formatContextObject->mmapInput;
+            formatContextObject->mmapInput = nullptr;
+        }
         SetError(AVErrorString(ret));
         return;
     }
@@ -19,6 +89,10 @@ void OpenWorker::Execute()
         av_dict_free(&options);
     }
     formatContextObject->is_input = true;
+    if (readahead.maxPackets)
+    {
+        formatContextObject->readahead = new Readahead(formatContextObject->fmt_ctx_, readahead);
+    }
 }
 
 void OpenWorker::OnOK()
@@ -28,5 +102,12 @@ void OpenWorker::OnOK()
 
 void OpenWorker::OnError(const Napi::Error &e)
 {
+    // pushed buffers are referenced from js, so they can only be released here.
+    if (formatContextObject->pushInput)
+    {
+        formatContextObject->pushInput->ReleaseAll(Env());
+        delete formatContextObject->pushInput;
+        formatContextObject->pushInput = nullptr;
+    }
     napi_reject_deferred(Env(), deferred, e.Value());
 }
@@ -1,9 +1,11 @@
 #pragma once
 #include <napi.h>
+#include "../readahead.h"
 
 extern "C"
 {
 #include <libavutil/dict.h>
+#include <libavformat/avformat.h>
 }
 
 class AVFormatContextObject;
@@ -11,7 +13,7 @@ class AVFormatContextObject;
 class OpenWorker : public Napi::AsyncWorker
 {
 public:
-    OpenWorker(napi_env env, napi_deferred deferred, AVFormatContextObject *formatContextObject, const std::string &filename, AVDictionary* options);
+    OpenWorker(napi_env env, napi_deferred deferred, AVFormatContextObject *formatContextObject, const std::string &filename, AVDictionary* options, bool useMmap, const AVInputFormat *inputFormat = nullptr, int64_t timeout = 0, const Readahead::Limits &readahead = {});
     void Execute() override;
     void OnOK() override;
     void OnError(const Napi::Error &e) override;
@@ -21,4 +23,9 @@ private:
     AVFormatContextObject *formatContextObject;
     std::string filename;
     AVDictionary* options;
+    bool useMmap;
+    const AVInputFormat *inputFormat;
+    // microseconds, 0 for none.
+    int64_t timeout;
+    Readahead::Limits readahead;
 };
@@ -4,18 +4,15 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 }
-#include <map>
 #include "../formatcontext.h"
-#include "../codeccontext.h"
-#include "../filter.h"
+#include "../pipeline.h"
+#include "scheduled-worker.h"
 
-class ReadFrameWorker : public Napi::AsyncWorker {
+class ReadFrameWorker : public ScheduledWorker {
 public:
-    ReadFrameWorker(napi_env env, napi_deferred deferred, AVFormatContextObject *formatContextObject, 
-                    const std::map<int, AVCodecContextObject*>& decoders,
-                    const std::map<int, AVFilterGraphObject*>& filters,
-                    const std::map<int, AVCodecContextObject*>& encoders,
-                    const std::map<int, AVFormatContextObject*>& writeFormatContexts);
+    ReadFrameWorker(napi_env env, napi_deferred deferred, AVFormatContextObject *formatContextObject,
+                    const Pipeline &pipeline, int64_t timeout, JobScheduler::Priority priority);
+    ~ReadFrameWorker();
     void Execute() override;
     void OnOK() override;
     void OnError(const Napi::Error &e) override;
@@ -23,12 +20,8 @@ public:
 private:
     napi_deferred deferred;
     AVFormatContextObject *formatContextObject;
-    std::map<int, AVCodecContextObject*> decoders;
-    std::map<int, AVFilterGraphObject*> filters;
-    std::map<int, AVCodecContextObject*> encoders;
-    std::map<int, AVFormatContextObject*> writeFormatContexts; // New property for write contexts
-    AVPacket *packetResult;
-    int packetInputStreamIndex;
-    AVFrame *frameResult;
-    int frameStreamIndex; // Track which stream the frame came from
+    Pipeline pipeline;
+    // microseconds a read may block, 0 for none.
+    int64_t timeout;
+    PipelineResult result;
 };
@@ -4,7 +4,7 @@
 #include "../av-pointer.h"
 
 ReceiveFrameWorker::ReceiveFrameWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext)
-    : Napi::AsyncWorker(env), result(nullptr), deferred(deferred), codecContext(codecContext)
+    : ScheduledWorker(env, codecContext->priority, &codecContext->executor), result(nullptr), deferred(deferred), codecContext(codecContext)
 {
 }
 
@@ -19,6 +19,11 @@ void ReceiveFrameWorker::Execute() {
 
     //  EAGAIN will be returned if packets need to be sent to decoder.
     int ret = avcodec_receive_frame(codecContext->codecContext, frame.get());
+    // frames dropped by the output rate policy are skipped, EAGAIN then asks for more packets.
+    while (!ret && !codecContext->AcceptFrame(frame.get())) {
+        av_frame_unref(frame.get());
+        ret = avcodec_receive_frame(codecContext->codecContext, frame.get());
+    }
     if (!ret) {
         result = frame.release();
         return;
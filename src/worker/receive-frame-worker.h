@@ -1,8 +1,9 @@
 #pragma once
 #include <napi.h>
 #include "../codeccontext.h"
+#include "scheduled-worker.h"
 
-class ReceiveFrameWorker : public Napi::AsyncWorker {
+class ReceiveFrameWorker : public ScheduledWorker {
 public:
     ReceiveFrameWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext);
     void Execute() override;
@@ -2,8 +2,8 @@
 #include "../error.h"
 #include "../av-pointer.h"
 
-ReceivePacketWorker::ReceivePacketWorker(napi_env env, napi_deferred deferred, AVCodecContext *codecContext)
-    : Napi::AsyncWorker(env), result(nullptr), deferred(deferred), codecContext(codecContext)
+ReceivePacketWorker::ReceivePacketWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext)
+    : ScheduledWorker(env, codecContext->priority, &codecContext->executor), result(nullptr), deferred(deferred), codecContext(codecContext)
 {
 }
 
@@ -16,8 +16,13 @@ void ReceivePacketWorker::Execute() {
         return;
     }
 
+    if (!codecContext->codecContext) {
+        SetError("Codec Context is null");
+        return;
+    }
+
     // EAGAIN will be returned if frames needs to be sent to encoder
-    int ret = avcodec_receive_packet(codecContext, packet.get());
+    int ret = avcodec_receive_packet(codecContext->codecContext, packet.get());
     if (!ret) {
         result = packet.release();
         return;
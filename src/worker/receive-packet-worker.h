@@ -4,10 +4,12 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 #include "../packet.h"
+#include "../codeccontext.h"
+#include "scheduled-worker.h"
 
-class ReceivePacketWorker : public Napi::AsyncWorker {
+class ReceivePacketWorker : public ScheduledWorker {
 public:
-    ReceivePacketWorker(napi_env env, napi_deferred deferred, AVCodecContext *codecContext);
+    ReceivePacketWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext);
     void Execute() override;
     void OnOK() override;
     void OnError(const Napi::Error &e) override;
@@ -15,5 +17,5 @@ public:
 private:
     AVPacket *result;
     napi_deferred deferred;
-    AVCodecContext *codecContext;
+    AVCodecContextObject *codecContext;
 };
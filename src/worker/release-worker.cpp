@@ -0,0 +1,11 @@
+#include "release-worker.h"
+
+ReleaseWorker::ReleaseWorker(napi_env env, AVCodecContextObject *codecContext)
+    : ScheduledWorker(env, codecContext->priority, &codecContext->executor), codecContext(codecContext),
+      codecContextRef(Napi::Persistent(codecContext->Value()))
+{
+}
+
+void ReleaseWorker::Execute() {
+    codecContext->ReleaseContext();
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <napi.h>
+#include "../codeccontext.h"
+#include "scheduled-worker.h"
+
+// Queued by destroy behind the pending calls of a codec, so the context is
+// only returned to the pool or freed once nothing uses it anymore.
+class ReleaseWorker : public ScheduledWorker {
+public:
+    ReleaseWorker(napi_env env, AVCodecContextObject *codecContext);
+    void Execute() override;
+
+private:
+    AVCodecContextObject *codecContext;
+    // keeps the codec object alive until the release ran.
+    Napi::ObjectReference codecContextRef;
+};
@@ -0,0 +1,174 @@
+#include "scheduled-worker.h"
+
+extern "C" {
+#include <libavutil/time.h>
+}
+
+#include <algorithm>
+#include <cstdlib>
+
+// libuv's default, unless UV_THREADPOOL_SIZE is set before the pool starts.
+static int threadPoolSize() {
+    const char *size = getenv("UV_THREADPOOL_SIZE");
+    int value = size ? atoi(size) : 0;
+    return value > 0 ? value : 4;
+}
+
+int JobScheduler::poolSize = threadPoolSize();
+JobScheduler::PriorityClass JobScheduler::classes[JobScheduler::PRIORITY_COUNT] = {
+    {JobScheduler::poolSize, 0, {}, 0, 0, 0},
+    {1, 0, {}, 0, 0, 0},
+};
+
+void JobScheduler::Init(Napi::Env env, Napi::Object exports) {
+    exports.Set(Napi::String::New(env, "setSchedulerLimits"), Napi::Function::New(env, SetLimits));
+    exports.Set(Napi::String::New(env, "getSchedulerStats"), Napi::Function::New(env, GetStats));
+}
+
+const char *JobScheduler::PriorityName(Priority priority) {
+    return priority == PRIORITY_BACKGROUND ? "background" : "live";
+}
+
+bool JobScheduler::ParsePriority(Napi::Env env, Napi::Value value, Priority *priority) {
+    std::string name = value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+    if (name == "live") {
+        *priority = PRIORITY_LIVE;
+        return true;
+    }
+    if (name == "background") {
+        *priority = PRIORITY_BACKGROUND;
+        return true;
+    }
+    Napi::TypeError::New(env, "priority must be live or background").ThrowAsJavaScriptException();
+    return false;
+}
+
+bool JobScheduler::CanRun(Priority priority) {
+    PriorityClass &live = classes[PRIORITY_LIVE];
+    PriorityClass &background = classes[PRIORITY_BACKGROUND];
+    if (priority == PRIORITY_LIVE) {
+        return live.running < live.limit;
+    }
+    // a live worker that shows up later still finds a free pool thread.
+    return background.running < background.limit && live.waiting.empty() && live.running + background.running < poolSize - 1;
+}
+
+void JobScheduler::Submit(ScheduledWorker *worker) {
+    worker->submitted = av_gettime_relative();
+    classes[worker->priority].waiting.push_back(worker);
+    Dispatch();
+}
+
+void JobScheduler::Finished(ScheduledWorker *worker) {
+    PriorityClass &priorityClass = classes[worker->priority];
+    priorityClass.running--;
+    priorityClass.completed++;
+    Dispatch();
+}
+
+void JobScheduler::Dispatch() {
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        Priority priority = (Priority)i;
+        PriorityClass &priorityClass = classes[priority];
+        while (!priorityClass.waiting.empty() && CanRun(priority)) {
+            ScheduledWorker *worker = priorityClass.waiting.front();
+            priorityClass.waiting.pop_front();
+            int64_t wait = av_gettime_relative() - worker->submitted;
+            priorityClass.totalWait += wait;
+            priorityClass.maxWait = std::max(priorityClass.maxWait, wait);
+            priorityClass.running++;
+            worker->Napi::AsyncWorker::Queue();
+        }
+    }
+}
+
+Napi::Value JobScheduler::SetLimits(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Object expected for argument 0: limits").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object limits = info[0].As<Napi::Object>();
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        Napi::Value limit = limits.Get(PriorityName((Priority)i));
+        if (limit.IsNumber()) {
+            classes[i].limit = std::max(1, limit.As<Napi::Number>().Int32Value());
+        }
+    }
+    // the pool size can't be read back from libuv, ie it was set from within the process.
+    if (limits.Get("poolSize").IsNumber()) {
+        poolSize = std::max(2, limits.Get("poolSize").As<Napi::Number>().Int32Value());
+    }
+    Dispatch();
+    return env.Undefined();
+}
+
+Napi::Value JobScheduler::GetStats(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("poolSize", Napi::Number::New(env, poolSize));
+    for (int i = 0; i < PRIORITY_COUNT; i++) {
+        PriorityClass &priorityClass = classes[i];
+        uint64_t admitted = priorityClass.completed + priorityClass.running;
+        Napi::Object s = Napi::Object::New(env);
+        s.Set("limit", Napi::Number::New(env, priorityClass.limit));
+        s.Set("running", Napi::Number::New(env, priorityClass.running));
+        s.Set("waiting", Napi::Number::New(env, priorityClass.waiting.size()));
+        s.Set("completed", Napi::Number::New(env, priorityClass.completed));
+        s.Set("averageWait", Napi::Number::New(env, admitted ? (double)priorityClass.totalWait / admitted / 1000 : 0));
+        s.Set("maxWait", Napi::Number::New(env, (double)priorityClass.maxWait / 1000));
+        stats.Set(PriorityName((Priority)i), s);
+    }
+    return stats;
+}
+
+SerialExecutor::SerialExecutor()
+    : running(false) {
+}
+
+void SerialExecutor::Submit(ScheduledWorker *worker) {
+    if (running) {
+        queue.push_back(worker);
+        return;
+    }
+    running = true;
+    JobScheduler::Submit(worker);
+}
+
+void SerialExecutor::Finished() {
+    if (queue.empty()) {
+        running = false;
+        return;
+    }
+    ScheduledWorker *next = queue.front();
+    queue.pop_front();
+    JobScheduler::Submit(next);
+}
+
+bool SerialExecutor::Idle() const {
+    return !running;
+}
+
+ScheduledWorker::ScheduledWorker(napi_env env, JobScheduler::Priority priority, SerialExecutor *executor)
+    : Napi::AsyncWorker(env), priority(priority), executor(executor), submitted(0) {
+}
+
+void ScheduledWorker::Queue() {
+    if (executor) {
+        executor->Submit(this);
+    }
+    else {
+        JobScheduler::Submit(this);
+    }
+}
+
+void ScheduledWorker::Destroy() {
+    SerialExecutor *serialExecutor = executor;
+    JobScheduler::Finished(this);
+    Napi::AsyncWorker::Destroy();
+    // the next call of the context starts once this one has resolved.
+    if (serialExecutor) {
+        serialExecutor->Finished();
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <napi.h>
+#include <cstdint>
+#include <deque>
+
+class ScheduledWorker;
+
+// Admits async workers to the libuv pool by priority class, so bulk work like
+// exports and timelapses can't crowd out live pipelines. Live workers are
+// queued immediately up to the live limit. Background workers wait while live
+// workers are waiting, are capped by the background limit, and never take the
+// last pool thread that is not running live work. Each call of a pipeline is one
+// worker, so background pipelines yield between frames.
+// js thread only.
+class JobScheduler {
+public:
+    enum Priority {
+        PRIORITY_LIVE,
+        PRIORITY_BACKGROUND,
+        PRIORITY_COUNT,
+    };
+
+    static void Init(Napi::Env env, Napi::Object exports);
+    static void Submit(ScheduledWorker *worker);
+    static void Finished(ScheduledWorker *worker);
+    // throws and returns false if the value is not live or background.
+    static bool ParsePriority(Napi::Env env, Napi::Value value, Priority *priority);
+    static const char *PriorityName(Priority priority);
+
+private:
+    struct PriorityClass {
+        int limit;
+        int running;
+        std::deque<ScheduledWorker *> waiting;
+        uint64_t completed;
+        // microseconds spent waiting for admission.
+        int64_t totalWait;
+        int64_t maxWait;
+    };
+
+    static bool CanRun(Priority priority);
+    static void Dispatch();
+    static Napi::Value SetLimits(const Napi::CallbackInfo &info);
+    static Napi::Value GetStats(const Napi::CallbackInfo &info);
+
+    static int poolSize;
+    static PriorityClass classes[PRIORITY_COUNT];
+};
+
+// Runs the workers of one context one at a time, in the order they were
+// queued, so js can issue sendPacket, receiveFrame, receiveFrame without
+// awaiting each call. A failed call doesn't stop the ones after it.
+// js thread only.
+class SerialExecutor {
+public:
+    SerialExecutor();
+    void Submit(ScheduledWorker *worker);
+    void Finished();
+    // no worker is running or queued.
+    bool Idle() const;
+
+private:
+    std::deque<ScheduledWorker *> queue;
+    bool running;
+};
+
+// An async worker that is admitted by the job scheduler rather than queued
+// straight to the libuv pool, after the earlier workers of its executor, if any.
+class ScheduledWorker : public Napi::AsyncWorker {
+public:
+    ScheduledWorker(napi_env env, JobScheduler::Priority priority, SerialExecutor *executor = nullptr);
+    void Queue();
+
+protected:
+    void Destroy() override;
+
+private:
+    friend class JobScheduler;
+    JobScheduler::Priority priority;
+    SerialExecutor *executor;
+    int64_t submitted;
+};
@@ -2,14 +2,20 @@
 #include "../error.h"
 
 SendFrameWorker::SendFrameWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext, AVFrameObject *frame)
-    : Napi::AsyncWorker(env), result(false), deferred(deferred), codecContext(codecContext), frame(frame)
+    : ScheduledWorker(env, codecContext->priority, &codecContext->executor), result(false), deferred(deferred), codecContext(codecContext),
+      frame(frame && frame->frame_ ? av_frame_clone(frame->frame_) : nullptr)
 {
 }
 
+SendFrameWorker::~SendFrameWorker()
+{
+    av_frame_free(&frame);
+}
+
 void SendFrameWorker::Execute() {
     result = false;
 
-    if (!frame || !frame->frame_) {
+    if (!frame) {
         SetError("SendFrame received null frame");
         return;
     }
@@ -18,7 +24,7 @@ void SendFrameWorker::Execute() {
         return;
     }
 
-    int ret = avcodec_send_frame(codecContext->codecContext, frame->frame_);
+    int ret = codecContext->EncodeFrame(frame);
 
     if (!ret) {
         result = true;
@@ -5,10 +5,13 @@ extern "C" {
 }
 #include "../frame.h"
 #include "../codeccontext.h"
+#include "scheduled-worker.h"
 
-class SendFrameWorker : public Napi::AsyncWorker {
+class SendFrameWorker : public ScheduledWorker {
 public:
+    // references the frame now, js may reuse or destroy it before the worker runs.
     SendFrameWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext, AVFrameObject *frame);
+    ~SendFrameWorker();
     void Execute() override;
     void OnOK() override;
     void OnError(const Napi::Error &e) override;
@@ -17,5 +20,5 @@ private:
     bool result;
     napi_deferred deferred;
     AVCodecContextObject *codecContext;
-    AVFrameObject *frame;
+    AVFrame *frame;
 };
@@ -2,19 +2,25 @@
 #include "../error.h"
 
 SendPacketWorker::SendPacketWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext, AVPacketObject *packet)
-    : Napi::AsyncWorker(env), result(false), deferred(deferred), codecContext(codecContext), packet(packet)
+    : ScheduledWorker(env, codecContext->priority, &codecContext->executor), result(false), deferred(deferred), codecContext(codecContext),
+      packet(packet && packet->packet ? av_packet_clone(packet->packet) : nullptr)
 {
 }
 
+SendPacketWorker::~SendPacketWorker()
+{
+    av_packet_free(&packet);
+}
+
 void SendPacketWorker::Execute() {
     result = false;
 
-    if (!packet || !packet->packet) {
+    if (!packet) {
         SetError("SendPacket received null packet");
         return;
     }
 
-    int ret = avcodec_send_packet(codecContext->codecContext, packet->packet);
+    int ret = codecContext->DecodePacket(packet);
 
     if (!ret) {
         result = true;
@@ -5,10 +5,13 @@ extern "C" {
 }
 #include "../packet.h"
 #include "../codeccontext.h"
+#include "scheduled-worker.h"
 
-class SendPacketWorker : public Napi::AsyncWorker {
+class SendPacketWorker : public ScheduledWorker {
 public:
+    // references the packet now, js may reuse or destroy it before the worker runs.
     SendPacketWorker(napi_env env, napi_deferred deferred, AVCodecContextObject *codecContext, AVPacketObject *packet);
+    ~SendPacketWorker();
     void Execute() override;
     void OnOK() override;
     void OnError(const Napi::Error &e) override;
@@ -17,5 +20,5 @@ private:
     bool result;
     napi_deferred deferred;
     AVCodecContextObject *codecContext;
-    AVPacketObject *packet;
+    AVPacket *packet;
 };
@@ -0,0 +1,103 @@
+#include "snapshot-worker.h"
+#include "../error.h"
+#include "../frame.h"
+#include "../av-pointer.h"
+
+SnapshotWorker::SnapshotWorker(napi_env env, napi_deferred deferred, std::mutex &decoderMutex,
+                               Napi::Object owner, Napi::Object decoder, std::vector<AVPacket *> packets)
+    : ScheduledWorker(env, Napi::ObjectWrap<AVCodecContextObject>::Unwrap(decoder)->priority,
+                      &Napi::ObjectWrap<AVCodecContextObject>::Unwrap(decoder)->executor), deferred(deferred), decoderMutex(decoderMutex),
+      ownerRef(Napi::Persistent(owner)), decoderRef(Napi::Persistent(decoder)),
+      decoder(Napi::ObjectWrap<AVCodecContextObject>::Unwrap(decoder)),
+      packets(packets), result(nullptr)
+{
+}
+
+SnapshotWorker::~SnapshotWorker()
+{
+    for (AVPacket *packet : packets) {
+        av_packet_free(&packet);
+    }
+    av_frame_free(&result);
+}
+
+// keeps the newest frame in result.
+int SnapshotWorker::ReceiveFrames(AVCodecContext *codecContext, AVFrame *frame)
+{
+    while (true) {
+        int ret = avcodec_receive_frame(codecContext, frame);
+        if (ret) {
+            return ret;
+        }
+        av_frame_unref(result);
+        av_frame_move_ref(result, frame);
+    }
+}
+
+void SnapshotWorker::Execute() {
+    std::lock_guard<std::mutex> lock(decoderMutex);
+
+    AVCodecContext *codecContext = decoder->codecContext;
+    if (!codecContext) {
+        SetError("Decoder is closed");
+        return;
+    }
+
+    FreePointer<AVFrame, av_frame_free> frame(av_frame_alloc());
+    result = av_frame_alloc();
+    if (!frame.get() || !result) {
+        SetError("Failed to allocate frame");
+        return;
+    }
+
+    // the decoder may have been left mid stream or drained by a previous snapshot.
+    avcodec_flush_buffers(codecContext);
+
+    // only the last frame is returned, so frames nothing else references can be skipped.
+    // the policy is applied first, so the value restored below is the one the decoder runs with.
+    decoder->ApplySkipFrame();
+    enum AVDiscard skipFrame = codecContext->skip_frame;
+    int ret;
+    for (size_t i = 0; i < packets.size(); i++) {
+        codecContext->skip_frame = i + 1 < packets.size() ? AVDISCARD_NONREF : skipFrame;
+        ret = avcodec_send_packet(codecContext, packets[i]);
+        if (ret == AVERROR(EAGAIN)) {
+            ReceiveFrames(codecContext, frame.get());
+            ret = avcodec_send_packet(codecContext, packets[i]);
+        }
+        // a corrupt packet shouldn't fail the snapshot, the decoder conceals it.
+        ReceiveFrames(codecContext, frame.get());
+    }
+    codecContext->skip_frame = skipFrame;
+
+    ret = avcodec_send_packet(codecContext, nullptr);
+    if (!ret) {
+        ret = ReceiveFrames(codecContext, frame.get());
+    }
+    avcodec_flush_buffers(codecContext);
+
+    if (ret != AVERROR_EOF && ret < 0) {
+        SetError(AVErrorString(ret));
+        return;
+    }
+    if (!result->buf[0]) {
+        av_frame_free(&result);
+    }
+}
+
+void SnapshotWorker::OnOK() {
+    Napi::Env env = Env();
+    if (!result) {
+        napi_resolve_deferred(Env(), deferred, env.Undefined());
+        return;
+    }
+
+    AVFrame *frame = result;
+    result = nullptr;
+    napi_resolve_deferred(Env(), deferred, AVFrameObject::NewInstance(env, frame));
+}
+
+void SnapshotWorker::OnError(const Napi::Error &e) {
+    napi_value error = e.Value();
+    napi_reject_deferred(Env(), deferred, error);
+}
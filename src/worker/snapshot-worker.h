@@ -0,0 +1,33 @@
+#pragma once
+#include <napi.h>
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+#include <mutex>
+#include <vector>
+#include "../codeccontext.h"
+#include "scheduled-worker.h"
+
+// Decodes a cached gop with an otherwise idle decoder and resolves with its newest frame,
+// so a stream can serve snapshots without decoding continuously.
+class SnapshotWorker : public ScheduledWorker {
+public:
+    // takes ownership of the packets. the lock serializes use of the decoder.
+    SnapshotWorker(napi_env env, napi_deferred deferred, std::mutex &decoderMutex,
+                   Napi::Object owner, Napi::Object decoder, std::vector<AVPacket*> packets);
+    ~SnapshotWorker();
+    void Execute() override;
+    void OnOK() override;
+    void OnError(const Napi::Error &e) override;
+
+private:
+    int ReceiveFrames(AVCodecContext *codecContext, AVFrame *frame);
+    napi_deferred deferred;
+    std::mutex &decoderMutex;
+    // keep the decoder and the mutex owner alive while decoding.
+    Napi::ObjectReference ownerRef;
+    Napi::ObjectReference decoderRef;
+    AVCodecContextObject *decoder;
+    std::vector<AVPacket*> packets;
+    AVFrame *result;
+};
@@ -0,0 +1,109 @@
+import assert from 'assert';
+import { AVPacket, createAVBroadcaster, createAVFormatContext, toJpeg } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/broadcaster-test.ts
+// broadcasts a clip with a keyframe every 10 frames and checks that a late
+// subscriber starts at the most recent keyframe, and that a subscriber with a
+// small queue resumes at a keyframe after dropping. also snapshots the cached
+// gop with an otherwise idle decoder, and closes a muxer while it is
+// subscribed.
+async function settle() {
+    await new Promise(resolve => setTimeout(resolve, 100));
+}
+
+async function main() {
+    const input = generateClip('broadcaster-test', { rate: 10, args: ['-g', '10'] });
+
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+
+    using broadcaster = createAVBroadcaster({ keyframeStreamIndex: video.index });
+
+    const packets: AVPacket[] = [];
+    await readPackets(readContext, packet => {
+        if (packet.streamIndex === video.index)
+            packets.push(packet);
+        else
+            packet.destroy();
+    });
+
+    const isKeyframe = (p: AVPacket) => !!(p.flags & 1);
+    assert.ok(isKeyframe(packets[0]) && isKeyframe(packets[10]), 'unexpected gop structure');
+
+    for (let i = 0; i < 15; i++)
+        broadcaster.write(packets[i]);
+
+    const late: { pts: number, keyframe: boolean }[] = [];
+    const lateId = broadcaster.subscribe({
+        callback: packet => {
+            late.push({ pts: packet.pts, keyframe: isKeyframe(packet) });
+            packet.destroy();
+        },
+    });
+    await settle();
+    assert.strictEqual(late.length, 5, 'late subscriber did not join at the last keyframe');
+    assert.ok(late[0].keyframe);
+    assert.strictEqual(late[0].pts, packets[10].pts);
+
+    using decoder = readContext.createDecoder(video.index);
+    for (let i = 0; i < 2; i++) {
+        const start = process.hrtime.bigint();
+        using snapshot = await broadcaster.snapshot(decoder);
+        const ms = Number(process.hrtime.bigint() - start) / 1e6;
+        assert.ok(snapshot, 'no snapshot');
+        assert.strictEqual(snapshot.pts, packets[14].pts, 'snapshot is not the newest frame');
+        const jpeg = await toJpeg(snapshot, 5);
+        console.log(`snapshot ${ms.toFixed(1)}ms, jpeg ${jpeg.length} bytes`);
+    }
+
+    // a queue smaller than a gop overflows when js doesn't get to run.
+    let slowReceived = 0;
+    const slowId = broadcaster.subscribe({
+        callback: packet => {
+            if (!slowReceived)
+                assert.ok(isKeyframe(packet), 'slow subscriber did not resume at a keyframe');
+            slowReceived++;
+            packet.destroy();
+        },
+        queueSize: 4,
+    });
+    for (let i = 15; i < packets.length; i++)
+        broadcaster.write(packets[i]);
+    await settle();
+
+    const stats = broadcaster.getStats();
+    console.log(stats);
+    assert.strictEqual(late.length, packets.length - 10);
+    const slow = stats.subscribers.find(s => s.id === slowId)!;
+    assert.ok(slow.dropped > 0, 'slow subscriber did not drop');
+    assert.strictEqual(slow.sent, slowReceived);
+
+    assert.ok(broadcaster.unsubscribe(lateId));
+    assert.ok(!broadcaster.unsubscribe(lateId));
+
+    // the subscriber thread keeps writing while the output is closed.
+    const writeContext = createAVFormatContext();
+    writeContext.create('matroska', () => { });
+    const writeStream = writeContext.addStream({ formatContext: readContext, streamIndex: video.index });
+    writeContext.writeHeader();
+    const muxerId = broadcaster.subscribe({ formatContext: writeContext, streamMap: { [video.index]: writeStream } });
+    const half = packets.length >> 1;
+    for (let i = 0; i < half; i++)
+        broadcaster.write(packets[i]);
+    await writeContext.close();
+    for (let i = half; i < packets.length; i++)
+        broadcaster.write(packets[i]);
+    await settle();
+    const muxer = broadcaster.getStats().subscribers.find(s => s.id === muxerId)!;
+    console.log('closed muxer', muxer);
+    assert.ok(muxer.errors > 0, 'writes to a closed output did not fail');
+    assert.ok(broadcaster.unsubscribe(muxerId));
+
+    for (const packet of packets)
+        packet.destroy();
+    removeClip(input);
+}
+
+main();
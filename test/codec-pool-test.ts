@@ -0,0 +1,87 @@
+import assert from 'assert';
+import { createAVFormatContext, getCodecPoolStats, setCodecPoolLimits } from '../src';
+import { generateClip, removeClip } from './fixture';
+
+// usage: ts-node test/codec-pool-test.ts
+// decodes the start of a clip several times with the codec pool enabled, and
+// checks that later decoders come from the pool, decode the same frames as a
+// fresh one, and are freed once idle. then checks that a decoder used by a
+// pipeline can't be destroyed, and that one destroyed with a call pending is
+// pooled once the call is done.
+async function decodeStart(input: string) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    const start = Date.now();
+    using decoder = readContext.createDecoder(video.index);
+    const createTime = Date.now() - start;
+
+    const pts: number[] = [];
+    while (pts.length < 10) {
+        const packet = await readContext.readFrame();
+        if (!packet)
+            continue;
+        if (packet.streamIndex === video.index) {
+            for (const frame of await decoder.decode(packet)) {
+                pts.push(frame.pts);
+                frame.destroy();
+            }
+        }
+        packet.destroy();
+    }
+    return { pts, createTime };
+}
+
+async function main() {
+    const input = generateClip('codec-pool-test', { size: '1280x720', duration: 2 });
+
+    setCodecPoolLimits({ capacity: 2, idleTimeout: 1 });
+
+    const fresh = await decodeStart(input);
+    assert.ok(fresh.pts.length > 0, 'no frames decoded');
+    for (let i = 0; i < 3; i++) {
+        const pooled = await decodeStart(input);
+        console.log(`create ${pooled.createTime}ms (fresh ${fresh.createTime}ms)`);
+        assert.deepStrictEqual(pooled.pts, fresh.pts, 'pooled decoder frames differ');
+    }
+
+    let stats = getCodecPoolStats();
+    console.log(stats);
+    assert.strictEqual(stats.misses, 1);
+    assert.strictEqual(stats.hits, 3);
+    assert.strictEqual(stats.idle, 1);
+
+    await new Promise(resolve => setTimeout(resolve, 1500));
+    stats = getCodecPoolStats();
+    assert.strictEqual(stats.idle, 0, 'idle decoder was not evicted');
+    assert.strictEqual(stats.evictions, 1);
+
+    {
+        await using readContext = createAVFormatContext();
+        await readContext.open(input);
+        const video = readContext.streams.find(s => s.type === 'video')!;
+        const decoder = readContext.createDecoder(video.index);
+        const received = readContext.receiveFrame([{ streamIndex: video.index, decoder }]);
+        assert.throws(() => decoder.destroy(), /in use by a pipeline/);
+        (await received)?.destroy();
+
+        let packet = await readContext.readFrame();
+        while (!packet || packet.streamIndex !== video.index) {
+            packet?.destroy();
+            packet = await readContext.readFrame();
+        }
+        const decoded = decoder.decode(packet);
+        decoder.destroy();
+        packet.destroy();
+        for (const frame of await decoded)
+            frame.destroy();
+    }
+    for (let i = 0; i < 100 && !getCodecPoolStats().idle; i++)
+        await new Promise(resolve => setTimeout(resolve, 10));
+    assert.strictEqual(getCodecPoolStats().idle, 1, 'decoder destroyed during a call was not pooled');
+
+    setCodecPoolLimits({ capacity: 0 });
+    removeClip(input);
+}
+
+main();
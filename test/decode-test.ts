@@ -0,0 +1,66 @@
+import assert from 'assert';
+import { createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/decode-test.ts
+// decodes a clip with B-frames through decode and flush, and checks that it
+// gets the same frames in the same order as sendPacket and receiveFrame.
+async function decode(input: string, combined: boolean) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    using decoder = readContext.createDecoder(video.index);
+
+    const pts: number[] = [];
+    await readPackets(readContext, async packet => {
+        if (packet.streamIndex !== video.index) {
+            packet.destroy();
+            return;
+        }
+
+        if (combined) {
+            for (const frame of await decoder.decode(packet)) {
+                pts.push(frame.pts);
+                frame.destroy();
+            }
+        }
+        else {
+            await decoder.sendPacket(packet);
+            while (true) {
+                const frame = await decoder.receiveFrame();
+                if (!frame)
+                    break;
+                pts.push(frame.pts);
+                frame.destroy();
+            }
+        }
+        packet.destroy();
+    });
+
+    // the reordered frames still in the decoder.
+    const flushed = await decoder.flush();
+    for (const frame of flushed) {
+        pts.push(frame.pts);
+        frame.destroy();
+    }
+    return { pts, flushed: flushed.length };
+}
+
+async function main() {
+    const input = generateClip('decode-test', { size: '1280x720', args: ['-bf', '2'] });
+
+    let start = Date.now();
+    const separate = await decode(input, false);
+    console.log(`sendPacket/receiveFrame ${Date.now() - start}ms`, separate.pts.length);
+    start = Date.now();
+    const combined = await decode(input, true);
+    console.log(`decode ${Date.now() - start}ms`, combined.pts.length, 'flushed', combined.flushed);
+
+    assert.strictEqual(combined.pts.length, 120, 'frames missing');
+    assert.ok(combined.flushed > 0, 'flush received no frames');
+    assert.deepStrictEqual(combined.pts, separate.pts, 'decode frames differ');
+
+    removeClip(input);
+}
+
+main();
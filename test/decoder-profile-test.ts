@@ -0,0 +1,59 @@
+import assert from 'assert';
+import os from 'os';
+import { AVDecoderProfile, createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/decoder-profile-test.ts
+// decodes a clip with each decoder profile, checks that every profile decodes
+// the same frames with the threading it asked for, and prints the decode
+// latency and time of each.
+async function decode(input: string, profile: AVDecoderProfile) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    using decoder = readContext.createDecoder(video.index, { profile });
+
+    const start = Date.now();
+    const pts: number[] = [];
+    await readPackets(readContext, async packet => {
+        if (packet.streamIndex === video.index) {
+            for (const frame of await decoder.decode(packet)) {
+                pts.push(frame.pts);
+                frame.destroy();
+            }
+        }
+        packet.destroy();
+    });
+    for (const frame of await decoder.flush()) {
+        pts.push(frame.pts);
+        frame.destroy();
+    }
+
+    const stats = decoder.getDecodeStats()!;
+    console.log(profile, `${Date.now() - start}ms`, stats);
+    return { pts, stats };
+}
+
+async function main() {
+    const input = generateClip('decoder-profile-test', { size: '1920x1080', args: ['-bf', '2'] });
+
+    const lowLatency = await decode(input, 'lowLatency');
+    const throughput = await decode(input, 'throughput');
+    const economy = await decode(input, 'economy');
+
+    assert.strictEqual(lowLatency.pts.length, 120, 'frames missing');
+    assert.deepStrictEqual(throughput.pts, lowLatency.pts, 'throughput frames differ');
+    assert.deepStrictEqual(economy.pts, lowLatency.pts, 'economy frames differ');
+
+    assert.strictEqual(economy.stats.profile, 'economy');
+    assert.strictEqual(economy.stats.threads, 1);
+    assert.strictEqual(economy.stats.threadType, 'none');
+    if (os.cpus().length > 1)
+        assert.strictEqual(throughput.stats.threadType, 'frame');
+    for (const { stats } of [lowLatency, throughput, economy])
+        assert.ok(stats.frames > 0 && stats.averageLatency > 0, 'no decode latency measured');
+
+    removeClip(input);
+}
+
+main();
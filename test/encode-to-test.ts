@@ -0,0 +1,97 @@
+import assert from 'assert';
+import fs from 'fs';
+import os from 'os';
+import path from 'path';
+import { AVCodecContext, AVFrame, createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/encode-to-test.ts
+// transcodes a clip to matroska with encodeTo in batches of frames, then
+// reads the output back and checks that every frame was written, and that
+// the reported counts and keyframes match what was muxed. also checks that an
+// empty batch doesn't drain the encoder and that bad write targets are rejected.
+async function main() {
+    const input = generateClip('encode-to-test');
+    const output = path.join(os.tmpdir(), `encode-to-test-${process.pid}-out.mkv`);
+
+    const chunks: Buffer[] = [];
+    {
+        await using readContext = createAVFormatContext();
+        await readContext.open(input);
+        const video = readContext.streams.find(s => s.type === 'video')!;
+        using decoder = readContext.createDecoder(video.index);
+
+        await using writeContext = createAVFormatContext();
+        writeContext.create('matroska', buffer => chunks.push(buffer));
+        let encoder: AVCodecContext | undefined;
+        let writeStream = 0;
+
+        let packets = 0;
+        let bytes = 0;
+        let keyframes = 0;
+        const encode = async (frames: AVFrame[] | null) => {
+            const result = await encoder!.encodeTo(frames, writeContext, writeStream);
+            assert.strictEqual(result.keyframes.length, result.packets);
+            packets += result.packets;
+            bytes += result.bytes;
+            keyframes += result.keyframes.filter(k => k).length;
+        };
+
+        let batch: AVFrame[] = [];
+        await readPackets(readContext, async packet => {
+            const frames = packet.streamIndex === video.index ? await decoder.decode(packet) : [];
+            packet.destroy();
+
+            for (const frame of frames) {
+                if (!encoder) {
+                    encoder = frame.createEncoder({
+                        encoder: 'mpeg4',
+                        bitrate: 1000000,
+                        timeBase: video,
+                    });
+                    writeStream = writeContext.addStream({ codecContext: encoder });
+                    await assert.rejects(async () => encoder!.encodeTo([], writeContext, writeStream), /header written/);
+                    writeContext.writeHeader();
+                    await assert.rejects(async () => encoder!.encodeTo([], writeContext, writeStream + 1), /invalid stream index/i);
+                    await assert.rejects(async () => encoder!.encodeTo([], readContext, 0), /header written/);
+                    const empty = await encoder.encodeTo([], writeContext, writeStream);
+                    assert.strictEqual(empty.packets, 0);
+                }
+                batch.push(frame);
+            }
+            if (batch.length >= 8) {
+                // the batch is referenced by encodeTo, the frames can go right away.
+                const sent = encode(batch);
+                batch.forEach(f => f.destroy());
+                batch = [];
+                await sent;
+            }
+        });
+        for (const frame of await decoder.flush())
+            batch.push(frame);
+        await encode(batch);
+        batch.forEach(f => f.destroy());
+        await encode(null);
+        writeContext.writeTrailer();
+        encoder!.destroy();
+
+        console.log('encodeTo', packets, 'packets', bytes, 'bytes', keyframes, 'keyframes');
+        assert.strictEqual(packets, 120, 'packets missing');
+        assert.ok(keyframes > 0, 'no keyframes');
+    }
+
+    fs.writeFileSync(output, Buffer.concat(chunks));
+    await using verifyContext = createAVFormatContext();
+    await verifyContext.open(output);
+    let muxed = 0;
+    await readPackets(verifyContext, packet => {
+        muxed++;
+        packet.destroy();
+    });
+    assert.strictEqual(muxed, 120, 'muxed packets missing');
+
+    removeClip(input);
+    removeClip(output);
+}
+
+main();
@@ -0,0 +1,64 @@
+import assert from 'assert';
+import { AVCodecContext, createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/encoder-reconfigure-test.ts
+// encodes a clip with a long gop, requests a keyframe partway through and
+// checks where the keyframes land. mpeg4 can only change its bitrate by being
+// reopened, so reconfigure must throw and leave the encoder as it was.
+async function main() {
+    const input = generateClip('encoder-reconfigure-test', { size: '640x480', duration: 3, args: ['-q:v', '2'] });
+
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    using decoder = readContext.createDecoder(video.index);
+    let encoder: AVCodecContext | undefined;
+
+    const sizes: number[] = [];
+    const keyframes: number[] = [];
+    let frames = 0;
+    await readPackets(readContext, async packet => {
+        const decoded = packet.streamIndex === video.index ? await decoder.decode(packet) : [];
+        packet.destroy();
+
+        for (const frame of decoded) {
+            if (!encoder) {
+                encoder = frame.createEncoder({
+                    encoder: 'mpeg4',
+                    bitrate: 4000000,
+                    timeBase: video,
+                    gopSize: 300,
+                });
+            }
+            if (frames === 20)
+                encoder.requestKeyframe();
+            if (frames === 40)
+                assert.throws(() => encoder!.reconfigure({ bitrate: 200000 }), /can't change rate control/);
+            frames++;
+
+            await encoder.sendFrame(frame);
+            frame.destroy();
+            while (true) {
+                const encoded = await encoder.receivePacket();
+                if (!encoded)
+                    break;
+                if (encoded.flags & 1)
+                    keyframes.push(sizes.length);
+                sizes.push(encoded.size);
+                encoded.destroy();
+            }
+        }
+    });
+    encoder!.destroy();
+
+    const average = (from: number, to: number) => sizes.slice(from, to).reduce((a, b) => a + b, 0) / (to - from);
+    console.log('keyframes', keyframes, 'average before', average(21, 40), 'after', average(41, 60));
+    assert.deepStrictEqual(keyframes.slice(0, 2), [0, 20], 'keyframes not at the requested frames');
+    assert.ok(keyframes.length === 2 || keyframes[2] > 40, 'the rejected reconfigure reopened the encoder');
+    assert.ok(average(41, 60) > average(21, 40) / 2, 'the rejected reconfigure changed the bitrate');
+
+    removeClip(input);
+}
+
+main();
@@ -0,0 +1,84 @@
+import { execFileSync } from 'child_process';
+import fs from 'fs';
+import os from 'os';
+import path from 'path';
+import { AVFormatContext, AVPacket, getFFmpegPath } from '../src';
+
+// shared setup for the tests in this directory. clips are generated with the
+// bundled ffmpeg, so the tests run offline.
+export interface ClipOptions {
+    // defaults to 320x240.
+    size?: string;
+    // defaults to 30.
+    rate?: number;
+    // seconds, defaults to 4.
+    duration?: number;
+    // defaults to mpeg4.
+    codec?: string;
+    // adds an aac sine tone.
+    audio?: boolean;
+    // extra output options, ie ['-bf', '2'].
+    args?: string[];
+    // the container, by file extension. defaults to mkv.
+    extension?: string;
+}
+
+// writes a lavfi testsrc clip to os.tmpdir()/${name}-${pid}.${extension}.
+export function generateClip(name: string, options: ClipOptions = {}) {
+    const file = path.join(os.tmpdir(), `${name}-${process.pid}.${options.extension || 'mkv'}`);
+    const args = ['-y', '-loglevel', 'error',
+        '-f', 'lavfi', '-i', `testsrc=size=${options.size || '320x240'}:rate=${options.rate || 30}`];
+    if (options.audio)
+        args.push('-f', 'lavfi', '-i', 'sine=frequency=440', '-c:a', 'aac');
+    args.push('-t', String(options.duration || 4), '-c:v', options.codec || 'mpeg4', ...(options.args || []), file);
+    execFileSync(getFFmpegPath(), args);
+    return file;
+}
+
+export function removeClip(file: string) {
+    fs.rmSync(file, { force: true });
+}
+
+// readFrame and receiveFrame report the end of the input by throwing.
+function isEndOfFile(e: unknown) {
+    return e instanceof Error && /end of file/i.test(e.message);
+}
+
+// reads until the end of the input, rethrowing any other error.
+// the callback owns the packet.
+export async function readPackets(readContext: AVFormatContext, callback: (packet: AVPacket) => void | Promise<void>) {
+    while (true) {
+        let packet;
+        try {
+            packet = await readContext.readFrame();
+        }
+        catch (e) {
+            if (!isEndOfFile(e))
+                throw e;
+            break;
+        }
+        if (!packet)
+            continue;
+        await callback(packet);
+    }
+}
+
+type ReceiveResult = NonNullable<Awaited<ReturnType<AVFormatContext['receiveFrame']>>>;
+
+// receiveFrame counterpart of readPackets, the callback owns the result.
+export async function receiveFrames(readContext: AVFormatContext, pipelines: Parameters<AVFormatContext['receiveFrame']>[0], callback: (result: ReceiveResult) => void | Promise<void>) {
+    while (true) {
+        let result;
+        try {
+            result = await readContext.receiveFrame(pipelines);
+        }
+        catch (e) {
+            if (!isEndOfFile(e))
+                throw e;
+            break;
+        }
+        if (!result)
+            continue;
+        await callback(result);
+    }
+}
@@ -0,0 +1,90 @@
+import assert from 'assert';
+import fs from 'fs';
+import os from 'os';
+import path from 'path';
+import { AVOutputFragment, AVPacket, createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/fragmented-output-test.ts
+// muxes a clip to fragmented mp4 and checks that the init segment comes
+// first, that every fragment is a keyframe aligned moof+mdat pair, and that
+// the init segment plus any single fragment demuxes on its own.
+function boxTypes(buffer: Buffer) {
+    const types: string[] = [];
+    let offset = 0;
+    while (offset < buffer.length) {
+        assert.ok(offset + 8 <= buffer.length, 'truncated box header');
+        const size = buffer.readUInt32BE(offset);
+        assert.ok(size >= 8 && offset + size <= buffer.length, 'box runs past the end of the buffer');
+        types.push(buffer.toString('latin1', offset + 4, offset + 8));
+        offset += size;
+    }
+    return types;
+}
+
+async function countPackets(file: string) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(file);
+    let packets = 0;
+    await readPackets(readContext, packet => {
+        packets++;
+        packet.destroy();
+    });
+    return packets;
+}
+
+async function main() {
+    // a keyframe every second.
+    const input = generateClip('fragmented-output-test', { args: ['-g', '30'] });
+    const output = path.join(os.tmpdir(), `fragmented-output-test-${process.pid}-out.mp4`);
+
+    const deliveries: { buffer: Buffer, fragment: AVOutputFragment }[] = [];
+    let written = 0;
+    {
+        await using readContext = createAVFormatContext();
+        await readContext.open(input);
+        const video = readContext.streams.find(s => s.type === 'video')!;
+
+        await using writeContext = createAVFormatContext();
+        writeContext.create('mp4', (buffer, fragment) => deliveries.push({ buffer, fragment: fragment! }), {
+            fragmented: true,
+        });
+        const streamIndex = writeContext.newStream({
+            formatContext: readContext,
+            streamIndex: video.index,
+        });
+
+        await readPackets(readContext, (packet: AVPacket) => {
+            using p = packet;
+            if (p.streamIndex === video.index) {
+                writeContext.writeFrame(streamIndex, p);
+                written++;
+            }
+        });
+    }
+
+    const [init, ...fragments] = deliveries;
+    assert.strictEqual(init.fragment.type, 'init', 'the init segment was not delivered first');
+    assert.deepStrictEqual(boxTypes(init.buffer).slice(0, 2), ['ftyp', 'moov']);
+    assert.ok(fragments.length >= 3, `expected a fragment per keyframe, got ${fragments.length}`);
+
+    let muxed = 0;
+    for (const { buffer, fragment } of fragments) {
+        assert.strictEqual(fragment.type, 'fragment');
+        assert.strictEqual(fragment.size, buffer.length);
+        assert.ok(fragment.keyframe, 'fragment does not start at a keyframe');
+        assert.deepStrictEqual(boxTypes(buffer).filter(type => type !== 'styp'), ['moof', 'mdat'], 'fragment is not a single moof+mdat');
+
+        fs.writeFileSync(output, Buffer.concat([init.buffer, buffer]));
+        const packets = await countPackets(output);
+        assert.ok(packets > 0, 'fragment does not demux with the init segment');
+        muxed += packets;
+    }
+    console.log(`${fragments.length} fragments, ${muxed} packets`);
+    assert.strictEqual(muxed, written, 'packets missing from the fragments');
+
+    removeClip(input);
+    removeClip(output);
+}
+
+main();
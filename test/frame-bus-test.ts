@@ -0,0 +1,79 @@
+import assert from 'assert';
+import { createAVFormatContext, createAVFrameBus } from '../src';
+import { generateClip, receiveFrames, removeClip } from './fixture';
+
+// usage: ts-node test/frame-bus-test.ts
+// decodes a clip once and shares the frames with an every frame consumer,
+// a slow latest only consumer and a throttled consumer, and checks that the
+// slow consumer drops stale frames instead of holding up the decode loop.
+async function main() {
+    const input = generateClip('frame-bus-test', { rate: 10 });
+
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    using decoder = readContext.createDecoder(video.index);
+    using frameBus = createAVFrameBus();
+
+    const every: number[] = [];
+    frameBus.subscribe({
+        callback: frame => {
+            every.push(frame.pts);
+            frame.destroy();
+        },
+        mode: 'every',
+        queueSize: 64,
+    });
+
+    let slow = 0;
+    let slowBusy = false;
+    frameBus.subscribe({
+        callback: async frame => {
+            assert.ok(!slowBusy, 'frame delivered before the previous one settled');
+            slowBusy = true;
+            slow++;
+            frame.destroy();
+            await new Promise(resolve => setTimeout(resolve, 200));
+            slowBusy = false;
+        },
+    });
+
+    let throttled = 0;
+    frameBus.subscribe({
+        callback: frame => {
+            throttled++;
+            frame.destroy();
+        },
+        maxFps: 2,
+    });
+
+    let decoded = 0;
+    const start = Date.now();
+    await receiveFrames(readContext, [{
+        streamIndex: video.index,
+        decoder,
+        frameBus,
+    }], result => {
+        if (result.type === 'frame')
+            decoded++;
+        result.destroy();
+    });
+    const ms = Date.now() - start;
+
+    await new Promise(resolve => setTimeout(resolve, 500));
+    const stats = frameBus.getStats();
+    console.log(`decoded ${decoded} frames in ${ms}ms`, stats);
+
+    assert.strictEqual(stats.published, decoded);
+    assert.strictEqual(every.length, decoded);
+    assert.ok(every.every((pts, i) => !i || pts > every[i - 1]), 'every consumer received frames out of order');
+    assert.ok(slow < decoded && stats.subscribers[1].dropped > 0, 'slow consumer did not drop');
+    // 4 seconds at 2fps by timestamp.
+    const accepted = decoded - stats.subscribers[2].skipped;
+    assert.ok(accepted >= 7 && accepted <= 9, `throttled consumer accepted ${accepted} frames`);
+    assert.ok(throttled > 0 && throttled <= accepted);
+
+    removeClip(input);
+}
+
+main();
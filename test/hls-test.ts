@@ -0,0 +1,111 @@
+import assert from 'assert';
+import { createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/hls-test.ts
+// segments a clip into LL-HLS and checks that the playlist keeps windowSize
+// segments with consecutive sequence numbers, that parts stay within
+// partDuration and add up to their segment, and that the listed segments and
+// parts can be fetched while older ones are gone. then checks the window
+// of a playlist without parts.
+const windowSize = 3;
+
+async function withoutParts(input: string) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+
+    await using writeContext = createAVFormatContext();
+    writeContext.createHLS({ segmentDuration: 1, windowSize, prefix: 'segment' });
+    const streamIndex = writeContext.addStream({
+        formatContext: readContext,
+        streamIndex: video.index,
+    });
+    writeContext.writeHeader();
+
+    await readPackets(readContext, packet => {
+        using p = packet;
+        if (p.streamIndex === video.index)
+            writeContext.writeFrame(streamIndex, p);
+    });
+
+    const lines = writeContext.getPlaylist().trim().split('\n');
+    const mediaSequence = parseInt(lines.find(line => line.startsWith('#EXT-X-MEDIA-SEQUENCE:'))!.split(':')[1]);
+    assert.strictEqual(lines.filter(line => line.startsWith('#EXTINF:')).length, windowSize, 'playlist without parts does not hold windowSize segments');
+    assert.ok(writeContext.getSegment(mediaSequence + windowSize - 1), 'newest segment is not available');
+    assert.strictEqual(writeContext.getSegment(mediaSequence - 1), undefined, 'segment outside the window is still available');
+}
+
+async function main() {
+    const partDuration = 0.25;
+    // a keyframe every second over 8 seconds, so the window slides.
+    const input = generateClip('hls-test', { duration: 8, args: ['-g', '30'] });
+
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+
+    await using writeContext = createAVFormatContext();
+    writeContext.createHLS({
+        segmentDuration: 1,
+        partDuration,
+        windowSize,
+        prefix: 'segment',
+    });
+    const streamIndex = writeContext.addStream({
+        formatContext: readContext,
+        streamIndex: video.index,
+    });
+    writeContext.writeHeader();
+
+    await readPackets(readContext, packet => {
+        using p = packet;
+        if (p.streamIndex === video.index)
+            writeContext.writeFrame(streamIndex, p);
+    });
+
+    const playlist = writeContext.getPlaylist();
+    console.log(playlist);
+    const lines = playlist.trim().split('\n');
+    assert.ok(lines.includes(`#EXT-X-PART-INF:PART-TARGET=${partDuration.toFixed(3)}`), 'part target missing');
+    const mediaSequence = parseInt(lines.find(line => line.startsWith('#EXT-X-MEDIA-SEQUENCE:'))!.split(':')[1]);
+    assert.ok(mediaSequence > 0, 'window did not slide');
+
+    const segments: { sequence: number, duration: number, parts: number[] }[] = [];
+    let parts: number[] = [];
+    for (let i = 0; i < lines.length; i++) {
+        const part = lines[i].match(/^#EXT-X-PART:DURATION=([\d.]+),URI="segment(\d+)\.(\d+)\.ts"/);
+        if (part) {
+            const duration = parseFloat(part[1]);
+            assert.ok(duration > 0 && duration <= partDuration + 0.001, `part duration ${duration} exceeds the part target`);
+            assert.strictEqual(parseInt(part[3]), parts.length, 'parts are not numbered in order');
+            parts.push(duration);
+            continue;
+        }
+        const extinf = lines[i].match(/^#EXTINF:([\d.]+),/);
+        if (extinf) {
+            const uri = lines[++i].match(/^segment(\d+)\.ts$/);
+            assert.ok(uri, `unexpected segment uri ${lines[i]}`);
+            segments.push({ sequence: parseInt(uri[1]), duration: parseFloat(extinf[1]), parts });
+            parts = [];
+        }
+    }
+
+    assert.strictEqual(segments.length, windowSize, 'playlist does not hold windowSize segments');
+    segments.forEach((segment, i) => {
+        assert.strictEqual(segment.sequence, mediaSequence + i, 'segment sequence numbers are not consecutive');
+        assert.ok(writeContext.getSegment(segment.sequence), `listed segment ${segment.sequence} is not available`);
+        if (segment.parts.length) {
+            const total = segment.parts.reduce((a, b) => a + b, 0);
+            assert.ok(Math.abs(total - segment.duration) < 0.01, `parts of segment ${segment.sequence} do not add up to it`);
+            segment.parts.forEach((_, part) => assert.ok(writeContext.getSegment(segment.sequence, part), 'listed part is not available'));
+        }
+    });
+    assert.ok(segments[segments.length - 1].parts.length > 1, 'the newest segment has no parts');
+    assert.strictEqual(writeContext.getSegment(mediaSequence - 1), undefined, 'segment outside the window is still available');
+
+    await withoutParts(input);
+    removeClip(input);
+}
+
+main();
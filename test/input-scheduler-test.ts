@@ -0,0 +1,117 @@
+import assert from 'assert';
+import fs from 'fs';
+import { AVCodecContext, AVFormatContext, createAVFormatContext, createAVInputScheduler } from '../src';
+import { generateClip, removeClip } from './fixture';
+
+// usage: ts-node test/input-scheduler-test.ts
+// decodes many inputs at once on two scheduler threads and checks that every
+// input delivers all of its frames, tagged, followed by its end event. then
+// closes a scheduler whose thread is blocked reading a push input, which must
+// return without waiting for the read.
+async function closeWhileBlocked() {
+    const clip = generateClip('input-scheduler-blocked-test', { duration: 10, codec: 'mpeg2video', extension: 'ts' });
+    try {
+        await using ctx = createAVFormatContext();
+        const opened = ctx.openStream('mpegts');
+        // the tail is held back, so the last read waits for data that never comes.
+        const data = fs.readFileSync(clip).subarray(0, -1000);
+        const chunkSize = 4096;
+        for (let offset = 0; offset < data.length; offset += chunkSize) {
+            while (!ctx.push(data.subarray(offset, offset + chunkSize)))
+                await new Promise(resolve => setImmediate(resolve));
+        }
+        await opened;
+
+        let packets = 0;
+        let last = Date.now();
+        const scheduler = createAVInputScheduler({
+            threads: 1,
+            callback: event => {
+                if (event.type === 'packet') {
+                    packets++;
+                    last = Date.now();
+                    event.destroy();
+                }
+            },
+        });
+        const video = ctx.streams.find(s => s.type === 'video')!;
+        scheduler.add(ctx, [{ streamIndex: video.index }]);
+        while (!packets || Date.now() - last < 500)
+            await new Promise(resolve => setTimeout(resolve, 50));
+
+        const start = Date.now();
+        scheduler.close();
+        assert.ok(Date.now() - start < 100, 'close waited for a blocked read');
+        console.log(`closed while blocked after ${packets} packets`);
+        // lets the read return and the pool thread exit.
+        ctx.end();
+    }
+    finally {
+        removeClip(clip);
+    }
+}
+
+async function main() {
+    const input = generateClip('input-scheduler-test', { rate: 10, duration: 2 });
+
+    const count = 16;
+    const frames = new Map<string, number>();
+    const ended = new Set<string>();
+    let done: () => void;
+    const finished = new Promise<void>(resolve => done = resolve);
+
+    using scheduler = createAVInputScheduler({
+        threads: 2,
+        callback: event => {
+            if (event.type === 'frame') {
+                assert.ok(!ended.has(event.tag), 'frame delivered after end');
+                frames.set(event.tag, (frames.get(event.tag) || 0) + 1);
+                event.destroy();
+            }
+            else if (event.type === 'packet') {
+                event.destroy();
+            }
+            else if (event.type === 'end') {
+                ended.add(event.tag);
+                if (ended.size === count)
+                    done();
+            }
+            else {
+                assert.fail(event.error);
+            }
+        },
+    });
+
+    const contexts: AVFormatContext[] = [];
+    const decoders: AVCodecContext[] = [];
+    for (let i = 0; i < count; i++) {
+        const readContext = createAVFormatContext();
+        await readContext.open(input);
+        const video = readContext.streams.find(s => s.type === 'video')!;
+        const decoder = readContext.createDecoder(video.index);
+        contexts.push(readContext);
+        decoders.push(decoder);
+        scheduler.add(readContext, [{ streamIndex: video.index, decoder }], `camera-${i}`);
+    }
+
+    const start = Date.now();
+    await finished;
+    console.log(`decoded ${count} inputs in ${Date.now() - start}ms`, scheduler.getStats());
+
+    // the decoders are not flushed at the end, but they all hold back the same frames.
+    const expected = frames.get('camera-0')!;
+    assert.ok(expected > 10);
+    for (let i = 0; i < count; i++)
+        assert.strictEqual(frames.get(`camera-${i}`), expected, `camera-${i} did not deliver every frame`);
+    assert.strictEqual(scheduler.getStats().inputs.length, 0);
+
+    for (const decoder of decoders)
+        decoder.destroy();
+    for (const readContext of contexts)
+        await readContext.close();
+    removeClip(input);
+
+    await closeWhileBlocked();
+}
+
+main();
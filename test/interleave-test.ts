@@ -0,0 +1,91 @@
+import assert from 'assert';
+import fs from 'fs';
+import os from 'os';
+import path from 'path';
+import { AVPacket, createAVFormatContext, createAVPacket } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/interleave-test.ts
+// muxes the audio and video of a clip into one matroska output with
+// addStream, writing each stream in half second bursts, and checks that
+// the output comes back interleaved by timestamp with every packet present.
+// also checks that writes are rejected before writeHeader, and that nothing
+// can be added or written after writeTrailer.
+async function main() {
+    const input = generateClip('interleave-test', { audio: true });
+    const output = path.join(os.tmpdir(), `interleave-test-${process.pid}-out.mkv`);
+
+    const chunks: Buffer[] = [];
+    const counts = new Map<string, number>();
+    {
+        await using readContext = createAVFormatContext();
+        await readContext.open(input);
+
+        const queued = new Map<number, AVPacket[]>();
+        await readPackets(readContext, packet => {
+            if (!queued.has(packet.streamIndex))
+                queued.set(packet.streamIndex, []);
+            queued.get(packet.streamIndex)!.push(packet);
+        });
+
+        await using writeContext = createAVFormatContext();
+        writeContext.create('matroska', buffer => chunks.push(buffer));
+        const streams = readContext.streams.filter(s => s.type === 'video' || s.type === 'audio');
+        assert.strictEqual(streams.length, 2);
+        const writeStreams = new Map(streams.map(s => [s.index, writeContext.addStream({
+            formatContext: readContext,
+            streamIndex: s.index,
+        })]));
+        using probe = createAVPacket(Buffer.alloc(16), { copy: true });
+        assert.throws(() => writeContext.writeFrame(0, probe), /header not written/i);
+        writeContext.writeHeader();
+
+        // each stream in turn, half a second at a time, so the muxer has to interleave them.
+        for (let end = 0.5; [...queued.values()].some(q => q.length); end += 0.5) {
+            for (const stream of streams) {
+                const queue = queued.get(stream.index) || [];
+                while (queue.length && queue[0].dts * stream.timeBaseNum / stream.timeBaseDen < end) {
+                    using packet = queue.shift()!;
+                    writeContext.writeFrame(writeStreams.get(stream.index)!, packet);
+                    counts.set(stream.type, (counts.get(stream.type) || 0) + 1);
+                }
+            }
+        }
+        writeContext.writeTrailer();
+
+        assert.throws(() => writeContext.writeFrame(0, probe), /trailer already written/i);
+        assert.throws(() => writeContext.writeTrailer(), /trailer already written/i);
+        assert.throws(() => writeContext.writeHeader(), /already written/i);
+        assert.throws(() => writeContext.addStream({ formatContext: readContext, streamIndex: streams[0].index }));
+    }
+
+    fs.writeFileSync(output, Buffer.concat(chunks));
+    await using verifyContext = createAVFormatContext();
+    await verifyContext.open(output);
+    const muxed = new Map<string, number>();
+    let last = -Infinity;
+    let switches = 0;
+    let lastType: string | undefined;
+    await readPackets(verifyContext, packet => {
+        const stream = verifyContext.streams[packet.streamIndex];
+        const time = packet.dts * stream.timeBaseNum / stream.timeBaseDen;
+        // matroska timestamps are milliseconds.
+        assert.ok(time >= last - 0.001, `packet at ${time}s muxed after ${last}s`);
+        last = Math.max(last, time);
+        if (lastType && lastType !== stream.type)
+            switches++;
+        lastType = stream.type;
+        muxed.set(stream.type, (muxed.get(stream.type) || 0) + 1);
+        packet.destroy();
+    });
+
+    console.log('written', counts, 'muxed', muxed, 'stream switches', switches);
+    assert.deepStrictEqual(muxed, counts, 'packets missing from the output');
+    // 4 seconds written in half second bursts, interleaving switches far more often.
+    assert.ok(switches > 16, 'output is not interleaved');
+
+    removeClip(input);
+    removeClip(output);
+}
+
+main();
@@ -0,0 +1,70 @@
+import assert from 'assert';
+import fs from 'fs';
+import net from 'net';
+import { createAVFormatContext } from '../src';
+import { generateClip, removeClip } from './fixture';
+
+// usage: ts-node test/interrupt-test.ts
+// opens a tcp input whose server never sends anything and checks the open
+// fails with ETIMEDOUT after the timeout. then pushes a clip without ending
+// the stream, reads it with a timeout until the pushed data runs out and
+// checks the read times out the same way, then checks that abort interrupts
+// a read that is still waiting.
+async function openTimeout() {
+    const server = net.createServer(() => { });
+    await new Promise<void>(resolve => server.listen(0, '127.0.0.1', resolve));
+    const port = (server.address() as net.AddressInfo).port;
+
+    await using readContext = createAVFormatContext();
+    const start = Date.now();
+    await assert.rejects(readContext.open(`tcp://127.0.0.1:${port}`, {}, { timeout: 300 }), /timed out/i);
+    const waited = Date.now() - start;
+    console.log(`open timed out after ${waited}ms`);
+    assert.ok(waited >= 290 && waited < 2000, `open timed out after ${waited}ms`);
+    server.close();
+}
+
+async function main() {
+    await openTimeout();
+
+    const input = generateClip('interrupt-test', { duration: 2, extension: 'ts' });
+
+    const readContext = createAVFormatContext();
+    const opened = readContext.openStream('mpegts');
+    const data = fs.readFileSync(input);
+    for (let offset = 0; offset < data.length; offset += 4096)
+        assert.ok(readContext.push(data.subarray(offset, offset + 4096)), 'push queue full');
+    await opened;
+
+    let packets = 0;
+    let start: number;
+    while (true) {
+        start = Date.now();
+        try {
+            using packet = await readContext.readFrame({ timeout: 200 });
+            packets++;
+        }
+        catch (e) {
+            assert.match((e as Error).message, /timed out/i, `read failed with ${e}`);
+            break;
+        }
+    }
+    const waited = Date.now() - start;
+    console.log(`read ${packets} packets, then timed out after ${waited}ms`);
+    assert.ok(packets > 0, 'nothing was read');
+    assert.ok(waited >= 190 && waited < 2000, `timed out after ${waited}ms`);
+
+    // nothing more is pushed, so only abort can end this read.
+    start = Date.now();
+    const pending = readContext.readFrame();
+    setTimeout(() => readContext.abort(), 100);
+    await assert.rejects(pending, /exit/i);
+    const aborted = Date.now() - start;
+    console.log(`aborted after ${aborted}ms`);
+    assert.ok(aborted < 2000, 'abort did not interrupt the read');
+
+    await readContext.close();
+    removeClip(input);
+}
+
+main();
@@ -0,0 +1,69 @@
+import assert from 'assert';
+import fs from 'fs';
+import { createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/live-edge-test.ts
+// pushes a clip with B-frames at real time, like a live source, and reads it
+// with the live edge enabled. a reader that keeps up must not drop anything,
+// and a reader that stalls must catch up by dropping to a later keyframe.
+const duration = 6;
+
+async function readLive(data: Buffer, stall: number) {
+    await using readContext = createAVFormatContext();
+    const opened = readContext.openStream('mpegts');
+
+    // push the bytes in proportion to elapsed time, which is close enough to real time for a testsrc clip.
+    const start = Date.now();
+    let offset = 0;
+    const pusher = setInterval(() => {
+        const due = Math.min(data.length, Math.floor(data.length * (Date.now() - start) / (duration * 1000)));
+        while (offset < due && readContext.push(data.subarray(offset, Math.min(due, offset + 4096))))
+            offset = Math.min(due, offset + 4096);
+        if (offset === data.length) {
+            readContext.end();
+            clearInterval(pusher);
+        }
+    }, 20);
+
+    await opened;
+    readContext.setLiveEdge({ maxLag: 1 });
+    const video = readContext.streams.find(s => s.type === 'video')!;
+
+    let packets = 0;
+    let stalled = false;
+    await readPackets(readContext, async packet => {
+        packets++;
+        const seconds = packet.dts * video.timeBaseNum / video.timeBaseDen;
+        packet.destroy();
+        if (stall && !stalled && seconds >= 2) {
+            stalled = true;
+            await new Promise(resolve => setTimeout(resolve, stall * 1000));
+        }
+    });
+    clearInterval(pusher);
+    return { packets, stats: readContext.getLiveEdgeStats()! };
+}
+
+async function main() {
+    // a keyframe every half second, with B-frames so pts goes backwards in delivery order.
+    const input = generateClip('live-edge-test', { duration, args: ['-g', '15', '-bf', '2'], extension: 'ts' });
+    const data = fs.readFileSync(input);
+
+    const steady = await readLive(data, 0);
+    console.log('steady', steady);
+    assert.strictEqual(steady.stats.catchUps, 0, 'a reader that keeps up caught up');
+    assert.strictEqual(steady.stats.droppedPackets, 0);
+
+    const stalled = await readLive(data, 2.5);
+    console.log('stalled', stalled);
+    assert.ok(stalled.stats.catchUps >= 1, 'a stalled reader did not catch up');
+    assert.ok(stalled.stats.droppedPackets > 0, 'a stalled reader did not drop');
+    assert.ok(stalled.stats.peakLag >= 1.5, 'the stall did not show up as lag');
+    assert.ok(!stalled.stats.catchingUp && stalled.stats.lag < 1, 'the reader did not get back to the live edge');
+    assert.strictEqual(stalled.packets + stalled.stats.droppedPackets, steady.packets);
+
+    removeClip(input);
+}
+
+main();
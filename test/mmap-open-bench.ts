@@ -0,0 +1,50 @@
+import fs from 'fs';
+import path from 'path';
+import { createAVFormatContext } from '../src';
+
+// usage: ts-node test/mmap-open-bench.ts /path/to/recordings [packetsPerSegment]
+// opens every segment in the directory and reads the first few packets,
+// which is the access pattern of timeline preview generation.
+async function readSegments(files: string[], packetsPerSegment: number, mmap: boolean) {
+    const start = process.hrtime.bigint();
+    let packets = 0;
+    for (const file of files) {
+        await using ctx = createAVFormatContext();
+        await ctx.open(file, undefined, { mmap });
+        for (let i = 0; i < packetsPerSegment; i++) {
+            try {
+                using packet = await ctx.readFrame();
+                if (packet)
+                    packets++;
+            }
+            catch (e) {
+                // end of file
+                break;
+            }
+        }
+    }
+    const ms = Number(process.hrtime.bigint() - start) / 1e6;
+    return { ms, packets };
+}
+
+async function main() {
+    const dir = process.argv[2];
+    const packetsPerSegment = parseInt(process.argv[3] || '30');
+    const files = fs.readdirSync(dir)
+        .filter(f => /\.(mp4|ts|mkv|m4s)$/.test(f))
+        .map(f => path.join(dir, f));
+
+    // warm the page cache so both passes measure the io path rather than the disk.
+    await readSegments(files, packetsPerSegment, false);
+
+    for (let pass = 0; pass < 3; pass++) {
+        const file = await readSegments(files, packetsPerSegment, false);
+        const mmap = await readSegments(files, packetsPerSegment, true);
+        console.log(`segments: ${files.length} packets: ${file.packets}`,
+            `file: ${file.ms.toFixed(1)}ms`,
+            `mmap: ${mmap.ms.toFixed(1)}ms`,
+            `speedup: ${(file.ms / mmap.ms).toFixed(2)}x`);
+    }
+}
+
+main();
@@ -0,0 +1,70 @@
+import assert from 'assert';
+import { AVCodecContext, createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/output-rate-test.ts
+// decodes a clip with each output rate policy and checks how many frames get
+// through. the clip decodes far faster than real time, so maxFps only passes
+// if frames are timed by their timestamps. also clears a keyframes only policy
+// halfway and checks that every frame after it is decoded again.
+async function decode(input: string, setup: (decoder: AVCodecContext) => void, onTime?: (decoder: AVCodecContext, seconds: number) => void) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    using decoder = readContext.createDecoder(video.index);
+    setup(decoder);
+
+    const times: number[] = [];
+    const receive = async () => {
+        while (true) {
+            const frame = await decoder.receiveFrame();
+            if (!frame)
+                break;
+            times.push(frame.pts * video.timeBaseNum / video.timeBaseDen);
+            frame.destroy();
+        }
+    };
+    await readPackets(readContext, async packet => {
+        if (packet.streamIndex === video.index) {
+            onTime?.(decoder, packet.pts * video.timeBaseNum / video.timeBaseDen);
+            await decoder.sendPacket(packet);
+            await receive();
+        }
+        packet.destroy();
+    });
+    return { times, stats: decoder.getOutputRateStats() };
+}
+
+async function main() {
+    // 120 frames with a keyframe every second.
+    const input = generateClip('output-rate-test', { args: ['-g', '30'] });
+
+    const maxFps = await decode(input, decoder => decoder.setOutputRate({ maxFps: 5 }));
+    console.log('maxFps 5', maxFps.stats);
+    assert.ok(maxFps.times.length >= 19 && maxFps.times.length <= 21, `maxFps delivered ${maxFps.times.length} frames`);
+    assert.strictEqual(maxFps.stats!.accepted + maxFps.stats!.dropped, 120);
+
+    const everyNth = await decode(input, decoder => decoder.setOutputRate({ everyNth: 3 }));
+    console.log('everyNth 3', everyNth.stats);
+    assert.strictEqual(everyNth.times.length, 40);
+
+    const keyframes = await decode(input, decoder => decoder.setOutputRate({ keyframesOnly: true }));
+    console.log('keyframesOnly', keyframes.stats);
+    assert.deepStrictEqual(keyframes.times.map(Math.round), [0, 1, 2, 3], 'keyframesOnly delivered other frames');
+    assert.ok(keyframes.stats!.accepted + keyframes.stats!.dropped < 120, 'the decoder did not skip non keyframes');
+
+    let cleared = false;
+    const restored = await decode(input, decoder => decoder.setOutputRate({ keyframesOnly: true }), (decoder, seconds) => {
+        if (!cleared && seconds >= 2) {
+            decoder.setOutputRate(undefined);
+            cleared = true;
+        }
+    });
+    console.log('cleared at 2s', restored.times.length);
+    assert.strictEqual(restored.stats, undefined);
+    assert.strictEqual(restored.times.filter(t => t >= 2).length, 60, 'frames after clearing the policy are still skipped');
+
+    removeClip(input);
+}
+
+main();
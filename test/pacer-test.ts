@@ -0,0 +1,69 @@
+import assert from 'assert';
+import { createAVFormatContext } from '../src';
+import { generateClip, removeClip } from './fixture';
+
+// usage: ts-node test/pacer-test.ts
+// paces a large frame against a manual clock and checks that its rtp packets
+// are released on schedule rather than as a burst, and that a write to a
+// stream that doesn't exist is not paced.
+async function drainCallbacks() {
+    await new Promise(resolve => setImmediate(resolve));
+}
+
+async function main() {
+    // high quality 1080p mjpeg at 10fps, so one frame spans several max size rtp packets.
+    const input = generateClip('pacer-test', { size: '1920x1080', rate: 10, duration: 1, codec: 'mjpeg', args: ['-q:v', '1'], extension: 'mov' });
+
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+
+    let received = 0;
+    await using writeContext = createAVFormatContext();
+    writeContext.create('rtp', () => received++, {
+        pacing: {
+            spread: 0.5,
+            clock: 'manual',
+        },
+    });
+    const streamIndex = writeContext.newStream({
+        formatContext: readContext,
+        streamIndex: video.index,
+    });
+
+    using packet = await readContext.readFrame();
+    writeContext.writeFrame(streamIndex, packet);
+    await drainCallbacks();
+    assert.strictEqual(received, 0, 'packets were sent before the clock advanced');
+
+    const count = writeContext.getPacerStats()!.queueDepth;
+    assert.ok(count > 1, 'frame fit in a single packet');
+
+    // 10fps with a spread of 0.5 puts the frame's packets over 50ms.
+    const span = 50000;
+    const step = 5;
+    for (let ms = 0; ms <= 50; ms += step) {
+        writeContext.advancePacerClock(ms ? step : 0);
+        await drainCallbacks();
+        let expected = 0;
+        for (let i = 0; i < count; i++) {
+            if (Math.floor(span * i / count) <= ms * 1000)
+                expected++;
+        }
+        assert.strictEqual(received, expected, `at ${ms}ms`);
+    }
+
+    // the rtp muxer has a single stream.
+    writeContext.writeFrame(5, packet);
+    writeContext.advancePacerClock(100000);
+    await drainCallbacks();
+
+    const stats = writeContext.getPacerStats()!;
+    console.log(stats);
+    assert.strictEqual(stats.queueDepth, 0);
+    assert.strictEqual(stats.sent, count);
+
+    removeClip(input);
+}
+
+main();
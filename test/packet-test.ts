@@ -0,0 +1,39 @@
+import assert from 'assert';
+import { createAVPacket } from '../src';
+
+// usage: ts-node test/packet-test.ts
+// creates packets from buffers with and without usable padding, and checks
+// which ones wrap the buffer by modifying it after the packet is created.
+function wraps(buffer: Buffer, options?: Parameters<typeof createAVPacket>[1]) {
+    buffer[0] = 1;
+    using packet = createAVPacket(buffer, options);
+    assert.strictEqual(packet.size, buffer.length);
+    buffer[0] = 2;
+    return packet.getData()[0] === 2;
+}
+
+function main() {
+    const size = 1000;
+
+    // zeroed padding past the view that only this buffer uses.
+    assert.ok(wraps(Buffer.alloc(size + 64).subarray(0, size)), 'padded buffer was copied');
+
+    // no room for the padding.
+    assert.ok(!wraps(Buffer.alloc(size)), 'unpadded buffer was wrapped');
+    assert.ok(wraps(Buffer.alloc(size), { padding: false }), 'padding: false buffer was copied');
+
+    // the padding holds data.
+    const dirty = Buffer.alloc(size + 64, 0xff);
+    assert.ok(!wraps(dirty.subarray(0, size)), 'buffer with nonzero padding was wrapped');
+
+    // small buffers are slices of a pool shared with other buffers.
+    const pooled = Buffer.allocUnsafe(100);
+    assert.ok(pooled.buffer.byteLength === Buffer.poolSize, 'expected a pooled buffer');
+    assert.ok(!wraps(pooled), 'pooled buffer was wrapped');
+
+    assert.ok(!wraps(Buffer.alloc(size + 64).subarray(0, size), { copy: true }), 'copy: true buffer was wrapped');
+
+    console.log('packet wrapping ok');
+}
+
+main();
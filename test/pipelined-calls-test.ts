@@ -0,0 +1,63 @@
+import assert from 'assert';
+import { AVFrame, createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/pipelined-calls-test.ts
+// decodes a clip awaiting every codec call, then again issuing sendPacket,
+// receiveFrame, receiveFrame back to back and destroying the packet before
+// the send resolves, and checks that both decode the same frames in order.
+async function decode(input: string, pipelined: boolean) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    using decoder = readContext.createDecoder(video.index);
+
+    const pts: number[] = [];
+    const collect = (frame: AVFrame) => {
+        if (!frame)
+            return;
+        pts.push(frame.pts);
+        frame.destroy();
+    };
+
+    const pending: Promise<any>[] = [];
+    await readPackets(readContext, async packet => {
+        if (packet.streamIndex !== video.index) {
+            packet.destroy();
+            return;
+        }
+
+        if (pipelined) {
+            pending.push(decoder.sendPacket(packet));
+            packet.destroy();
+            pending.push(decoder.receiveFrame().then(collect));
+            pending.push(decoder.receiveFrame().then(collect));
+        }
+        else {
+            await decoder.sendPacket(packet);
+            packet.destroy();
+            collect(await decoder.receiveFrame());
+            collect(await decoder.receiveFrame());
+        }
+    });
+    await Promise.all(pending);
+    return pts;
+}
+
+async function main() {
+    const input = generateClip('pipelined-calls-test', { size: '1280x720' });
+
+    let start = Date.now();
+    const awaited = await decode(input, false);
+    console.log(`awaited ${Date.now() - start}ms`, awaited.length);
+    start = Date.now();
+    const pipelined = await decode(input, true);
+    console.log(`pipelined ${Date.now() - start}ms`, pipelined.length);
+
+    assert.ok(awaited.length > 0, 'no frames decoded');
+    assert.deepStrictEqual(pipelined, awaited, 'pipelined frames differ');
+
+    removeClip(input);
+}
+
+main();
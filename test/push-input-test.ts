@@ -0,0 +1,66 @@
+import assert from 'assert';
+import fs from 'fs';
+import { AVFormatContext, createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/push-input-test.ts
+// pushes a clip into openStream in chunks and checks every packet comes out,
+// checks push throws after end, then closes a context whose open is still
+// waiting on pushed data and checks push throws after close.
+async function countPackets(ctx: AVFormatContext) {
+    let packets = 0;
+    await readPackets(ctx, packet => {
+        packets++;
+        packet.destroy();
+    });
+    return packets;
+}
+
+async function main() {
+    const clip = generateClip('push-input-test', { duration: 2, codec: 'mpeg2video', extension: 'ts' });
+
+    try {
+        let expected: number;
+        {
+            await using ctx = createAVFormatContext();
+            await ctx.open(clip);
+            expected = await countPackets(ctx);
+        }
+        assert(expected > 0, 'clip has no packets');
+
+        {
+            await using ctx = createAVFormatContext();
+            const opened = ctx.openStream('mpegts');
+            const data = fs.readFileSync(clip);
+            const chunkSize = 4096;
+            for (let offset = 0; offset < data.length; offset += chunkSize) {
+                const chunk = data.subarray(offset, offset + chunkSize);
+                while (!ctx.push(chunk))
+                    await new Promise(resolve => setImmediate(resolve));
+            }
+            ctx.end();
+            // a retry loop like the one above must not spin after end.
+            assert.throws(() => ctx.push(data.subarray(0, chunkSize)), /end of file/i);
+            await opened;
+            const packets = await countPackets(ctx);
+            assert.strictEqual(packets, expected, 'pushed stream lost packets');
+        }
+
+        {
+            const ctx = createAVFormatContext();
+            // nothing is pushed, so the open waits until close wakes it.
+            const opened = ctx.openStream('mpegts');
+            const closed = ctx.close();
+            await assert.rejects(opened);
+            await closed;
+            assert.throws(() => ctx.push(Buffer.alloc(188)));
+        }
+
+        console.log(`pushed ${expected} packets`);
+    }
+    finally {
+        removeClip(clip);
+    }
+}
+
+main();
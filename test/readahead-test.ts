@@ -0,0 +1,38 @@
+import assert from 'assert';
+import { createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/readahead-test.ts
+// reads a clip through a small readahead queue while consuming slowly, and
+// checks that every packet arrives in order and that the stalls show up as
+// overflows rather than underruns.
+async function readAll(input: string, readahead: boolean) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input, undefined, readahead ? { readahead: { maxPackets: 8 } } : undefined);
+    const dts: number[] = [];
+    await readPackets(readContext, async packet => {
+        dts.push(packet.dts);
+        packet.destroy();
+        if (readahead)
+            await new Promise(resolve => setTimeout(resolve, 1));
+    });
+    return { dts, stats: readContext.getReadaheadStats() };
+}
+
+async function main() {
+    const input = generateClip('readahead-test', { duration: 2 });
+
+    const direct = await readAll(input, false);
+    const readahead = await readAll(input, true);
+    console.log(readahead.stats);
+
+    assert.strictEqual(direct.stats, undefined);
+    assert.ok(direct.dts.length > 0, 'no packets read');
+    assert.deepStrictEqual(readahead.dts, direct.dts, 'readahead changed the packets');
+    assert.ok(readahead.stats!.overflows > 0, 'slow consumer did not fill the queue');
+    assert.ok(readahead.stats!.packets <= 8);
+
+    removeClip(input);
+}
+
+main();
@@ -0,0 +1,49 @@
+import assert from 'assert';
+import { AVPriority, createAVFormatContext, getSchedulerStats } from '../src';
+import { generateClip, receiveFrames, removeClip } from './fixture';
+
+// usage: ts-node test/scheduler-priority-test.ts
+// decodes a clip as live while several background decodes of the same clip
+// run, and checks that background work stays within its limit and that live
+// calls are not held back behind it.
+async function decodeAll(input: string, priority: AVPriority) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    readContext.priority = priority;
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    using decoder = readContext.createDecoder(video.index);
+    decoder.priority = priority;
+
+    let frames = 0;
+    await receiveFrames(readContext, [{ streamIndex: video.index, decoder }], result => {
+        if (result.type === 'frame')
+            frames++;
+        result.destroy();
+    });
+    return frames;
+}
+
+async function main() {
+    const input = generateClip('scheduler-priority-test', { size: '1280x720' });
+
+    let maxBackground = 0;
+    const sampler = setInterval(() => {
+        maxBackground = Math.max(maxBackground, getSchedulerStats().background.running);
+    }, 1);
+
+    const background = [0, 1, 2, 3].map(() => decodeAll(input, 'background'));
+    const live = await decodeAll(input, 'live');
+    const backgroundFrames = await Promise.all(background);
+    clearInterval(sampler);
+
+    const stats = getSchedulerStats();
+    console.log(stats);
+    assert.ok(live > 0);
+    assert.ok(backgroundFrames.every(frames => frames === live), 'background decode lost frames');
+    assert.ok(maxBackground <= stats.background.limit, 'background exceeded its limit');
+    assert.ok(stats.live.maxWait < stats.background.maxWait, 'live calls waited longer than background calls');
+
+    removeClip(input);
+}
+
+main();
@@ -0,0 +1,190 @@
+import assert from 'assert';
+import crypto from 'crypto';
+import { createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/srtp-test.ts [input]
+// protects rtp output natively and verifies every packet with an independent
+// SRTP/SRTCP implementation built on node:crypto. without an input, a short
+// mjpeg clip is generated with the bundled ffmpeg, so this runs offline.
+
+function aesCm(key: Buffer, iv: Buffer, length: number) {
+    const cipher = crypto.createCipheriv('aes-128-ctr', key, iv);
+    return cipher.update(Buffer.alloc(length));
+}
+
+// RFC 3711 4.3.1 with a key derivation rate of 0.
+function deriveKey(masterKey: Buffer, masterSalt: Buffer, label: number, length: number) {
+    const iv = Buffer.alloc(16);
+    masterSalt.copy(iv);
+    iv[7] ^= label;
+    return aesCm(masterKey, iv, length);
+}
+
+function deriveSession(masterKey: Buffer, masterSalt: Buffer, rtcp: boolean) {
+    const base = rtcp ? 3 : 0;
+    return {
+        key: deriveKey(masterKey, masterSalt, base, 16),
+        auth: deriveKey(masterKey, masterSalt, base + 1, 20),
+        salt: deriveKey(masterKey, masterSalt, base + 2, 14),
+    };
+}
+
+// (salt << 16) ^ (ssrc << 64) ^ (index << 16)
+function packetIv(salt: Buffer, ssrc: Buffer, index: bigint) {
+    const iv = Buffer.alloc(16);
+    salt.copy(iv);
+    for (let i = 0; i < 4; i++)
+        iv[4 + i] ^= ssrc[i];
+    const indexBytes = Buffer.alloc(8);
+    indexBytes.writeBigUInt64BE(index);
+    for (let i = 8; i < 14; i++)
+        iv[i] ^= indexBytes[i - 6];
+    return iv;
+}
+
+function knownAnswer() {
+    // RFC 3711 appendix B.3
+    const masterKey = Buffer.from('E1F97A0D3E018BE0D64FA32C06DE4139', 'hex');
+    const masterSalt = Buffer.from('0EC675AD498AFEEBB6960B3AABE6', 'hex');
+    const session = deriveSession(masterKey, masterSalt, false);
+    assert.strictEqual(session.key.toString('hex').toUpperCase(), 'C61E7A93744F39EE10734AFE3FF7A087');
+    assert.strictEqual(session.salt.toString('hex').toUpperCase(), '30CBBC08863D8C85D49DB34A9AE1');
+    assert.strictEqual(session.auth.toString('hex').toUpperCase(), 'CEBE321F6FF7716B6FD4AB49AF256A156D38BAA4');
+}
+
+class Verifier {
+    rtp: ReturnType<typeof deriveSession>;
+    rtcp: ReturnType<typeof deriveSession>;
+    roc = 0;
+    lastSeq = -1;
+    rtpPayloads: Buffer[] = [];
+    rtcpPackets = 0;
+
+    constructor(masterKey: Buffer, masterSalt: Buffer, public tagLength: number) {
+        this.rtp = deriveSession(masterKey, masterSalt, false);
+        this.rtcp = deriveSession(masterKey, masterSalt, true);
+    }
+
+    verify(packet: Buffer) {
+        const pt = packet[1] & 0x7f;
+        if (pt >= 72 && pt <= 76)
+            this.verifyRtcp(packet);
+        else
+            this.verifyRtp(packet);
+    }
+
+    verifyRtp(packet: Buffer) {
+        const seq = packet.readUInt16BE(2);
+        if (this.lastSeq > 0xff00 && seq < 0x100)
+            this.roc++;
+        this.lastSeq = seq;
+
+        const authenticated = packet.subarray(0, packet.length - this.tagLength);
+        const roc = Buffer.alloc(4);
+        roc.writeUInt32BE(this.roc);
+        const tag = crypto.createHmac('sha1', this.rtp.auth).update(authenticated).update(roc).digest().subarray(0, this.tagLength);
+        assert.ok(tag.equals(packet.subarray(packet.length - this.tagLength)), `rtp auth tag mismatch, seq ${seq}`);
+
+        let headerLength = 12 + (packet[0] & 0x0f) * 4;
+        if (packet[0] & 0x10)
+            headerLength += 4 + packet.readUInt16BE(headerLength + 2) * 4;
+        const index = (BigInt(this.roc) << 16n) | BigInt(seq);
+        const iv = packetIv(this.rtp.salt, packet.subarray(8, 12), index);
+        const payload = authenticated.subarray(headerLength);
+        const keystream = aesCm(this.rtp.key, iv, payload.length);
+        const plain = Buffer.alloc(payload.length);
+        for (let i = 0; i < payload.length; i++)
+            plain[i] = payload[i] ^ keystream[i];
+        this.rtpPayloads.push(plain);
+    }
+
+    verifyRtcp(packet: Buffer) {
+        // SRTCP always carries the E flag and index, followed by the tag.
+        const trailer = packet.length - this.tagLength - 4;
+        const authenticated = packet.subarray(0, packet.length - this.tagLength);
+        const tag = crypto.createHmac('sha1', this.rtcp.auth).update(authenticated).digest().subarray(0, this.tagLength);
+        assert.ok(tag.equals(packet.subarray(packet.length - this.tagLength)), 'rtcp auth tag mismatch');
+
+        const e = packet.readUInt32BE(trailer);
+        assert.ok(e & 0x80000000, 'rtcp not encrypted');
+        const index = BigInt(e & 0x7fffffff);
+        const iv = packetIv(this.rtcp.salt, packet.subarray(4, 8), index);
+        const payload = packet.subarray(8, trailer);
+        const keystream = aesCm(this.rtcp.key, iv, payload.length);
+        const plain = Buffer.alloc(payload.length);
+        for (let i = 0; i < payload.length; i++)
+            plain[i] = payload[i] ^ keystream[i];
+        // sender reports start with the NTP wallclock, which should be close to now.
+        if (packet[1] === 200) {
+            const ntpSeconds = plain.readUInt32BE(0);
+            const nowSeconds = Math.floor(Date.now() / 1000) + 2208988800;
+            assert.ok(Math.abs(ntpSeconds - nowSeconds) < 3600, 'rtcp sender report did not decrypt');
+        }
+        this.rtcpPackets++;
+    }
+}
+
+async function main() {
+    knownAnswer();
+
+    const input = process.argv[2] || generateClip('srtp-test', { rate: 15, codec: 'mjpeg' });
+
+    const masterKey = crypto.randomBytes(16);
+    const masterSalt = crypto.randomBytes(14);
+    const packets: Buffer[] = [];
+    const plainPackets: Buffer[] = [];
+
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+
+    await using writeContext = createAVFormatContext();
+    writeContext.create('rtp', rtp => packets.push(rtp), {
+        srtp: {
+            suite: 'AES_CM_128_HMAC_SHA1_80',
+            key: masterKey,
+            salt: masterSalt,
+        },
+    });
+    const streamIndex = writeContext.newStream({
+        formatContext: readContext,
+        streamIndex: video.index,
+    });
+
+    // the same stream without protection, for comparing payloads.
+    await using plainContext = createAVFormatContext();
+    plainContext.create('rtp', rtp => plainPackets.push(rtp));
+    const plainStreamIndex = plainContext.newStream({
+        formatContext: readContext,
+        streamIndex: video.index,
+    });
+
+    await readPackets(readContext, packet => {
+        using p = packet;
+        if (p.streamIndex === video.index) {
+            writeContext.writeFrame(streamIndex, p);
+            plainContext.writeFrame(plainStreamIndex, p);
+        }
+    });
+
+    // let the callbacks drain.
+    await new Promise(resolve => setImmediate(resolve));
+
+    const verifier = new Verifier(masterKey, masterSalt, 10);
+    for (const packet of packets)
+        verifier.verify(packet);
+
+    const plainPayloads = plainPackets
+        .filter(packet => !((packet[1] & 0x7f) >= 72 && (packet[1] & 0x7f) <= 76))
+        .map(packet => packet.subarray(12 + (packet[0] & 0x0f) * 4));
+    assert.ok(verifier.rtpPayloads.length > 0, 'no rtp packets written');
+    assert.strictEqual(verifier.rtpPayloads.length, plainPayloads.length);
+    verifier.rtpPayloads.forEach((payload, i) => assert.ok(payload.equals(plainPayloads[i]), `payload mismatch at packet ${i}`));
+    console.log(`verified ${verifier.rtpPayloads.length} srtp and ${verifier.rtcpPackets} srtcp packets`);
+
+    if (!process.argv[2])
+        removeClip(input);
+}
+
+main();
@@ -0,0 +1,49 @@
+import assert from 'assert';
+import { createAVFormatContext } from '../src';
+import { generateClip, receiveFrames, removeClip } from './fixture';
+
+// usage: ts-node test/stream-thread-test.ts
+// decodes the video of a clip on a stream thread and the audio inline, and
+// checks that both decode every frame in order, with the same video frames
+// as decoding everything inline.
+async function decode(input: string, thread: boolean) {
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+    const audio = readContext.streams.find(s => s.type === 'audio')!;
+    using videoDecoder = readContext.createDecoder(video.index);
+    using audioDecoder = readContext.createDecoder(audio.index);
+
+    const videoPts: number[] = [];
+    let audioFrames = 0;
+    await receiveFrames(readContext, [
+        { streamIndex: video.index, decoder: videoDecoder, thread },
+        { streamIndex: audio.index, decoder: audioDecoder },
+    ], result => {
+        if (result.type === 'frame') {
+            if (result.streamIndex === video.index)
+                videoPts.push(result.pts);
+            else
+                audioFrames++;
+        }
+        result.destroy();
+    });
+    return { videoPts, audioFrames };
+}
+
+async function main() {
+    const input = generateClip('stream-thread-test', { size: '1280x720', audio: true });
+
+    const inline = await decode(input, false);
+    const start = Date.now();
+    const threaded = await decode(input, true);
+    console.log(`threaded decode ${Date.now() - start}ms`, threaded.videoPts.length, threaded.audioFrames);
+
+    assert.ok(inline.videoPts.length > 0 && inline.audioFrames > 0, 'no frames decoded');
+    assert.deepStrictEqual(threaded.videoPts, inline.videoPts, 'threaded video frames differ');
+    assert.strictEqual(threaded.audioFrames, inline.audioFrames);
+
+    removeClip(input);
+}
+
+main();
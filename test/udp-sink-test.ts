@@ -0,0 +1,62 @@
+import assert from 'assert';
+import dgram from 'dgram';
+import { createAVFormatContext } from '../src';
+import { generateClip, readPackets, removeClip } from './fixture';
+
+// usage: ts-node test/udp-sink-test.ts [input]
+// sends rtp output natively to a loopback socket and checks that everything
+// counted as sent by the sink arrives. without an input, a short mjpeg clip
+// is generated with the bundled ffmpeg.
+async function main() {
+    const input = process.argv[2] || generateClip('udp-sink-test', { size: '640x480', rate: 15, codec: 'mjpeg' });
+
+    const socket = dgram.createSocket('udp4');
+    socket.bind(0, '127.0.0.1');
+    await new Promise(resolve => socket.once('listening', resolve));
+    socket.setRecvBufferSize(8 * 1024 * 1024);
+
+    let received = 0;
+    let receivedBytes = 0;
+    socket.on('message', message => {
+        received++;
+        receivedBytes += message.length;
+    });
+
+    await using readContext = createAVFormatContext();
+    await readContext.open(input);
+    const video = readContext.streams.find(s => s.type === 'video')!;
+
+    await using writeContext = createAVFormatContext();
+    writeContext.create('rtp', undefined, {
+        udp: {
+            address: '127.0.0.1',
+            port: socket.address().port,
+        },
+    });
+    const streamIndex = writeContext.newStream({
+        formatContext: readContext,
+        streamIndex: video.index,
+    });
+
+    const start = process.hrtime.bigint();
+    await readPackets(readContext, packet => {
+        using p = packet;
+        if (p.streamIndex === video.index)
+            writeContext.writeFrame(streamIndex, p);
+    });
+    const ms = Number(process.hrtime.bigint() - start) / 1e6;
+
+    await new Promise(resolve => setTimeout(resolve, 500));
+    socket.close();
+
+    const stats = writeContext.getUDPStats()!;
+    console.log(`${ms.toFixed(1)}ms`, stats, { received, receivedBytes });
+    assert.ok(stats.packets > 0, 'nothing sent');
+    assert.strictEqual(received, stats.packets);
+    assert.strictEqual(receivedBytes, stats.bytes);
+
+    if (!process.argv[2])
+        removeClip(input);
+}
+
+main();